@@ -1,164 +1,204 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
-#include "app_timer.h"
-#include "nrfx_pwm.h"
-#include "nrf_gpio.h"
+#include "app_util_platform.h"
 #include "alarm.h"
+#include "hal.h"
+#include "timekeeping.h"
+#include "wave.h"
 
-#define AUDIO_PIN_LEFT    EDGE_P3
-#define AUDIO_PIN_RIGHT   EDGE_P4 
-
-nrfx_pwm_t m_pwm0 = NRFX_PWM_INSTANCE(0);
-nrf_pwm_values_common_t seq_values[1] = {0};
-nrf_pwm_sequence_t const seq = {
-    .values.p_common = seq_values,
-    .length          = 1,
-    .repeats         = 0,
-    .end_delay       = 0
-};
 #define RADAR_DURATION_MS          3000
-#define RADAR_UPDATE_INTERVAL_MS   50
 #define RADAR_SWEEP_PERIOD_MS      1000
+#define RADAR_F_MIN                400
+#define RADAR_F_MAX                800
+// One rising and one falling ramp: 800 Hz for 1 s is 80 entries at most.
+#define RADAR_WAVE_MAX             96
+
+#define TONE_DURATION_MS           2000
+#define TONE_DUTY_PERMILLE         500
+// A lone tone is built as a short block; several active sources alternate
+// in slices of this length. Either way the PWM loops the block itself.
+#define TONE_BLOCK_MS              50
+#define TONE_SLICE_MS              250
+#define TONE_WAVE_MAX              64
+
+// Requests raised within this window are mixed into one pattern.
+#define ALARM_COALESCE_MS          10
+// A threshold source plays once per excursion, and at most this often.
+#define ALARM_HOLDOFF_MS           60000
+
+typedef struct {
+    const char *name;
+    uint16_t freq;
+    bool latching;
+} alarm_source_desc_t;
+
+static const alarm_source_desc_t sources[ALARM_SRC_COUNT] = {
+    [ALARM_SRC_CLOCK]       = { "Clock",       0,   false },
+    [ALARM_SRC_TEMPERATURE] = { "Temperature", 500, true },
+    [ALARM_SRC_HUMIDITY]    = { "Humidity",    600, true },
+    [ALARM_SRC_ECO2]        = { "eCO2",        700, true },
+};
+
+static const wave_segment_t radar_sweep[] = {
+    { RADAR_F_MIN, RADAR_F_MAX, RADAR_SWEEP_PERIOD_MS / 2, TONE_DUTY_PERMILLE },
+    { RADAR_F_MAX, RADAR_F_MIN, RADAR_SWEEP_PERIOD_MS / 2, TONE_DUTY_PERMILLE },
+};
+
+HAL_TIMER_DEF(alarm_coalesce_timer);
 
-static uint32_t radar_elapsed_ms = 0;
-static const uint16_t f_min = 400;
-static const uint16_t f_max = 800;
+static hal_pwm_entry_t radar_wave[RADAR_WAVE_MAX];
+static uint16_t radar_wave_len = 0;
+static hal_pwm_entry_t tone_wave[TONE_WAVE_MAX];
 
-APP_TIMER_DEF(alarm_radar_timer);
-APP_TIMER_DEF(alarm_temp_timer); 
-APP_TIMER_DEF(alarm_humid_timer);
-APP_TIMER_DEF(alarm_eco2_timer);
+// Bit n stands for alarm_source_t n. This module is the only PWM user, so
+// playing_mask is the whole truth about the speaker. Dispatch runs from the
+// coalesce timer and the PWM interrupt, hence the critical regions.
+static volatile uint8_t pending_mask = 0;
+static volatile uint8_t playing_mask = 0;
+static volatile uint8_t latched_mask = 0;
+static bool played_once[ALARM_SRC_COUNT];
+static uint32_t last_played_ms[ALARM_SRC_COUNT];
+
+static void alarm_dispatch(void);
+
+static void playback_done(void)
+{
+    playing_mask = 0;
+    alarm_dispatch();
+}
+
+static void alarm_coalesce_timer_cb(void *p_context)
+{
+    (void)p_context;
+    alarm_dispatch();
+}
 
 void alarm_init(void)
 {
-    ret_code_t err_code;
-    
-    err_code = app_timer_create(&alarm_radar_timer,
-                                APP_TIMER_MODE_REPEATED,
-                                radar_timer_callback);
-    if (err_code != NRF_SUCCESS) {
-        printf("alarm_radar_timer init failed: 0x%lX\n", err_code);
+    radar_wave_len = wave_build(radar_sweep, sizeof(radar_sweep) / sizeof(radar_sweep[0]),
+                                radar_wave, RADAR_WAVE_MAX);
+    hal_err_t err_code = hal_timer_create(&alarm_coalesce_timer, false, alarm_coalesce_timer_cb);
+    if (err_code != HAL_SUCCESS) {
+        printf("alarm_coalesce_timer init failed: 0x%lX\n", (unsigned long)err_code);
     }
-    
-    err_code = app_timer_create(&alarm_temp_timer,
-                                APP_TIMER_MODE_SINGLE_SHOT,
-                                alarm_temp_timer_cb);
-    if (err_code != NRF_SUCCESS) {
-        printf("alarm_temp_timer init failed: 0x%lX\n", err_code);
+}
+
+// Builds one slice per source in mask, in priority order, and returns how
+// many times the block has to loop to fill TONE_DURATION_MS.
+static uint16_t build_tone_pattern(uint8_t mask, uint16_t *len)
+{
+    wave_segment_t segments[ALARM_SRC_COUNT];
+    uint8_t count = 0;
+    for (uint8_t src = 0; src < ALARM_SRC_COUNT; src++) {
+        if (mask & (1u << src)) {
+            wave_segment_t seg = { sources[src].freq, sources[src].freq, TONE_SLICE_MS, TONE_DUTY_PERMILLE };
+            segments[count++] = seg;
+        }
     }
-    
-    err_code = app_timer_create(&alarm_humid_timer,
-                                APP_TIMER_MODE_SINGLE_SHOT,
-                                alarm_humid_timer_cb);
-    if (err_code != NRF_SUCCESS) {
-        printf("alarm_humid_timer init failed: 0x%lX\n", err_code);
+    if (count == 1) {
+        segments[0].duration_ms = TONE_BLOCK_MS;
     }
-    
-    err_code = app_timer_create(&alarm_eco2_timer,
-                                APP_TIMER_MODE_SINGLE_SHOT,
-                                alarm_eco2_timer_cb);
-    if (err_code != NRF_SUCCESS) {
-        printf("alarm_eco2_timer init failed: 0x%lX\n", err_code);
+    *len = wave_build(segments, count, tone_wave, TONE_WAVE_MAX);
+    uint32_t block_ms = wave_duration_ms(tone_wave, *len);
+    if (block_ms == 0) {
+        return 0;
     }
+    uint32_t loops = (TONE_DURATION_MS + block_ms / 2) / block_ms;
+    return (loops == 0) ? 1 : (uint16_t)loops;
 }
 
-static void play_tone(uint16_t frequency)
+// Starts the highest-priority work if the speaker is free. The clock alarm
+// plays alone; every pending threshold source shares one alternating pattern.
+static void alarm_dispatch(void)
 {
-    nrfx_pwm_stop(&m_pwm0, true);
+    uint32_t now = timekeeping_uptime_ms();
+    uint8_t mask = 0;
+    CRITICAL_REGION_ENTER();
+    if (playing_mask == 0 && pending_mask != 0) {
+        mask = pending_mask;
+        if (mask & (1u << ALARM_SRC_CLOCK)) {
+            mask = 1u << ALARM_SRC_CLOCK;
+        }
+        pending_mask &= ~mask;
+        playing_mask = mask;
+        for (uint8_t src = 0; src < ALARM_SRC_COUNT; src++) {
+            if (mask & (1u << src)) {
+                played_once[src] = true;
+                last_played_ms[src] = now;
+                if (sources[src].latching) {
+                    latched_mask |= 1u << src;
+                }
+            }
+        }
+    }
+    CRITICAL_REGION_EXIT();
+    if (mask == 0) {
+        return;
+    }
 
-    if (frequency == 0) {
-        seq_values[0] = 0;
+    hal_err_t err_code;
+    if (mask == (1u << ALARM_SRC_CLOCK)) {
+        err_code = hal_pwm_play(radar_wave, radar_wave_len,
+                                RADAR_DURATION_MS / RADAR_SWEEP_PERIOD_MS, playback_done);
     } else {
-        uint16_t countertop = (4000000UL / frequency) - 1;
-        NRF_PWM0->COUNTERTOP = countertop;
-        seq_values[0] = countertop / 2;
+        uint16_t len;
+        uint16_t loops = build_tone_pattern(mask, &len);
+        if (loops == 0) {
+            playing_mask = 0;
+            return;
+        }
+        err_code = hal_pwm_play(tone_wave, len, loops, playback_done);
+    }
+    if (err_code != HAL_SUCCESS) {
+        printf("alarm playback failed: 0x%lX\n", (unsigned long)err_code);
+        playing_mask = 0;
     }
-
-    nrfx_pwm_simple_playback(&m_pwm0, &seq, 1, NRFX_PWM_FLAG_LOOP);
 }
 
-void radar_timer_callback(void* p_context)
+// Ignored while the source is already queued or sounding, and for latching
+// sources until alarm_clear() has been seen and the hold-off has passed.
+void alarm_raise(alarm_source_t source)
 {
-    radar_elapsed_ms += RADAR_UPDATE_INTERVAL_MS;
-    if (radar_elapsed_ms >= RADAR_DURATION_MS) {
-        app_timer_stop(alarm_radar_timer);
-        nrfx_pwm_stop(&m_pwm0, true);
+    uint8_t bit = 1u << source;
+    if ((pending_mask | playing_mask | latched_mask) & bit) {
         return;
     }
-    uint32_t t = radar_elapsed_ms % RADAR_SWEEP_PERIOD_MS;
-    float phase = (float)t / (float)RADAR_SWEEP_PERIOD_MS;
-    float value;
-    if (phase <= 0.5f) {
-        value = phase * 2.0f;
-    } else {
-        value = (1.0f - phase) * 2.0f;
+    if (sources[source].latching && played_once[source] &&
+        timekeeping_uptime_ms() - last_played_ms[source] < ALARM_HOLDOFF_MS) {
+        return;
     }
-
-    uint16_t freq = f_min + (uint16_t)(value * (f_max - f_min));
-    play_tone(freq);
-}
-
-void start_radar_alarm(void)
-{
-    radar_elapsed_ms = 0;
-    ret_code_t err_code = app_timer_start(alarm_radar_timer,
-                                          APP_TIMER_TICKS(RADAR_UPDATE_INTERVAL_MS),
-                                          NULL);
-    if (err_code != NRF_SUCCESS) {
-        printf("radar_timer start failed, error: 0x%lX\n", err_code);
+    CRITICAL_REGION_ENTER();
+    pending_mask |= bit;
+    CRITICAL_REGION_EXIT();
+    if (playing_mask == 0) {
+        hal_timer_stop(alarm_coalesce_timer);
+        hal_timer_start(alarm_coalesce_timer, HAL_MS_TO_TICKS(ALARM_COALESCE_MS), NULL);
     }
 }
 
-void start_simple_alarm(uint16_t freq, uint32_t duration_ms)
+// The condition behind source has gone away: drop a request that has not
+// started yet and re-arm a latched source.
+void alarm_clear(alarm_source_t source)
 {
-    stop_simple_alarm();
-    printf("Start single-frequency buzzer, freq=%d\n", freq);
-    uint16_t countertop = (4000000UL / freq) - 1;
-    NRF_PWM0->COUNTERTOP = countertop;
-    seq_values[0] = countertop / 2;
-    nrfx_pwm_simple_playback(&m_pwm0, &seq, 1, NRFX_PWM_FLAG_LOOP);
+    uint8_t bit = 1u << source;
+    CRITICAL_REGION_ENTER();
+    pending_mask &= ~bit;
+    latched_mask &= ~bit;
+    CRITICAL_REGION_EXIT();
 }
 
-void stop_simple_alarm(void)
+void alarm_silence(void)
 {
-    nrfx_pwm_stop(&m_pwm0, true);
+    CRITICAL_REGION_ENTER();
+    pending_mask = 0;
+    playing_mask = 0;
+    CRITICAL_REGION_EXIT();
+    hal_timer_stop(alarm_coalesce_timer);
+    hal_pwm_stop();
 }
 
-void alarm_temp_timer_cb(void* p_context) {
-    stop_simple_alarm();
-    printf("Temperature alarm playback ended\n");
-}
-void alarm_humid_timer_cb(void* p_context) {
-    stop_simple_alarm();
-    printf("Humidity alarm playback ended\n");
-}
-void alarm_eco2_timer_cb(void* p_context) {
-    stop_simple_alarm();
-    printf("eCO2 alarm playback ended\n");
-}
-
-void start_temp_alarm(void)
-{
-    // Play 500Hz, duration 2 seconds
-    start_simple_alarm(500, 2000);
-    app_timer_start(alarm_temp_timer,
-                    APP_TIMER_TICKS(2000),
-                    NULL);
-}
-void start_humid_alarm(void)
+bool alarm_playing(void)
 {
-    // Play 600Hz, duration 2 seconds
-    start_simple_alarm(600, 2000);
-    app_timer_start(alarm_humid_timer,
-                    APP_TIMER_TICKS(2000),
-                    NULL);
+    return playing_mask != 0;
 }
-void start_eco2_alarm(void)
-{
-    // Play 700Hz, duration 2 seconds
-    start_simple_alarm(700, 2000);
-    app_timer_start(alarm_eco2_timer,
-                    APP_TIMER_TICKS(2000),
-                    NULL);
-}
\ No newline at end of file
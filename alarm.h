@@ -4,23 +4,21 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
-#include "app_timer.h"
-#include "nrfx_pwm.h"
-#include "nrf_gpio.h"
 
-void start_radar_alarm(void);
-void start_temp_alarm(void);
-void start_humid_alarm(void); 
-void start_eco2_alarm(void);
+// In priority order; a higher-priority request is played first but never
+// cuts off a pattern that is already playing.
+typedef enum {
+    ALARM_SRC_CLOCK,
+    ALARM_SRC_TEMPERATURE,
+    ALARM_SRC_HUMIDITY,
+    ALARM_SRC_ECO2,
+    ALARM_SRC_COUNT
+} alarm_source_t;
 
-void start_simple_alarm(uint16_t freq, uint32_t duration_ms);
-void stop_simple_alarm(void);
-
-void radar_timer_callback(void* p_context);
-void alarm_temp_timer_cb(void* p_context);
-void alarm_humid_timer_cb(void* p_context);
-void alarm_eco2_timer_cb(void* p_context);
-
-extern nrfx_pwm_t m_pwm0;
+void alarm_init(void);
+void alarm_raise(alarm_source_t source);
+void alarm_clear(alarm_source_t source);
+void alarm_silence(void);
+bool alarm_playing(void);
 
 #endif // ALARM_H
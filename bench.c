@@ -0,0 +1,173 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bench.h"
+#include "fmt.h"
+#include "font.h"
+#include "lcd.h"
+#include "profile.h"
+#include "sensor.h"
+#include "view.h"
+
+// Drives the LCD, font and sensor-conversion hot paths with fixed inputs and
+// prints the profile report; needs -DPROFILE_ENABLED to record anything.
+// format_fixed against format_float is the integer readout against the
+// float one it replaced, on the same tick values, and glyph_blit against
+// glyph_pixels the column blitter against per-pixel drawing. view_clock and
+// view_environment are a simulated hour of each screen; count times mean is
+// the CPU time that hour costs.
+
+static void bench_lcd(uint16_t iterations) {
+    for (uint16_t i = 0; i < iterations; i++) {
+        lcdClearBuffer();
+        updateDisplay();
+        lcdFlush();
+        // Alternating pixels force every bank to be diffed and resent.
+        for (uint8_t x = (i & 1); x < LCD_WIDTH; x += 2) {
+            setPixel(x, (x * 7 + i) % LCD_HEIGHT, 1);
+        }
+        updateDisplay();
+        lcdFlush();
+    }
+}
+
+static void bench_font(uint16_t iterations) {
+    static const char *const text = "12:34:56";
+    for (uint16_t i = 0; i < iterations; i++) {
+        for (uint8_t scale = 1; scale <= 4; scale++) {
+            lcdClearBuffer();
+            drawStringScaled(text, 0, 0, scale, 1);
+        }
+    }
+}
+
+// drawCharScaled as it was before the blitter: every lit sub-pixel through setPixel.
+static void pixel_glyph(char c, uint8_t x, uint8_t y, uint8_t scale) {
+    const uint8_t *glyph = font_glyph(c);
+    for (uint8_t col = 0; col < FONT_WIDTH; col++) {
+        for (uint8_t row = 0; row < FONT_HEIGHT; row++) {
+            if (!((glyph[col] >> row) & 1)) continue;
+            for (uint8_t dx = 0; dx < scale; dx++) {
+                for (uint8_t dy = 0; dy < scale; dy++) {
+                    setPixel(x + col * scale + dx, y + row * scale + dy, 1);
+                }
+            }
+        }
+    }
+}
+
+// Clock digits at the clock face's scale, on a row that straddles banks.
+static void bench_glyph(uint16_t iterations) {
+    static const char digits[] = "0123456789:";
+    for (uint16_t i = 0; i < iterations; i++) {
+        char c = digits[i % (sizeof(digits) - 1)];
+        lcdClearBuffer();
+        PROFILE_BEGIN(PROFILE_GLYPH_BLIT);
+        drawCharScaled(c, 10, 13, 2);
+        PROFILE_END(PROFILE_GLYPH_BLIT);
+
+        lcdClearBuffer();
+        PROFILE_BEGIN(PROFILE_GLYPH_PIXELS);
+        pixel_glyph(c, 10, 13, 2);
+        PROFILE_END(PROFILE_GLYPH_PIXELS);
+    }
+}
+
+static void bench_decode(uint16_t iterations) {
+    uint8_t frame[6];
+    for (uint16_t i = 0; i < iterations; i++) {
+        uint16_t ticks = (uint16_t)(i * 2654435761UL >> 16);
+        frame[0] = ticks >> 8;
+        frame[1] = ticks & 0xFF;
+        frame[3] = ~frame[0];
+        frame[4] = ~frame[1];
+
+        PROFILE_BEGIN(PROFILE_SENSOR_DECODE);
+        frame[2] = sgp30_crc8(&frame[0], 2);
+        frame[5] = sgp30_crc8(&frame[3], 2);
+        volatile int16_t t = sht45_ticks_to_centi_celsius(ticks);
+        volatile int16_t rh = sht45_ticks_to_centi_rh((uint16_t)~ticks);
+        PROFILE_END(PROFILE_SENSOR_DECODE);
+        (void)t;
+        (void)rh;
+    }
+}
+
+static void bench_format(uint16_t iterations) {
+    char text[16];
+    volatile uint32_t sink = 0;
+    for (uint16_t i = 0; i < iterations; i++) {
+        uint16_t ticks = (uint16_t)(i * 2654435761UL >> 16);
+
+        PROFILE_BEGIN(PROFILE_FORMAT_FIXED);
+        sink += fmt_centi(text, sht45_ticks_to_centi_celsius(ticks)) - text;
+        sink += fmt_centi(text, sht45_ticks_to_centi_rh(ticks)) - text;
+        PROFILE_END(PROFILE_FORMAT_FIXED);
+
+        PROFILE_BEGIN(PROFILE_FORMAT_FLOAT);
+        sink += snprintf(text, sizeof(text), "%.2f", -45.0f + 175.0f * (float)ticks / 65535.0f);
+        sink += snprintf(text, sizeof(text), "%.2f", -6.0f + 125.0f * (float)ticks / 65535.0f);
+        PROFILE_END(PROFILE_FORMAT_FLOAT);
+    }
+    (void)sink;
+}
+
+#define HOUR_SECONDS        3600
+#define CLOCK_RENDERS_PER_S 10
+
+static void report_view(const char *screen, uint32_t *renders, uint32_t *cells) {
+    uint32_t r, c;
+    view_stats(&r, &c);
+    printf("# %s: %lu render calls, %lu cells redrawn per simulated hour\n", screen,
+           (unsigned long)(r - *renders), (unsigned long)(c - *cells));
+    *renders = r;
+    *cells = c;
+}
+
+// The clock redrawn on every UI tick, the environment screen once a second
+// with readings that wander slowly. Independent of iterations so the figures
+// are always per hour.
+static void bench_view(void) {
+    uint32_t renders, cells;
+    view_stats(&renders, &cells);
+    view_invalidate();
+    for (uint32_t t = 0; t < HOUR_SECONDS; t++) {
+        for (uint8_t i = 0; i < CLOCK_RENDERS_PER_S; i++) {
+            PROFILE_BEGIN(PROFILE_VIEW_CLOCK);
+            view_clock(12, (uint8_t)(t / 60), (uint8_t)(t % 60));
+            PROFILE_END(PROFILE_VIEW_CLOCK);
+        }
+        lcdFlush();
+    }
+    report_view("view_clock", &renders, &cells);
+
+    env_sample_t sample = { .valid = true };
+    view_invalidate();
+    for (uint32_t t = 0; t < HOUR_SECONDS; t++) {
+        sample.sequence = t;
+        sample.climate.temperature_centi = 2150 + (int32_t)(t / 7 % 40);
+        sample.climate.humidity_centi = 4500 + (int32_t)(t / 11 % 60);
+        sample.air.eco2 = (uint16_t)(400 + t / 30);
+        sample.air.tvoc = (uint16_t)(t / 120);
+        PROFILE_BEGIN(PROFILE_VIEW_ENV);
+        view_environment(&sample);
+        PROFILE_END(PROFILE_VIEW_ENV);
+        lcdFlush();
+    }
+    report_view("view_environment", &renders, &cells);
+}
+
+void bench_run(uint16_t iterations) {
+    profile_reset();
+    bench_lcd(iterations);
+    bench_font(iterations);
+    bench_glyph(iterations);
+    bench_decode(iterations);
+    bench_format(iterations);
+    bench_view();
+    profile_dump("bench");
+    profile_reset();
+
+    lcdClearBuffer();
+    view_invalidate();
+}
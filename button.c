@@ -0,0 +1,152 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "button.h"
+#include "hal.h"
+#include "timekeeping.h"
+
+#define BUTTON_A_PIN 14
+#define BUTTON_B_PIN 23
+
+#define BUTTON_DEBOUNCE_MS 20
+
+// Power of two so head/tail wrap with a mask.
+#define BUTTON_QUEUE_SIZE 16
+#define BUTTON_QUEUE_MASK (BUTTON_QUEUE_SIZE - 1)
+
+HAL_TIMER_DEF(button_a_debounce_timer);
+HAL_TIMER_DEF(button_b_debounce_timer);
+HAL_TIMER_DEF(button_a_repeat_timer);
+HAL_TIMER_DEF(button_b_repeat_timer);
+
+typedef struct {
+    uint32_t pin;
+    hal_timer_t debounce_timer;
+    hal_timer_t repeat_timer;
+    volatile uint32_t edge_ms;  // latest edge, so the settled level dates from it
+    bool pressed;
+    uint32_t press_ms;
+} button_t;
+
+static button_t buttons[BUTTON_COUNT];
+static button_notify_t notify_cb = NULL;
+
+// Single-producer/single-consumer ring: only the timer handlers push and
+// only the main loop pops, so head and tail each have exactly one writer.
+static button_event_t queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_tail = 0;
+static volatile uint32_t dropped = 0;
+
+static void queue_push(uint8_t button, uint8_t type, uint32_t timestamp_ms, uint32_t duration_ms) {
+    uint8_t head = queue_head;
+    uint8_t next = (head + 1) & BUTTON_QUEUE_MASK;
+    if (next == queue_tail) {
+        dropped++;
+        return;
+    }
+    queue[head].button = button;
+    queue[head].type = type;
+    queue[head].timestamp_ms = timestamp_ms;
+    queue[head].duration_ms = duration_ms;
+    __DMB();
+    queue_head = next;
+    if (notify_cb) {
+        notify_cb();
+    }
+}
+
+bool button_event_get(button_event_t *evt) {
+    uint8_t tail = queue_tail;
+    if (tail == queue_head) {
+        return false;
+    }
+    __DMB();
+    *evt = queue[tail];
+    __DMB();
+    queue_tail = (tail + 1) & BUTTON_QUEUE_MASK;
+    return true;
+}
+
+static void repeat_timer_cb(void *p_context) {
+    uint8_t id = (uint8_t)(uintptr_t)p_context;
+    button_t *b = &buttons[id];
+    if (!b->pressed) {
+        return;
+    }
+    queue_push(id, BUTTON_EVT_REPEAT, b->press_ms, timekeeping_uptime_ms() - b->press_ms);
+    hal_timer_start(b->repeat_timer, HAL_MS_TO_TICKS(BUTTON_REPEAT_INTERVAL_MS), p_context);
+}
+
+// Runs once the line has been quiet for BUTTON_DEBOUNCE_MS since its last edge.
+static void debounce_timer_cb(void *p_context) {
+    uint8_t id = (uint8_t)(uintptr_t)p_context;
+    button_t *b = &buttons[id];
+
+    bool pressed = !hal_gpio_read(b->pin);
+    if (pressed == b->pressed) {
+        return;
+    }
+    b->pressed = pressed;
+    if (pressed) {
+        b->press_ms = b->edge_ms;
+        hal_timer_start(b->repeat_timer, HAL_MS_TO_TICKS(BUTTON_REPEAT_DELAY_MS), p_context);
+    } else {
+        hal_timer_stop(b->repeat_timer);
+        uint32_t duration = b->edge_ms - b->press_ms;
+        queue_push(id, (duration >= BUTTON_LONG_PRESS_MS) ? BUTTON_EVT_LONG : BUTTON_EVT_SHORT,
+                   b->press_ms, duration);
+    }
+}
+
+// Every edge, bounces included, pushes the sample back, so the line is only
+// read after BUTTON_DEBOUNCE_MS without one.
+static void button_edge_handler(uint32_t pin) {
+    for (uint8_t id = 0; id < BUTTON_COUNT; id++) {
+        button_t *b = &buttons[id];
+        if (b->pin != pin) {
+            continue;
+        }
+        b->edge_ms = timekeeping_uptime_ms();
+        hal_timer_stop(b->debounce_timer);
+        hal_timer_start(b->debounce_timer, HAL_MS_TO_TICKS(BUTTON_DEBOUNCE_MS), (void *)(uintptr_t)id);
+    }
+}
+
+void buttons_init(button_notify_t notify) {
+    hal_err_t err_code;
+    notify_cb = notify;
+
+    buttons[BUTTON_A].pin = BUTTON_A_PIN;
+    buttons[BUTTON_A].debounce_timer = button_a_debounce_timer;
+    buttons[BUTTON_A].repeat_timer = button_a_repeat_timer;
+    buttons[BUTTON_B].pin = BUTTON_B_PIN;
+    buttons[BUTTON_B].debounce_timer = button_b_debounce_timer;
+    buttons[BUTTON_B].repeat_timer = button_b_repeat_timer;
+
+    for (uint8_t id = 0; id < BUTTON_COUNT; id++) {
+        button_t *b = &buttons[id];
+        err_code = hal_timer_create(&b->debounce_timer, false, debounce_timer_cb);
+        if (err_code == HAL_SUCCESS) {
+            err_code = hal_timer_create(&b->repeat_timer, false, repeat_timer_cb);
+        }
+        if (err_code != HAL_SUCCESS) {
+            printf("Button %u timer init failed: 0x%lX\n", id, (unsigned long)err_code);
+            continue;
+        }
+        err_code = hal_gpio_watch(b->pin, button_edge_handler);
+        if (err_code != HAL_SUCCESS) {
+            printf("Button %u edge watch failed: 0x%lX\n", id, (unsigned long)err_code);
+            continue;
+        }
+        b->pressed = !hal_gpio_read(b->pin);
+    }
+}
+
+bool button_is_pressed(button_id_t button) {
+    return buttons[button].pressed;
+}
+
+uint32_t button_dropped_events(void) {
+    return dropped;
+}
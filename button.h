@@ -0,0 +1,37 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BUTTON_LONG_PRESS_MS     500
+#define BUTTON_REPEAT_DELAY_MS   1000
+#define BUTTON_REPEAT_INTERVAL_MS 200
+
+typedef enum {
+    BUTTON_A,
+    BUTTON_B,
+    BUTTON_COUNT
+} button_id_t;
+
+typedef enum {
+    BUTTON_EVT_SHORT,   // released before BUTTON_LONG_PRESS_MS
+    BUTTON_EVT_LONG,    // released after BUTTON_LONG_PRESS_MS
+    BUTTON_EVT_REPEAT   // still held, every BUTTON_REPEAT_INTERVAL_MS after BUTTON_REPEAT_DELAY_MS
+} button_evt_type_t;
+
+typedef struct {
+    uint8_t button;
+    uint8_t type;
+    uint32_t timestamp_ms;  // press edge
+    uint32_t duration_ms;   // held time at release or repeat
+} button_event_t;
+
+typedef void (*button_notify_t)(void);
+
+void buttons_init(button_notify_t notify);
+bool button_event_get(button_event_t *evt);
+bool button_is_pressed(button_id_t button);
+uint32_t button_dropped_events(void);
+
+#endif
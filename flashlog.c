@@ -0,0 +1,378 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "app_util_platform.h"
+#include "nrf_fstorage.h"
+#include "nrf_fstorage_nvmc.h"
+#include "flashlog.h"
+#include "sensor.h"
+
+// Four pages just below the top of the nRF52833's 512 KB flash; the linker
+// script must keep the application image below FLASHLOG_START.
+#define FLASHLOG_PAGE_SIZE     4096
+#define FLASHLOG_PAGES         4
+#define FLASHLOG_START         (0x80000 - FLASHLOG_PAGES * FLASHLOG_PAGE_SIZE)
+#define FLASHLOG_END           (FLASHLOG_START + FLASHLOG_PAGES * FLASHLOG_PAGE_SIZE)
+
+#define FLASHLOG_MAGIC         0x474F4C46UL  // "FLOG"
+#define FLASHLOG_RECORD_SIZE   16
+#define FLASHLOG_SLOTS         (FLASHLOG_PAGE_SIZE / FLASHLOG_RECORD_SIZE)
+#define FLASHLOG_BATCH_RECORDS 8
+#define FLASHLOG_QUEUE_RECORDS 32
+
+#define FLASHLOG_REC_SAMPLE    0x01
+#define FLASHLOG_REC_SETTINGS  0x02
+
+// Slot 0 of every page; the page with the highest sequence is the active one.
+// The magic is programmed after the rest, so a header cut short by a power
+// loss never marks its page as the newest.
+typedef struct __attribute__((aligned(4))) {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t reserved[2];
+} flashlog_page_header_t;
+
+// A slot whose first word still reads 0xFFFFFFFF has never been written.
+// Word aligned because the NVMC can only program whole words from word-aligned sources.
+typedef struct __attribute__((aligned(4))) {
+    uint8_t crc;      // CRC-8 over every byte after this one
+    uint8_t type;
+    uint16_t seq;
+    uint8_t payload[12];
+} flashlog_record_t;
+
+static void flashlog_evt_handler(nrf_fstorage_evt_t *p_evt);
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t flashlog_fstorage) = {
+    .evt_handler = flashlog_evt_handler,
+    .start_addr  = FLASHLOG_START,
+    .end_addr    = FLASHLOG_END,
+};
+
+static uint8_t active_page = 0;
+static uint32_t active_sequence = 0;
+static uint16_t write_slot = FLASHLOG_SLOTS;
+static uint16_t record_seq = 0;
+
+// Records wait here until the flash is free. Samples go out in batches of
+// FLASHLOG_BATCH_RECORDS; a flush or a settings change sends whatever is queued.
+static flashlog_record_t queue[FLASHLOG_QUEUE_RECORDS];
+static uint8_t queue_head = 0;
+static uint8_t queue_tail = 0;
+static volatile uint8_t queued = 0;
+static bool flush_requested = false;
+
+// One fstorage operation is in flight at a time; its completion event
+// advances the sequence and starts the next one.
+typedef enum {
+    FLASH_IDLE,
+    FLASH_ERASE,
+    FLASH_HEADER,
+    FLASH_MAGIC,
+    FLASH_CARRY,
+    FLASH_RECORDS,
+} flash_op_t;
+
+static volatile flash_op_t op = FLASH_IDLE;
+static uint8_t op_records = 0;
+
+static flashlog_settings_t settings;
+static bool have_settings = false;
+
+static uint32_t page_addr(uint8_t page) {
+    return FLASHLOG_START + (uint32_t)page * FLASHLOG_PAGE_SIZE;
+}
+
+static uint32_t slot_addr(uint8_t page, uint16_t slot) {
+    return page_addr(page) + (uint32_t)slot * FLASHLOG_RECORD_SIZE;
+}
+
+// Flash is read through fstorage rather than by address, which with the
+// NVMC backend is the same memcpy.
+static void read_header(uint8_t page, flashlog_page_header_t *out) {
+    nrf_fstorage_read(&flashlog_fstorage, page_addr(page), out, sizeof(*out));
+}
+
+static void read_slot(uint8_t page, uint16_t slot, flashlog_record_t *out) {
+    nrf_fstorage_read(&flashlog_fstorage, slot_addr(page, slot), out, sizeof(*out));
+}
+
+static bool slot_erased(uint8_t page, uint16_t slot) {
+    uint32_t word;
+    nrf_fstorage_read(&flashlog_fstorage, slot_addr(page, slot), &word, sizeof(word));
+    return word == 0xFFFFFFFFUL;
+}
+
+static bool record_valid(const flashlog_record_t *rec) {
+    return sgp30_crc8((const uint8_t *)rec + 1, FLASHLOG_RECORD_SIZE - 1) == rec->crc;
+}
+
+static void record_seal(flashlog_record_t *rec, uint8_t type) {
+    rec->type = type;
+    rec->seq = record_seq++;
+    rec->crc = sgp30_crc8((const uint8_t *)rec + 1, FLASHLOG_RECORD_SIZE - 1);
+}
+
+static void settings_record(flashlog_record_t *rec) {
+    memset(rec, 0xFF, sizeof(*rec));
+    rec->payload[0] = settings.alarm_hours;
+    rec->payload[1] = settings.alarm_minutes;
+    rec->payload[2] = settings.alarm_enabled ? 1 : 0;
+    if (settings.baseline_valid) {
+        rec->payload[3] = 1;
+        memcpy(&rec->payload[4], &settings.baseline_eco2, 2);
+        memcpy(&rec->payload[6], &settings.baseline_tvoc, 2);
+    }
+    record_seal(rec, FLASHLOG_REC_SETTINGS);
+}
+
+// Every source buffer is static and left alone until its operation completes.
+static ret_code_t start_op(flash_op_t next_op) {
+    static flashlog_page_header_t header;
+    static flashlog_record_t carry;
+    uint8_t next_page = (active_page + 1) % FLASHLOG_PAGES;
+
+    op = next_op;
+    switch (next_op) {
+    case FLASH_ERASE:
+        return nrf_fstorage_erase(&flashlog_fstorage, page_addr(next_page), 1, NULL);
+    case FLASH_HEADER:
+        header.magic = FLASHLOG_MAGIC;
+        header.sequence = active_sequence + 1;
+        header.reserved[0] = header.reserved[1] = 0xFFFFFFFFUL;
+        return nrf_fstorage_write(&flashlog_fstorage, page_addr(next_page) + sizeof(header.magic),
+                                  &header.sequence, sizeof(header) - sizeof(header.magic), NULL);
+    case FLASH_MAGIC:
+        return nrf_fstorage_write(&flashlog_fstorage, page_addr(next_page), &header.magic,
+                                  sizeof(header.magic), NULL);
+    case FLASH_CARRY:
+        settings_record(&carry);
+        return nrf_fstorage_write(&flashlog_fstorage, slot_addr(active_page, write_slot),
+                                  &carry, FLASHLOG_RECORD_SIZE, NULL);
+    case FLASH_RECORDS:
+        return nrf_fstorage_write(&flashlog_fstorage, slot_addr(active_page, write_slot), &queue[queue_tail],
+                                  (uint32_t)op_records * FLASHLOG_RECORD_SIZE, NULL);
+    default:
+        return NRF_SUCCESS;
+    }
+}
+
+static void run_op(flash_op_t next_op) {
+    ret_code_t err_code = start_op(next_op);
+    if (err_code != NRF_SUCCESS) {
+        printf("flashlog: fstorage op %d failed to start: 0x%lX\n", next_op, (unsigned long)err_code);
+        op = FLASH_IDLE;
+    }
+}
+
+// Starts the next write when the flash is idle: a rotation to a fresh page
+// once the active one is full, otherwise the longest contiguous run of queued
+// records that fits. Rotation erases the oldest page, stamps it as the newest
+// and carries the settings over, so recovery never looks back more than one page.
+static void flash_kick(void) {
+    flash_op_t next_op = FLASH_IDLE;
+    CRITICAL_REGION_ENTER();
+    if (op == FLASH_IDLE && queued != 0 && (flush_requested || queued >= FLASHLOG_BATCH_RECORDS)) {
+        if (write_slot >= FLASHLOG_SLOTS) {
+            next_op = FLASH_ERASE;
+        } else {
+            uint16_t room = FLASHLOG_SLOTS - write_slot;
+            op_records = queued;
+            if (op_records > FLASHLOG_QUEUE_RECORDS - queue_tail) op_records = FLASHLOG_QUEUE_RECORDS - queue_tail;
+            if (op_records > room) op_records = (uint8_t)room;
+            next_op = FLASH_RECORDS;
+        }
+        op = next_op;
+    }
+    CRITICAL_REGION_EXIT();
+    if (next_op != FLASH_IDLE) {
+        run_op(next_op);
+    }
+}
+
+// Each completion starts the next operation from here, so nothing ever spins
+// on the flash. With the NVMC backend this runs inside the fstorage call that
+// started the operation; under a SoftDevice it runs from the SoC interrupt.
+static void flashlog_evt_handler(nrf_fstorage_evt_t *p_evt) {
+    bool ok = (p_evt->result == NRF_SUCCESS);
+    if (!ok) {
+        printf("flashlog: fstorage op %d at 0x%lX failed: 0x%lX\n",
+               p_evt->id, (unsigned long)p_evt->addr, (unsigned long)p_evt->result);
+    }
+
+    flash_op_t done = op;
+    op = FLASH_IDLE;
+    switch (done) {
+    case FLASH_ERASE:
+        if (ok) {
+            run_op(FLASH_HEADER);
+        }
+        return;
+    case FLASH_HEADER:
+        if (ok) {
+            run_op(FLASH_MAGIC);
+        }
+        return;
+    case FLASH_MAGIC:
+        if (ok) {
+            active_page = (active_page + 1) % FLASHLOG_PAGES;
+            active_sequence++;
+            write_slot = 1;
+            if (have_settings) {
+                run_op(FLASH_CARRY);
+                return;
+            }
+        }
+        break;
+    case FLASH_CARRY:
+        write_slot++;
+        break;
+    case FLASH_RECORDS:
+        // Slots of a failed write may be half programmed; recovery skips them
+        // by their CRC, so they are given up along with the records they held.
+        write_slot += op_records;
+        CRITICAL_REGION_ENTER();
+        queue_tail = (queue_tail + op_records) % FLASHLOG_QUEUE_RECORDS;
+        queued -= op_records;
+        if (queued == 0) {
+            flush_requested = false;
+        }
+        CRITICAL_REGION_EXIT();
+        break;
+    default:
+        return;
+    }
+    // After a failure, wait for the next append instead of retrying from here.
+    if (ok) {
+        flash_kick();
+    }
+}
+
+static void enqueue(const flashlog_record_t *rec, bool flush) {
+    bool full;
+    CRITICAL_REGION_ENTER();
+    full = (queued == FLASHLOG_QUEUE_RECORDS);
+    if (!full) {
+        queue[queue_head] = *rec;
+        queue_head = (queue_head + 1) % FLASHLOG_QUEUE_RECORDS;
+        queued++;
+    }
+    flush_requested |= flush;
+    CRITICAL_REGION_EXIT();
+    if (full) {
+        printf("flashlog: queue full, record dropped\n");
+    }
+    flash_kick();
+}
+
+// Records are appended contiguously, so the first erased slot can be found by
+// bisection instead of walking the page.
+static uint16_t find_write_slot(uint8_t page) {
+    uint16_t lo = 1, hi = FLASHLOG_SLOTS;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        if (slot_erased(page, mid)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+static bool find_settings(uint8_t page) {
+    flashlog_record_t rec;
+    for (uint16_t slot = find_write_slot(page); slot-- > 1;) {
+        read_slot(page, slot, &rec);
+        if (rec.type == FLASHLOG_REC_SETTINGS && record_valid(&rec)) {
+            settings.alarm_hours = rec.payload[0];
+            settings.alarm_minutes = rec.payload[1];
+            settings.alarm_enabled = rec.payload[2] != 0;
+            // Records written before the baseline existed leave byte 3 erased.
+            settings.baseline_valid = rec.payload[3] == 1;
+            memcpy(&settings.baseline_eco2, &rec.payload[4], 2);
+            memcpy(&settings.baseline_tvoc, &rec.payload[6], 2);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool flashlog_init(void) {
+    ret_code_t err_code = nrf_fstorage_init(&flashlog_fstorage, &nrf_fstorage_nvmc, NULL);
+    if (err_code != NRF_SUCCESS) {
+        printf("flashlog: fstorage init failed: 0x%lX\n", (unsigned long)err_code);
+        return false;
+    }
+
+    bool found = false;
+    flashlog_page_header_t hdr;
+    for (uint8_t page = 0; page < FLASHLOG_PAGES; page++) {
+        read_header(page, &hdr);
+        if (hdr.magic != FLASHLOG_MAGIC) {
+            continue;
+        }
+        if (!found || hdr.sequence > active_sequence) {
+            active_page = page;
+            active_sequence = hdr.sequence;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        printf("flashlog: no valid pages, formatting\n");
+        active_page = FLASHLOG_PAGES - 1;
+        active_sequence = 0;
+        write_slot = FLASHLOG_SLOTS;
+        run_op(FLASH_ERASE);
+        return true;
+    }
+
+    // Pages rotate round-robin, so the one before the active page holds the
+    // settings if a power cut interrupted the carry-over.
+    uint8_t previous_page = (active_page + FLASHLOG_PAGES - 1) % FLASHLOG_PAGES;
+    read_header(previous_page, &hdr);
+    write_slot = find_write_slot(active_page);
+    have_settings = find_settings(active_page) ||
+                    (hdr.magic == FLASHLOG_MAGIC && hdr.sequence + 1 == active_sequence &&
+                     find_settings(previous_page));
+    printf("flashlog: page %u seq %lu slot %u\n", active_page, (unsigned long)active_sequence, write_slot);
+    return true;
+}
+
+void flashlog_append_sample(const flashlog_sample_t *sample) {
+    flashlog_record_t rec;
+    memcpy(&rec.payload[0], &sample->timestamp_s, 4);
+    memcpy(&rec.payload[4], &sample->eco2, 2);
+    memcpy(&rec.payload[6], &sample->tvoc, 2);
+    memcpy(&rec.payload[8], &sample->temperature_ticks, 2);
+    memcpy(&rec.payload[10], &sample->humidity_ticks, 2);
+    record_seal(&rec, FLASHLOG_REC_SAMPLE);
+    enqueue(&rec, false);
+}
+
+// Returns at once; the queued records are written as the flash allows.
+void flashlog_flush(void) {
+    CRITICAL_REGION_ENTER();
+    flush_requested = (queued != 0);
+    CRITICAL_REGION_EXIT();
+    flash_kick();
+}
+
+bool flashlog_load_settings(flashlog_settings_t *out) {
+    if (!have_settings) {
+        return false;
+    }
+    *out = settings;
+    return true;
+}
+
+// Takes effect in RAM at once, so a reload straight after sees the new values.
+void flashlog_save_settings(const flashlog_settings_t *new_settings) {
+    flashlog_record_t rec;
+    settings = *new_settings;
+    have_settings = true;
+    settings_record(&rec);
+    enqueue(&rec, true);
+}
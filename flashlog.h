@@ -0,0 +1,31 @@
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t alarm_hours;
+    uint8_t alarm_minutes;
+    bool alarm_enabled;
+    bool baseline_valid;
+    uint16_t baseline_eco2;
+    uint16_t baseline_tvoc;
+} flashlog_settings_t;
+
+typedef struct {
+    uint32_t timestamp_s;  // timekeeping_wall_seconds() when the record was made
+    uint16_t eco2;
+    uint16_t tvoc;
+    uint16_t temperature_ticks;
+    uint16_t humidity_ticks;
+} flashlog_sample_t;
+
+// Writes are queued and run from the fstorage event handler; none of these wait on flash.
+bool flashlog_init(void);
+void flashlog_append_sample(const flashlog_sample_t *sample);
+void flashlog_flush(void);
+bool flashlog_load_settings(flashlog_settings_t *out);
+void flashlog_save_settings(const flashlog_settings_t *settings);
+
+#endif
@@ -0,0 +1,39 @@
+#include <stdint.h>
+#include "fmt.h"
+
+char *fmt_str(char *dst, const char *src) {
+    while (*src) {
+        *dst++ = *src++;
+    }
+    return dst;
+}
+
+char *fmt_u16(char *dst, uint16_t value) {
+    char digits[5];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) {
+        *dst++ = digits[--n];
+    }
+    return dst;
+}
+
+char *fmt_2digits(char *dst, uint8_t value) {
+    *dst++ = '0' + value / 10;
+    *dst++ = '0' + value % 10;
+    return dst;
+}
+
+// Hundredths as "[-]I.FF".
+char *fmt_centi(char *dst, int32_t centi) {
+    if (centi < 0) {
+        *dst++ = '-';
+        centi = -centi;
+    }
+    dst = fmt_u16(dst, (uint16_t)(centi / 100));
+    *dst++ = '.';
+    return fmt_2digits(dst, (uint8_t)(centi % 100));
+}
@@ -0,0 +1,12 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+// Each formatter writes at dst without a terminator and returns the end pointer.
+char *fmt_str(char *dst, const char *src);
+char *fmt_u16(char *dst, uint16_t value);
+char *fmt_2digits(char *dst, uint8_t value);
+char *fmt_centi(char *dst, int32_t centi);
+
+#endif
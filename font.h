@@ -0,0 +1,20 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+// 5x8 glyphs for printable ASCII, one byte per column with bit 0 at the top,
+// the same layout as a PCD8544 bank. Characters outside FONT_FIRST..FONT_LAST
+// draw as '?'.
+#define FONT_WIDTH  5
+#define FONT_HEIGHT 8
+#define FONT_FIRST  ' '
+#define FONT_LAST   '~'
+
+const uint8_t *font_glyph(char c);
+
+// Glyph stretched by scale in both directions, laid out as scale banks of
+// FONT_WIDTH * scale columns. Scales 1 to 3 have one; others return NULL.
+const uint8_t *font_atlas(char c, uint8_t scale);
+
+#endif
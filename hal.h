@@ -0,0 +1,66 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#ifdef HAL_HOST
+#include "hal_host.h"
+#else
+#include "hal_nrf.h"
+#endif
+
+// Board services used by the application modules. Everything here is
+// implemented by hal_nrf.c on the board and by hal_host.c in the host build;
+// handle types and tick constants come from the backend header above.
+
+typedef uint32_t hal_err_t;
+#define HAL_SUCCESS 0
+
+typedef void (*hal_timer_handler_t)(void *p_context);
+typedef void (*hal_gpio_handler_t)(uint32_t pin);
+typedef void (*hal_pwm_done_t)(void);
+typedef void (*hal_spi_done_t)(void);
+
+/* GPIO */
+void hal_gpio_output(uint32_t pin);
+void hal_gpio_write(uint32_t pin, bool high);
+bool hal_gpio_read(uint32_t pin);
+// Pulls the pin up and calls handler (in interrupt context) on every edge.
+hal_err_t hal_gpio_watch(uint32_t pin, hal_gpio_handler_t handler);
+
+/* Time */
+void hal_delay_ms(uint32_t ms);
+// Sleeps until the next interrupt or event.
+void hal_wait_event(void);
+uint32_t hal_ticks(void);
+uint32_t hal_ticks_elapsed(uint32_t now, uint32_t then);
+
+/* Timers; handlers run in interrupt context. */
+hal_err_t hal_timer_init(void);
+hal_err_t hal_timer_create(hal_timer_t const *timer, bool repeated, hal_timer_handler_t handler);
+hal_err_t hal_timer_start(hal_timer_t timer, uint32_t ticks, void *p_context);
+void hal_timer_stop(hal_timer_t timer);
+
+/* SPI, transmit only; buf must live in RAM. hal_spi_write blocks until done.
+ * The async form returns at once and calls done in interrupt context, where
+ * it may start the next transfer. */
+void hal_spi_init(void);
+hal_err_t hal_spi_write(const uint8_t *buf, uint16_t len);
+hal_err_t hal_spi_write_async(const uint8_t *buf, uint16_t len, hal_spi_done_t done);
+
+/* I2C bus setup and recovery; transfers go through i2c_sched. */
+void hal_i2c_init(void);
+// True when a slave holds SDA low on an otherwise idle bus.
+bool hal_i2c_sda_stuck(void);
+// Clocks SCL up to 9 times until SDA is released, sends a STOP and restarts
+// the controller. Only call while no transfer is queued.
+hal_err_t hal_i2c_bus_clear(void);
+
+/* PWM speaker output. Entries are read by DMA and must stay untouched until
+ * playback ends; loops == 0 repeats until hal_pwm_stop(). done runs in
+ * interrupt context once the last loop has played. */
+void hal_pwm_init(void);
+hal_err_t hal_pwm_play(const hal_pwm_entry_t *entries, uint16_t count, uint16_t loops, hal_pwm_done_t done);
+void hal_pwm_stop(void);
+
+#endif
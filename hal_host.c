@@ -0,0 +1,337 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "sdk_errors.h"
+#include "hal.h"
+
+// Every timer ever created, plus the ones standing in for SPI and PWM
+// completion interrupts. Events due at the same tick run in creation order.
+#define HOST_TIMERS_MAX 32
+#define HOST_PINS       64
+
+#define SPI_BYTES_PER_SECOND 500000UL  // 4 MHz SCK
+
+static uint64_t now_ticks = 0;
+static hal_timer_t timers[HOST_TIMERS_MAX];
+static uint8_t timer_count = 0;
+
+static bool levels[HOST_PINS];
+static uint32_t falls[HOST_PINS];
+static struct {
+    uint32_t pin;
+    hal_gpio_handler_t handler;
+} watches[HOST_PINS];
+static uint8_t watch_count = 0;
+
+HAL_TIMER_DEF(spi_timer);
+static hal_host_spi_sink_t spi_sink = NULL;
+static volatile bool spi_busy = false;
+static hal_spi_done_t spi_done = NULL;
+
+static hal_host_i2c_device_t i2c_device = NULL;
+static bool sda_stuck = false;
+static uint32_t bus_clears = 0;
+
+HAL_TIMER_DEF(pwm_timer);
+static const hal_pwm_entry_t *pwm_entries = NULL;
+static uint16_t pwm_count = 0;
+static uint16_t pwm_loops = 0;
+static hal_pwm_done_t pwm_done = NULL;
+static uint32_t pwm_starts = 0;
+
+/* Virtual time */
+
+static hal_timer_t next_timer(void) {
+    hal_timer_t next = NULL;
+    for (uint8_t i = 0; i < timer_count; i++) {
+        if (timers[i]->running && (next == NULL || timers[i]->due < next->due)) {
+            next = timers[i];
+        }
+    }
+    return next;
+}
+
+static void fire(hal_timer_t timer) {
+    now_ticks = timer->due;
+    if (timer->repeated) {
+        timer->due += timer->period;
+    } else {
+        timer->running = false;
+    }
+    timer->handler(timer->p_context);
+}
+
+uint64_t hal_host_now(void) {
+    return now_ticks;
+}
+
+void hal_host_advance(uint32_t ticks) {
+    uint64_t target = now_ticks + ticks;
+    hal_timer_t timer;
+    while ((timer = next_timer()) != NULL && timer->due <= target) {
+        fire(timer);
+    }
+    now_ticks = target;
+}
+
+bool hal_host_step(void) {
+    hal_timer_t timer = next_timer();
+    if (timer == NULL) {
+        return false;
+    }
+    fire(timer);
+    return true;
+}
+
+/* GPIO */
+
+void hal_gpio_output(uint32_t pin) {
+    (void)pin;
+}
+
+void hal_gpio_write(uint32_t pin, bool high) {
+    if (levels[pin % HOST_PINS] && !high) {
+        falls[pin % HOST_PINS]++;
+    }
+    levels[pin % HOST_PINS] = high;
+}
+
+bool hal_gpio_read(uint32_t pin) {
+    return levels[pin % HOST_PINS];
+}
+
+hal_err_t hal_gpio_watch(uint32_t pin, hal_gpio_handler_t handler) {
+    if (watch_count == HOST_PINS) {
+        return NRF_ERROR_NO_MEM;
+    }
+    levels[pin % HOST_PINS] = true;  // pulled up
+    watches[watch_count].pin = pin;
+    watches[watch_count].handler = handler;
+    watch_count++;
+    return HAL_SUCCESS;
+}
+
+void hal_host_gpio_input(uint32_t pin, bool high) {
+    if (levels[pin % HOST_PINS] == high) {
+        return;
+    }
+    levels[pin % HOST_PINS] = high;
+    for (uint8_t i = 0; i < watch_count; i++) {
+        if (watches[i].pin == pin) {
+            watches[i].handler(pin);
+        }
+    }
+}
+
+uint32_t hal_host_gpio_falls(uint32_t pin) {
+    return falls[pin % HOST_PINS];
+}
+
+/* Time */
+
+void hal_delay_ms(uint32_t ms) {
+    hal_host_advance(HAL_MS_TO_TICKS(ms));
+}
+
+// Nothing runs between events, so sleeping is jumping straight to the next one.
+void hal_wait_event(void) {
+    hal_host_step();
+}
+
+uint32_t hal_ticks(void) {
+    return (uint32_t)now_ticks & HAL_TICKS_MASK;
+}
+
+uint32_t hal_ticks_elapsed(uint32_t now, uint32_t then) {
+    return (now - then) & HAL_TICKS_MASK;
+}
+
+/* Timers */
+
+hal_err_t hal_timer_init(void) {
+    return HAL_SUCCESS;
+}
+
+hal_err_t hal_timer_create(hal_timer_t const *timer, bool repeated, hal_timer_handler_t handler) {
+    hal_timer_t t = *timer;
+    bool known = false;
+    for (uint8_t i = 0; i < timer_count; i++) {
+        known |= (timers[i] == t);
+    }
+    if (!known) {
+        if (timer_count == HOST_TIMERS_MAX) {
+            return NRF_ERROR_NO_MEM;
+        }
+        timers[timer_count++] = t;
+    }
+    t->handler = handler;
+    t->repeated = repeated;
+    t->running = false;
+    return HAL_SUCCESS;
+}
+
+hal_err_t hal_timer_start(hal_timer_t timer, uint32_t ticks, void *p_context) {
+    if (timer->handler == NULL) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (ticks < HAL_TIMER_MIN_TICKS) {
+        ticks = HAL_TIMER_MIN_TICKS;
+    }
+    timer->p_context = p_context;
+    timer->due = now_ticks + ticks;
+    timer->period = ticks;
+    timer->running = true;
+    return HAL_SUCCESS;
+}
+
+void hal_timer_stop(hal_timer_t timer) {
+    timer->running = false;
+}
+
+/* SPI */
+
+static void spi_timer_cb(void *p_context) {
+    (void)p_context;
+    hal_spi_done_t done = spi_done;
+    spi_done = NULL;
+    spi_busy = false;
+    if (done) {
+        done();
+    }
+}
+
+void hal_spi_init(void) {
+    hal_timer_create(&spi_timer, false, spi_timer_cb);
+}
+
+void hal_host_spi_attach(hal_host_spi_sink_t sink) {
+    spi_sink = sink;
+}
+
+hal_err_t hal_spi_write_async(const uint8_t *buf, uint16_t len, hal_spi_done_t done) {
+    if (spi_busy) {
+        return NRF_ERROR_BUSY;
+    }
+    if (spi_sink) {
+        spi_sink(buf, len);
+    }
+    uint32_t ticks = (uint32_t)(((uint64_t)len * HAL_TICKS_PER_SECOND + SPI_BYTES_PER_SECOND - 1) /
+                                SPI_BYTES_PER_SECOND);
+    spi_busy = true;
+    spi_done = done;
+    // Below the timer minimum on purpose: short transfers finish within a tick or two.
+    spi_timer->p_context = NULL;
+    spi_timer->due = now_ticks + (ticks ? ticks : 1);
+    spi_timer->running = true;
+    return HAL_SUCCESS;
+}
+
+hal_err_t hal_spi_write(const uint8_t *buf, uint16_t len) {
+    hal_err_t err_code = hal_spi_write_async(buf, len, NULL);
+    if (err_code != HAL_SUCCESS) {
+        return err_code;
+    }
+    while (spi_busy) {
+        hal_wait_event();
+    }
+    return HAL_SUCCESS;
+}
+
+/* I2C */
+
+void hal_i2c_init(void) {
+}
+
+void hal_host_i2c_attach(hal_host_i2c_device_t device) {
+    i2c_device = device;
+}
+
+uint32_t hal_host_i2c_transfer(uint8_t addr, bool read, uint8_t *data, uint8_t len) {
+    if (sda_stuck) {
+        if (read) {
+            memset(data, 0, len);
+        }
+        return NRF_SUCCESS;
+    }
+    if (i2c_device == NULL) {
+        return NRF_ERROR_DRV_TWI_ERR_ANACK;
+    }
+    return i2c_device(addr, read, data, len);
+}
+
+void hal_host_i2c_stick_sda(bool stuck) {
+    sda_stuck = stuck;
+}
+
+uint32_t hal_host_i2c_bus_clears(void) {
+    return bus_clears;
+}
+
+bool hal_i2c_sda_stuck(void) {
+    return sda_stuck;
+}
+
+// The nine clocks always free a slave that is merely mid-byte.
+hal_err_t hal_i2c_bus_clear(void) {
+    bus_clears++;
+    sda_stuck = false;
+    return HAL_SUCCESS;
+}
+
+/* PWM */
+
+static void pwm_timer_cb(void *p_context) {
+    (void)p_context;
+    hal_pwm_done_t done = pwm_done;
+    pwm_entries = NULL;
+    pwm_done = NULL;
+    if (done) {
+        done();
+    }
+}
+
+void hal_pwm_init(void) {
+    hal_timer_create(&pwm_timer, false, pwm_timer_cb);
+}
+
+hal_err_t hal_pwm_play(const hal_pwm_entry_t *entries, uint16_t count, uint16_t loops, hal_pwm_done_t done) {
+    hal_pwm_stop();
+    if (count == 0) {
+        return HAL_SUCCESS;
+    }
+    pwm_entries = entries;
+    pwm_count = count;
+    pwm_loops = loops;
+    pwm_done = done;
+    pwm_starts++;
+    if (loops == 0) {
+        return HAL_SUCCESS;
+    }
+    uint64_t clocks = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        clocks += (uint64_t)HAL_PWM_PERIODS_PER_ENTRY * (entries[i].counter_top + 1);
+    }
+    clocks *= loops;
+    pwm_timer->p_context = NULL;
+    pwm_timer->due = now_ticks + (clocks * HAL_TICKS_PER_SECOND + HAL_PWM_CLOCK_HZ - 1) / HAL_PWM_CLOCK_HZ;
+    pwm_timer->running = true;
+    return HAL_SUCCESS;
+}
+
+void hal_pwm_stop(void) {
+    pwm_done = NULL;
+    pwm_entries = NULL;
+    hal_timer_stop(pwm_timer);
+}
+
+const hal_pwm_entry_t *hal_host_pwm_playing(uint16_t *count, uint16_t *loops) {
+    if (pwm_entries) {
+        *count = pwm_count;
+        *loops = pwm_loops;
+    }
+    return pwm_entries;
+}
+
+uint32_t hal_host_pwm_starts(void) {
+    return pwm_starts;
+}
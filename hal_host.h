@@ -0,0 +1,80 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// POSIX simulation types and constants behind hal.h, selected with -DHAL_HOST.
+// Time is virtual: it only moves when a test advances it or the code under
+// test waits, so simulated hours run in milliseconds.
+
+#define HAL_TICKS_PER_SECOND    32768UL
+#define HAL_TICKS_MASK          0x00FFFFFFUL  // as wide as the nRF RTC, so wrap handling gets exercised
+#define HAL_MS_TO_TICKS(ms)     ((uint32_t)(((uint64_t)(ms) * HAL_TICKS_PER_SECOND) / 1000))
+#define HAL_TIMER_MIN_TICKS     5
+#define HAL_TIMER_MAX_TICKS     (HAL_TICKS_MASK >> 1)
+
+struct hal_host_timer_s {
+    void (*handler)(void *p_context);
+    void *p_context;
+    uint64_t due;
+    uint32_t period;
+    bool repeated;
+    bool running;
+};
+
+typedef struct hal_host_timer_s *hal_timer_t;
+#define HAL_TIMER_DEF(name) \
+    static struct hal_host_timer_s name##_data; \
+    static hal_timer_t name = &name##_data
+
+#define HAL_PWM_CLOCK_HZ          4000000UL
+#define HAL_PWM_PERIODS_PER_ENTRY 10
+
+typedef struct {
+    uint16_t compare;
+    uint16_t counter_top;
+} hal_pwm_entry_t;
+
+static inline void hal_pwm_entry_set(hal_pwm_entry_t *entry, uint16_t top, uint16_t compare) {
+    entry->compare = compare;
+    entry->counter_top = top;
+}
+
+// The interrupt-shared queues order their accesses with the CMSIS barrier.
+static inline void __DMB(void) {
+    __sync_synchronize();
+}
+
+/* Test controls */
+
+// Virtual ticks since start, never wrapped.
+uint64_t hal_host_now(void);
+// Moves time forward, running every timer and completion that falls due.
+void hal_host_advance(uint32_t ticks);
+// Jumps to the next pending timer or completion and runs it; false if none.
+bool hal_host_step(void);
+
+// Drives an input pin as a button or sensor would; watched pins see the edge.
+void hal_host_gpio_input(uint32_t pin, bool high);
+// High-to-low writes to an output pin so far, such as chip selects.
+uint32_t hal_host_gpio_falls(uint32_t pin);
+
+// Receives every SPI transfer as it starts, while the caller's pins still
+// hold the state they set up for it.
+typedef void (*hal_host_spi_sink_t)(const uint8_t *buf, uint16_t len);
+void hal_host_spi_attach(hal_host_spi_sink_t sink);
+
+// Bus devices answer every I2C transfer; without one every address NACKs.
+// A stuck SDA line reads as ACKs and zero bytes, as it does on a real TWIM.
+typedef uint32_t (*hal_host_i2c_device_t)(uint8_t addr, bool read, uint8_t *data, uint8_t len);
+void hal_host_i2c_attach(hal_host_i2c_device_t device);
+uint32_t hal_host_i2c_transfer(uint8_t addr, bool read, uint8_t *data, uint8_t len);
+void hal_host_i2c_stick_sda(bool stuck);
+uint32_t hal_host_i2c_bus_clears(void);
+
+// What the speaker is playing; NULL when it is silent.
+const hal_pwm_entry_t *hal_host_pwm_playing(uint16_t *count, uint16_t *loops);
+uint32_t hal_host_pwm_starts(void);
+
+#endif
@@ -0,0 +1,298 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "microbit_v2.h"
+#include "nrf_delay.h"
+#include "nrf_drv_twi.h"
+#include "nrf_gpio.h"
+#include "nrf_twi_mngr.h"
+#include "nrfx_gpiote.h"
+#include "nrfx_pwm.h"
+#include "nrfx_spim.h"
+#include "hal.h"
+
+// Both the SGP30 and SHT45 support fast mode; override with -DI2C_BUS_FREQUENCY=...
+#ifndef I2C_BUS_FREQUENCY
+#define I2C_BUS_FREQUENCY NRF_TWIM_FREQ_100K
+#endif
+
+#define HAL_GPIO_WATCH_MAX 4
+// Half an SCL period for the bus-clear pulses, about 100 kHz.
+#define I2C_CLEAR_HALF_PERIOD_US 5
+#define I2C_CLEAR_PULSES 9
+
+// i2c_sched drives the same manager asynchronously.
+const nrf_twi_mngr_t* i2c_manager = NULL;
+NRF_TWI_MNGR_DEF(twi_mngr_instance, 4, 0);
+
+static const nrfx_spim_t SPIM_INST = NRFX_SPIM_INSTANCE(2);
+static volatile bool spi_xfer_done = false;
+static volatile hal_spi_done_t spi_done = NULL;
+
+static nrfx_pwm_t m_pwm0 = NRFX_PWM_INSTANCE(0);
+static nrf_pwm_sequence_t pwm_seq;
+static volatile hal_pwm_done_t pwm_done = NULL;
+
+static struct {
+    uint32_t pin;
+    hal_gpio_handler_t handler;
+} watches[HAL_GPIO_WATCH_MAX];
+static uint8_t watch_count = 0;
+
+/* GPIO */
+
+void hal_gpio_output(uint32_t pin) {
+    nrf_gpio_cfg_output(pin);
+}
+
+void hal_gpio_write(uint32_t pin, bool high) {
+    nrf_gpio_pin_write(pin, high ? 1 : 0);
+}
+
+bool hal_gpio_read(uint32_t pin) {
+    return nrf_gpio_pin_read(pin) != 0;
+}
+
+static void gpiote_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
+    (void)action;
+    for (uint8_t i = 0; i < watch_count; i++) {
+        if (watches[i].pin == pin) {
+            watches[i].handler(pin);
+        }
+    }
+}
+
+hal_err_t hal_gpio_watch(uint32_t pin, hal_gpio_handler_t handler) {
+    if (watch_count == HAL_GPIO_WATCH_MAX) {
+        return NRF_ERROR_NO_MEM;
+    }
+    if (!nrfx_gpiote_is_init()) {
+        nrfx_err_t err_code = nrfx_gpiote_init();
+        if (err_code != NRFX_SUCCESS) {
+            return err_code;
+        }
+    }
+    // PORT-event sensing keeps the high-frequency clock off while we sleep.
+    nrfx_gpiote_in_config_t in_config = NRFX_GPIOTE_CONFIG_IN_SENSE_TOGGLE(false);
+    in_config.pull = NRF_GPIO_PIN_PULLUP;
+    nrfx_err_t err_code = nrfx_gpiote_in_init(pin, &in_config, gpiote_handler);
+    if (err_code != NRFX_SUCCESS) {
+        return err_code;
+    }
+    watches[watch_count].pin = pin;
+    watches[watch_count].handler = handler;
+    watch_count++;
+    nrfx_gpiote_in_event_enable(pin, true);
+    return HAL_SUCCESS;
+}
+
+/* Time */
+
+void hal_delay_ms(uint32_t ms) {
+    nrf_delay_ms(ms);
+}
+
+void hal_wait_event(void) {
+    __WFE();
+}
+
+uint32_t hal_ticks(void) {
+    return app_timer_cnt_get() & HAL_TICKS_MASK;
+}
+
+uint32_t hal_ticks_elapsed(uint32_t now, uint32_t then) {
+    return (now - then) & HAL_TICKS_MASK;
+}
+
+/* Timers */
+
+hal_err_t hal_timer_init(void) {
+    return app_timer_init();
+}
+
+hal_err_t hal_timer_create(hal_timer_t const *timer, bool repeated, hal_timer_handler_t handler) {
+    return app_timer_create(timer, repeated ? APP_TIMER_MODE_REPEATED : APP_TIMER_MODE_SINGLE_SHOT, handler);
+}
+
+hal_err_t hal_timer_start(hal_timer_t timer, uint32_t ticks, void *p_context) {
+    if (ticks < HAL_TIMER_MIN_TICKS) {
+        ticks = HAL_TIMER_MIN_TICKS;
+    }
+    return app_timer_start(timer, ticks, p_context);
+}
+
+void hal_timer_stop(hal_timer_t timer) {
+    app_timer_stop(timer);
+}
+
+/* SPI */
+
+static void spim_event_handler(nrfx_spim_evt_t const * p_event, void * p_context) {
+    (void)p_context;
+    if (p_event->type == NRFX_SPIM_EVENT_DONE) {
+        hal_spi_done_t done = spi_done;
+        spi_done = NULL;
+        spi_xfer_done = true;
+        if (done) {
+            done();
+        }
+    }
+}
+
+void hal_spi_init(void) {
+    nrfx_spim_config_t spim_config = NRFX_SPIM_DEFAULT_CONFIG;
+    spim_config.sck_pin = EDGE_P13;
+    spim_config.mosi_pin = EDGE_P15;
+    spim_config.miso_pin = EDGE_P14;
+    spim_config.irq_priority = 0;
+    spim_config.frequency = NRF_SPIM_FREQ_4M;
+    spim_config.mode = NRF_SPIM_MODE_0;
+
+    nrfx_err_t err_code = nrfx_spim_init(&SPIM_INST, &spim_config, spim_event_handler, NULL);
+    if (err_code != NRFX_SUCCESS) {
+        printf("SPI init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
+
+hal_err_t hal_spi_write_async(const uint8_t *buf, uint16_t len, hal_spi_done_t done) {
+    // One EasyDMA transaction for the whole buffer.
+    nrfx_spim_xfer_desc_t xfer = NRFX_SPIM_XFER_TX(buf, len);
+    spi_xfer_done = false;
+    spi_done = done;
+    nrfx_err_t err_code = nrfx_spim_xfer(&SPIM_INST, &xfer, 0);
+    if (err_code != NRFX_SUCCESS) {
+        spi_done = NULL;
+        return err_code;
+    }
+    return HAL_SUCCESS;
+}
+
+hal_err_t hal_spi_write(const uint8_t *buf, uint16_t len) {
+    hal_err_t err_code = hal_spi_write_async(buf, len, NULL);
+    if (err_code != HAL_SUCCESS) {
+        return err_code;
+    }
+    while (!spi_xfer_done) {
+        __WFE();
+    }
+    return HAL_SUCCESS;
+}
+
+/* I2C */
+
+void hal_i2c_init(void) {
+    nrf_drv_twi_config_t twi_config = NRF_DRV_TWI_DEFAULT_CONFIG;
+    twi_config.scl = I2C_QWIIC_SCL;
+    twi_config.sda = I2C_QWIIC_SDA;
+    twi_config.frequency = I2C_BUS_FREQUENCY;
+    twi_config.interrupt_priority = 0;
+    ret_code_t err_code = nrf_twi_mngr_init(&twi_mngr_instance, &twi_config);
+    if (err_code != NRF_SUCCESS) {
+        printf("TWI manager init failed: 0x%lX\n", (unsigned long)err_code);
+        return;
+    }
+    i2c_manager = &twi_mngr_instance;
+}
+
+bool hal_i2c_sda_stuck(void) {
+    return nrf_gpio_pin_read(I2C_QWIIC_SCL) != 0 && nrf_gpio_pin_read(I2C_QWIIC_SDA) == 0;
+}
+
+static void i2c_pin_release(uint32_t pin) {
+    nrf_gpio_pin_set(pin);
+    nrf_gpio_cfg(pin, NRF_GPIO_PIN_DIR_OUTPUT, NRF_GPIO_PIN_INPUT_CONNECT,
+                 NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_S0D1, NRF_GPIO_PIN_NOSENSE);
+}
+
+// i2c_manager stays NULL if the re-init fails; i2c_sched refuses work until
+// the next clear brings the manager back.
+hal_err_t hal_i2c_bus_clear(void) {
+    if (i2c_manager != NULL) {
+        if (!nrf_twi_mngr_is_idle(i2c_manager)) {
+            return NRF_ERROR_BUSY;
+        }
+        nrf_twi_mngr_uninit(&twi_mngr_instance);
+        i2c_manager = NULL;
+    }
+
+    // Open-drain by hand: a slave stuck mid-byte lets go of SDA once it has
+    // clocked out the rest of it.
+    i2c_pin_release(I2C_QWIIC_SCL);
+    i2c_pin_release(I2C_QWIIC_SDA);
+    nrf_delay_us(I2C_CLEAR_HALF_PERIOD_US);
+    for (uint8_t i = 0; i < I2C_CLEAR_PULSES && nrf_gpio_pin_read(I2C_QWIIC_SDA) == 0; i++) {
+        nrf_gpio_pin_clear(I2C_QWIIC_SCL);
+        nrf_delay_us(I2C_CLEAR_HALF_PERIOD_US);
+        nrf_gpio_pin_set(I2C_QWIIC_SCL);
+        nrf_delay_us(I2C_CLEAR_HALF_PERIOD_US);
+    }
+    // STOP: SDA rises while SCL is high.
+    nrf_gpio_pin_clear(I2C_QWIIC_SCL);
+    nrf_gpio_pin_clear(I2C_QWIIC_SDA);
+    nrf_delay_us(I2C_CLEAR_HALF_PERIOD_US);
+    nrf_gpio_pin_set(I2C_QWIIC_SCL);
+    nrf_delay_us(I2C_CLEAR_HALF_PERIOD_US);
+    nrf_gpio_pin_set(I2C_QWIIC_SDA);
+    nrf_delay_us(I2C_CLEAR_HALF_PERIOD_US);
+    bool released = nrf_gpio_pin_read(I2C_QWIIC_SDA) != 0;
+
+    hal_i2c_init();
+    if (i2c_manager == NULL) {
+        return NRF_ERROR_INTERNAL;
+    }
+    return released ? HAL_SUCCESS : NRF_ERROR_TIMEOUT;
+}
+
+/* PWM */
+
+static void pwm_event_handler(nrfx_pwm_evt_type_t event_type) {
+    if (event_type == NRFX_PWM_EVT_FINISHED) {
+        hal_pwm_done_t done = pwm_done;
+        pwm_done = NULL;
+        if (done) {
+            done();
+        }
+    }
+}
+
+void hal_pwm_init(void) {
+    nrfx_pwm_config_t pwm_config = {
+        .output_pins = {
+            EDGE_P3,
+            EDGE_P4,
+            NRFX_PWM_PIN_NOT_USED,
+            NRFX_PWM_PIN_NOT_USED
+        },
+        .irq_priority = APP_IRQ_PRIORITY_LOWEST,
+        .base_clock   = NRF_PWM_CLK_4MHz,
+        .count_mode   = NRF_PWM_MODE_UP,
+        .top_value    = 0,
+        .load_mode    = NRF_PWM_LOAD_WAVE_FORM,
+        .step_mode    = NRF_PWM_STEP_AUTO
+    };
+    nrfx_err_t err_code = nrfx_pwm_init(&m_pwm0, &pwm_config, pwm_event_handler);
+    if (err_code != NRFX_SUCCESS) {
+        printf("PWM init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
+
+hal_err_t hal_pwm_play(const hal_pwm_entry_t *entries, uint16_t count, uint16_t loops, hal_pwm_done_t done) {
+    nrfx_pwm_stop(&m_pwm0, true);
+    if (count == 0) {
+        return HAL_SUCCESS;
+    }
+    pwm_seq.values.p_wave_form = (nrf_pwm_values_wave_form_t *)entries;
+    pwm_seq.length = count * 4;  // length counts 16-bit words
+    pwm_seq.repeats = HAL_PWM_PERIODS_PER_ENTRY - 1;
+    pwm_seq.end_delay = 0;
+    pwm_done = done;
+    uint32_t flags = (loops == 0) ? NRFX_PWM_FLAG_LOOP : NRFX_PWM_FLAG_STOP;
+    return nrfx_pwm_simple_playback(&m_pwm0, &pwm_seq, (loops == 0) ? 1 : loops, flags);
+}
+
+void hal_pwm_stop(void) {
+    pwm_done = NULL;
+    nrfx_pwm_stop(&m_pwm0, true);
+}
@@ -0,0 +1,34 @@
+#ifndef HAL_NRF_H
+#define HAL_NRF_H
+
+#include <stdint.h>
+#include "app_timer.h"
+#include "nrfx_pwm.h"
+
+// nRF52833 types and constants behind hal.h. Another backend provides
+// the same names with its own types.
+
+#define HAL_TICKS_PER_SECOND    APP_TIMER_CLOCK_FREQ
+#define HAL_TICKS_MASK          0x00FFFFFFUL  // the RTC counter is 24 bits wide
+#define HAL_MS_TO_TICKS(ms)     APP_TIMER_TICKS(ms)
+#define HAL_TIMER_MIN_TICKS     APP_TIMER_MIN_TIMEOUT_TICKS
+#define HAL_TIMER_MAX_TICKS     (HAL_TICKS_MASK >> 1)  // app_timer only looks half the counter ahead
+
+typedef app_timer_id_t hal_timer_t;
+#define HAL_TIMER_DEF(name)     APP_TIMER_DEF(name)
+
+// PWM runs in wave-form load mode: every entry carries its own period, and
+// the decoder holds it for HAL_PWM_PERIODS_PER_ENTRY periods before the next.
+#define HAL_PWM_CLOCK_HZ          4000000UL
+#define HAL_PWM_PERIODS_PER_ENTRY 10
+
+typedef nrf_pwm_values_wave_form_t hal_pwm_entry_t;
+
+static inline void hal_pwm_entry_set(hal_pwm_entry_t *entry, uint16_t top, uint16_t compare) {
+    entry->channel_0 = compare;
+    entry->channel_1 = compare;
+    entry->channel_2 = 0;
+    entry->counter_top = top;
+}
+
+#endif
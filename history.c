@@ -0,0 +1,315 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "history.h"
+
+// Memory is fixed at build time:
+//   raw deltas      60 x 4 x 2 B   =  480 B
+//   minute buckets  60 x 4 x 6 B   = 1440 B
+//   quarter buckets 96 x 4 x 6 B   = 2304 B
+//   window deques  216 x 4 x 2 x 4 B = 6912 B
+
+typedef struct {
+    uint16_t value;
+    uint16_t seq;
+} window_entry_t;
+
+// Sliding min/max/sum over the last len pushes. The monotonic deques make
+// both push and query O(1) amortised.
+typedef struct {
+    window_entry_t *min_q;
+    window_entry_t *max_q;
+    uint16_t len;
+    uint16_t min_head, min_n;
+    uint16_t max_head, max_n;
+    uint16_t seq;
+    uint16_t count;
+    uint32_t sum;
+} window_t;
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    uint16_t count;
+} accumulator_t;
+
+static window_entry_t raw_min_q[HISTORY_CHANNELS][HISTORY_RAW_LEN];
+static window_entry_t raw_max_q[HISTORY_CHANNELS][HISTORY_RAW_LEN];
+static window_entry_t minute_min_q[HISTORY_CHANNELS][HISTORY_MINUTE_LEN];
+static window_entry_t minute_max_q[HISTORY_CHANNELS][HISTORY_MINUTE_LEN];
+static window_entry_t quarter_min_q[HISTORY_CHANNELS][HISTORY_QUARTER_LEN];
+static window_entry_t quarter_max_q[HISTORY_CHANNELS][HISTORY_QUARTER_LEN];
+static window_t windows[HISTORY_WINDOWS][HISTORY_CHANNELS];
+
+// Raw tier: each record is the delta from the previous sample modulo 2^16;
+// anchor is the value of the oldest record still held and last the newest.
+static int16_t raw_delta[HISTORY_RAW_LEN][HISTORY_CHANNELS];
+static uint16_t raw_anchor[HISTORY_CHANNELS];
+static uint16_t raw_last[HISTORY_CHANNELS];
+static uint16_t raw_head = 0;
+static uint16_t raw_count = 0;
+static uint32_t raw_total = 0;
+
+static history_bucket_t minute_buckets[HISTORY_MINUTE_LEN][HISTORY_CHANNELS];
+static uint16_t minute_head = 0;
+static uint16_t minute_count = 0;
+static uint32_t minutes_total = 0;
+static history_bucket_t quarter_buckets[HISTORY_QUARTER_LEN][HISTORY_CHANNELS];
+static uint16_t quarter_head = 0;
+static uint16_t quarter_count = 0;
+static uint32_t quarters_total = 0;
+
+// Only fresh readings are accumulated, so the rollups count time separately.
+static accumulator_t minute_acc[HISTORY_CHANNELS];
+static accumulator_t quarter_acc[HISTORY_CHANNELS];
+static uint16_t minute_samples = 0;
+static uint16_t quarter_minutes = 0;
+
+static void window_init(window_t *w, window_entry_t *min_q, window_entry_t *max_q, uint16_t len) {
+    memset(w, 0, sizeof(*w));
+    w->min_q = min_q;
+    w->max_q = max_q;
+    w->len = len;
+}
+
+static void window_push(window_t *w, uint16_t min, uint16_t max, uint16_t avg, uint16_t evicted_avg) {
+    uint16_t seq = w->seq++;
+
+    w->sum += avg;
+    if (w->count == w->len) {
+        w->sum -= evicted_avg;
+    } else {
+        w->count++;
+    }
+
+    while (w->min_n && (uint16_t)(seq - w->min_q[w->min_head].seq) >= w->len) {
+        w->min_head = (w->min_head + 1) % w->len;
+        w->min_n--;
+    }
+    while (w->min_n && w->min_q[(w->min_head + w->min_n - 1) % w->len].value >= min) {
+        w->min_n--;
+    }
+    w->min_q[(w->min_head + w->min_n++) % w->len] = (window_entry_t){ min, seq };
+
+    while (w->max_n && (uint16_t)(seq - w->max_q[w->max_head].seq) >= w->len) {
+        w->max_head = (w->max_head + 1) % w->len;
+        w->max_n--;
+    }
+    while (w->max_n && w->max_q[(w->max_head + w->max_n - 1) % w->len].value <= max) {
+        w->max_n--;
+    }
+    w->max_q[(w->max_head + w->max_n++) % w->len] = (window_entry_t){ max, seq };
+}
+
+static void accumulator_reset(accumulator_t *acc) {
+    acc->min = UINT16_MAX;
+    acc->max = 0;
+    acc->sum = 0;
+    acc->count = 0;
+}
+
+static void accumulator_add(accumulator_t *acc, uint16_t min, uint16_t max, uint16_t avg) {
+    if (min < acc->min) acc->min = min;
+    if (max > acc->max) acc->max = max;
+    acc->sum += avg;
+    acc->count++;
+}
+
+static history_bucket_t accumulator_bucket(const accumulator_t *acc) {
+    history_bucket_t b = { acc->min, acc->max, (uint16_t)((acc->sum + acc->count / 2) / acc->count) };
+    return b;
+}
+
+void history_init(void) {
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        window_init(&windows[HISTORY_WINDOW_MINUTE][ch], raw_min_q[ch], raw_max_q[ch], HISTORY_RAW_LEN);
+        window_init(&windows[HISTORY_WINDOW_HOUR][ch], minute_min_q[ch], minute_max_q[ch], HISTORY_MINUTE_LEN);
+        window_init(&windows[HISTORY_WINDOW_DAY][ch], quarter_min_q[ch], quarter_max_q[ch], HISTORY_QUARTER_LEN);
+        accumulator_reset(&minute_acc[ch]);
+        accumulator_reset(&quarter_acc[ch]);
+    }
+    raw_head = raw_count = 0;
+    minute_head = minute_count = 0;
+    quarter_head = quarter_count = 0;
+    raw_total = minutes_total = quarters_total = 0;
+    minute_samples = quarter_minutes = 0;
+}
+
+// A bucket with no fresh reading in it repeats the one before, so every
+// tier still moves one entry per step.
+static void push_quarter(void) {
+    uint16_t slot = quarter_head;
+    uint16_t prev_slot = (quarter_head + HISTORY_QUARTER_LEN - 1) % HISTORY_QUARTER_LEN;
+    uint16_t last_minute = (minute_head + HISTORY_MINUTE_LEN - 1) % HISTORY_MINUTE_LEN;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        history_bucket_t b = quarter_acc[ch].count ? accumulator_bucket(&quarter_acc[ch]) :
+                             quarter_count ? quarter_buckets[prev_slot][ch] :
+                                             minute_buckets[last_minute][ch];
+        uint16_t evicted = quarter_buckets[slot][ch].avg;
+        quarter_buckets[slot][ch] = b;
+        window_push(&windows[HISTORY_WINDOW_DAY][ch], b.min, b.max, b.avg, evicted);
+        accumulator_reset(&quarter_acc[ch]);
+    }
+    quarter_head = (quarter_head + 1) % HISTORY_QUARTER_LEN;
+    if (quarter_count < HISTORY_QUARTER_LEN) quarter_count++;
+    quarters_total++;
+}
+
+static void push_minute(void) {
+    uint16_t slot = minute_head;
+    uint16_t prev_slot = (minute_head + HISTORY_MINUTE_LEN - 1) % HISTORY_MINUTE_LEN;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        bool fresh = minute_acc[ch].count != 0;
+        history_bucket_t held = { raw_last[ch], raw_last[ch], raw_last[ch] };
+        if (minute_count) held = minute_buckets[prev_slot][ch];
+        history_bucket_t b = fresh ? accumulator_bucket(&minute_acc[ch]) : held;
+        uint16_t evicted = minute_buckets[slot][ch].avg;
+        minute_buckets[slot][ch] = b;
+        window_push(&windows[HISTORY_WINDOW_HOUR][ch], b.min, b.max, b.avg, evicted);
+        if (fresh) {
+            accumulator_add(&quarter_acc[ch], b.min, b.max, b.avg);
+        }
+        accumulator_reset(&minute_acc[ch]);
+    }
+    minute_head = (minute_head + 1) % HISTORY_MINUTE_LEN;
+    if (minute_count < HISTORY_MINUTE_LEN) minute_count++;
+    minutes_total++;
+    if (++quarter_minutes >= HISTORY_QUARTER_MINUTES) {
+        quarter_minutes = 0;
+        push_quarter();
+    }
+}
+
+// Expected once per second; every HISTORY_RAW_LEN samples roll up into a
+// minute bucket. A half that is not fresh still holds its place in the raw
+// tier, as the carried-over value, but is left out of the buckets.
+void history_add(const env_sample_t *sample) {
+    uint16_t values[HISTORY_CHANNELS] = {
+        sample->air.eco2,
+        sample->air.tvoc,
+        sample->climate.temperature_ticks,
+        sample->climate.humidity_ticks,
+    };
+    bool fresh[HISTORY_CHANNELS] = {
+        sample->air_status == SENSOR_OK,
+        sample->air_status == SENSOR_OK,
+        sample->climate_status == SENSOR_OK,
+        sample->climate_status == SENSOR_OK,
+    };
+    uint16_t slot = raw_head;
+    bool full = (raw_count == HISTORY_RAW_LEN);
+
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        uint16_t value = values[ch];
+        uint16_t evicted = raw_anchor[ch];
+        if (raw_count == 0) {
+            raw_anchor[ch] = value;
+            raw_delta[slot][ch] = 0;
+        } else {
+            // Wraps modulo 2^16, so any jump, 0 to 0xFFFF included, decodes exactly.
+            int16_t delta = (int16_t)(uint16_t)(value - raw_last[ch]);
+            if (full) {
+                uint16_t next_oldest = (slot + 1) % HISTORY_RAW_LEN;
+                raw_anchor[ch] = (uint16_t)(raw_anchor[ch] + raw_delta[next_oldest][ch]);
+            }
+            raw_delta[slot][ch] = delta;
+        }
+        raw_last[ch] = value;
+        window_push(&windows[HISTORY_WINDOW_MINUTE][ch], value, value, value, evicted);
+        if (fresh[ch]) {
+            accumulator_add(&minute_acc[ch], value, value, value);
+        }
+    }
+
+    raw_head = (raw_head + 1) % HISTORY_RAW_LEN;
+    if (!full) raw_count++;
+    raw_total++;
+    if (++minute_samples >= HISTORY_RAW_LEN) {
+        minute_samples = 0;
+        push_minute();
+    }
+}
+
+bool history_query(history_channel_t channel, history_window_t window, history_stats_t *out) {
+    const window_t *w = &windows[window][channel];
+    if (w->count == 0) {
+        return false;
+    }
+    out->min = w->min_q[w->min_head].value;
+    out->max = w->max_q[w->max_head].value;
+    out->avg = (uint16_t)((w->sum + w->count / 2) / w->count);
+    out->count = w->count;
+    return true;
+}
+
+uint16_t history_length(history_window_t window) {
+    switch (window) {
+    case HISTORY_WINDOW_MINUTE: return raw_count;
+    case HISTORY_WINDOW_HOUR:   return minute_count;
+    default:                    return quarter_count;
+    }
+}
+
+// Number of minute buckets closed since boot; bumps once per rollup.
+uint32_t history_minutes_total(void) {
+    return minutes_total;
+}
+
+// Entries ever pushed into a window, so callers can tell how far it has moved.
+uint32_t history_total(history_window_t window) {
+    switch (window) {
+    case HISTORY_WINDOW_MINUTE: return raw_total;
+    case HISTORY_WINDOW_HOUR:   return minutes_total;
+    default:                    return quarters_total;
+    }
+}
+
+// age 0 is the newest entry. Raw samples are decoded by walking deltas back
+// from the newest value, so that tier costs O(age).
+bool history_get(history_channel_t channel, history_window_t window, uint16_t age, history_bucket_t *out) {
+    if (age >= history_length(window)) {
+        return false;
+    }
+    if (window == HISTORY_WINDOW_MINUTE) {
+        uint16_t value = raw_last[channel];
+        uint16_t slot = (raw_head + HISTORY_RAW_LEN - 1) % HISTORY_RAW_LEN;
+        for (uint16_t i = 0; i < age; i++) {
+            value = (uint16_t)(value - raw_delta[slot][channel]);
+            slot = (slot + HISTORY_RAW_LEN - 1) % HISTORY_RAW_LEN;
+        }
+        out->min = out->max = out->avg = value;
+    } else if (window == HISTORY_WINDOW_HOUR) {
+        *out = minute_buckets[(minute_head + HISTORY_MINUTE_LEN - 1 - age) % HISTORY_MINUTE_LEN][channel];
+    } else {
+        *out = quarter_buckets[(quarter_head + HISTORY_QUARTER_LEN - 1 - age) % HISTORY_QUARTER_LEN][channel];
+    }
+    return true;
+}
+
+// The raw tier keeps the value at the cursor and undoes one delta per step.
+void history_iter_begin(history_iter_t *it, history_channel_t channel, history_window_t window) {
+    it->channel = channel;
+    it->window = window;
+    it->age = 0;
+    it->slot = (raw_head + HISTORY_RAW_LEN - 1) % HISTORY_RAW_LEN;
+    it->value = raw_last[channel];
+}
+
+bool history_iter_next(history_iter_t *it, history_bucket_t *out) {
+    if (it->window != HISTORY_WINDOW_MINUTE) {
+        if (!history_get(it->channel, it->window, it->age, out)) {
+            return false;
+        }
+        it->age++;
+        return true;
+    }
+    if (it->age >= raw_count) {
+        return false;
+    }
+    out->min = out->max = out->avg = it->value;
+    it->value = (uint16_t)(it->value - raw_delta[it->slot][it->channel]);
+    it->slot = (it->slot + HISTORY_RAW_LEN - 1) % HISTORY_RAW_LEN;
+    it->age++;
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensor.h"
+
+// Tier lengths: 1 s samples for a minute, 1 min buckets for an hour, 15 min buckets for a day.
+#define HISTORY_RAW_LEN      60
+#define HISTORY_MINUTE_LEN   60
+#define HISTORY_QUARTER_LEN  96
+#define HISTORY_QUARTER_MINUTES 15
+
+// Temperature and humidity are kept as raw SHT45 ticks so every channel is a uint16_t.
+typedef enum {
+    HISTORY_ECO2,
+    HISTORY_TVOC,
+    HISTORY_TEMPERATURE_TICKS,
+    HISTORY_HUMIDITY_TICKS,
+    HISTORY_CHANNELS
+} history_channel_t;
+
+typedef enum {
+    HISTORY_WINDOW_MINUTE,
+    HISTORY_WINDOW_HOUR,
+    HISTORY_WINDOW_DAY,
+    HISTORY_WINDOWS
+} history_window_t;
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint16_t avg;
+} history_bucket_t;
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint16_t avg;
+    uint16_t count;
+} history_stats_t;
+
+// Walks a window from the newest entry to the oldest. Each step is O(1), so
+// reading the whole minute tier this way is O(n) where history_get is O(n^2).
+typedef struct {
+    history_channel_t channel;
+    history_window_t window;
+    uint16_t age;
+    uint16_t slot;
+    uint16_t value;
+} history_iter_t;
+
+void history_init(void);
+void history_add(const env_sample_t *sample);
+bool history_query(history_channel_t channel, history_window_t window, history_stats_t *out);
+uint16_t history_length(history_window_t window);
+uint32_t history_minutes_total(void);
+uint32_t history_total(history_window_t window);
+bool history_get(history_channel_t channel, history_window_t window, uint16_t age, history_bucket_t *out);
+void history_iter_begin(history_iter_t *it, history_channel_t channel, history_window_t window);
+bool history_iter_next(history_iter_t *it, history_bucket_t *out);
+
+#endif
@@ -0,0 +1,144 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "nrf_fstorage.h"
+#include "nrf_fstorage_nvmc.h"
+#include "sim.h"
+
+// The nRF52833's 512 KB of flash as a RAM image. Programming can only clear
+// bits and only whole, aligned words; erasing sets a page back to 0xFF.
+
+#define FLASH_SIZE 0x80000
+
+nrf_fstorage_api_t nrf_fstorage_nvmc;
+
+static uint8_t flash[FLASH_SIZE];
+static bool erased_once = false;
+static bool powered = true;
+static bool cut_armed = false;
+static uint32_t cut_budget = 0;
+static fstorage_sim_stats_t stats;
+
+static void report(nrf_fstorage_t const *p_fs, nrf_fstorage_evt_id_t id, uint32_t addr,
+                   void const *p_src, uint32_t len, void *p_param) {
+    nrf_fstorage_evt_t evt = { id, NRF_SUCCESS, addr, p_src, len, p_param };
+    if (p_fs->evt_handler) {
+        p_fs->evt_handler(&evt);
+    }
+}
+
+// True if the power fails during the next word or page; each one that
+// completes spends one unit of the budget.
+static bool cut_now(void) {
+    if (!cut_armed) {
+        return false;
+    }
+    if (cut_budget == 0) {
+        powered = false;
+        return true;
+    }
+    cut_budget--;
+    return false;
+}
+
+static bool in_range(nrf_fstorage_t const *p_fs, uint32_t addr, uint32_t len) {
+    return addr >= p_fs->start_addr && len <= p_fs->end_addr - addr;
+}
+
+void fstorage_sim_erase_all(void) {
+    memset(flash, 0xFF, sizeof(flash));
+    erased_once = true;
+}
+
+ret_code_t nrf_fstorage_init(nrf_fstorage_t *p_fs, nrf_fstorage_api_t const *p_api, void *p_param) {
+    (void)p_api;
+    (void)p_param;
+    if (!erased_once) {
+        fstorage_sim_erase_all();
+    }
+    if (p_fs->end_addr > FLASH_SIZE || p_fs->start_addr % FSTORAGE_SIM_PAGE_SIZE != 0) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrf_fstorage_read(nrf_fstorage_t const *p_fs, uint32_t src, void *p_dest, uint32_t len) {
+    if (!in_range(p_fs, src, len)) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    memcpy(p_dest, &flash[src], len);
+    stats.read_bytes += len;
+    return NRF_SUCCESS;
+}
+
+// A cut partway through leaves the words before it programmed, the one it
+// interrupts half programmed and the rest erased; no result is reported.
+ret_code_t nrf_fstorage_write(nrf_fstorage_t const *p_fs, uint32_t dest, void const *p_src, uint32_t len,
+                              void *p_param) {
+    if (dest % 4 != 0 || (uintptr_t)p_src % 4 != 0 || !in_range(p_fs, dest, len)) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (len == 0 || len % 4 != 0) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (!powered) {
+        return NRF_SUCCESS;
+    }
+    const uint8_t *src = p_src;
+    for (uint32_t i = 0; i < len; i += 4) {
+        bool cut = cut_now();
+        for (uint32_t b = 0; b < (cut ? 2u : 4u); b++) {
+            flash[dest + i + b] &= src[i + b];
+        }
+        if (cut) {
+            return NRF_SUCCESS;
+        }
+        stats.programmed_words++;
+    }
+    report(p_fs, NRF_FSTORAGE_EVT_WRITE_RESULT, dest, p_src, len, p_param);
+    return NRF_SUCCESS;
+}
+
+// An erase cut short leaves the front of the page erased and the rest as it was.
+// Once the power is off, nothing is written, erased or reported.
+ret_code_t nrf_fstorage_erase(nrf_fstorage_t const *p_fs, uint32_t page_addr, uint32_t len, void *p_param) {
+    if (page_addr % FSTORAGE_SIM_PAGE_SIZE != 0 || !in_range(p_fs, page_addr, len * FSTORAGE_SIM_PAGE_SIZE)) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (!powered) {
+        return NRF_SUCCESS;
+    }
+    for (uint32_t page = 0; page < len; page++) {
+        bool cut = cut_now();
+        memset(&flash[page_addr + page * FSTORAGE_SIM_PAGE_SIZE], 0xFF,
+               cut ? FSTORAGE_SIM_PAGE_SIZE / 2 : FSTORAGE_SIM_PAGE_SIZE);
+        if (cut) {
+            return NRF_SUCCESS;
+        }
+        stats.erased_pages++;
+    }
+    report(p_fs, NRF_FSTORAGE_EVT_ERASE_RESULT, page_addr, NULL, len, p_param);
+    return NRF_SUCCESS;
+}
+
+void fstorage_sim_cut_after(uint32_t words) {
+    cut_armed = true;
+    cut_budget = words;
+}
+
+void fstorage_sim_power_on(void) {
+    powered = true;
+    cut_armed = false;
+}
+
+bool fstorage_sim_powered(void) {
+    return powered;
+}
+
+void fstorage_sim_stats(fstorage_sim_stats_t *out) {
+    *out = stats;
+}
+
+void fstorage_sim_clear_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,87 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "hal.h"
+#include "sim.h"
+
+// Only the basic instruction set is decoded: X and Y addresses, with
+// horizontal addressing wrapping X into the next bank. Extended commands
+// (bias, contrast) are counted but change nothing here.
+static uint8_t ram[PCD8544_WIDTH * PCD8544_BANKS];
+static uint32_t dc = 0;
+static bool extended = false;
+static uint8_t x = 0, y = 0;
+static uint32_t data_bytes = 0;
+static uint32_t command_bytes = 0;
+static uint32_t transactions = 0;
+
+static void command(uint8_t c) {
+    command_bytes++;
+    if ((c & 0xF8) == 0x20) {
+        extended = c & 0x01;
+    } else if (extended) {
+        return;
+    } else if (c & 0x80) {
+        x = (c & 0x7F) % PCD8544_WIDTH;
+    } else if ((c & 0xF8) == 0x40) {
+        y = (c & 0x07) % PCD8544_BANKS;
+    }
+}
+
+static void data(uint8_t d) {
+    data_bytes++;
+    ram[y * PCD8544_WIDTH + x] = d;
+    if (++x == PCD8544_WIDTH) {
+        x = 0;
+        y = (y + 1) % PCD8544_BANKS;
+    }
+}
+
+static void spi_sink(const uint8_t *buf, uint16_t len) {
+    bool is_data = hal_gpio_read(dc);
+    transactions++;
+    for (uint16_t i = 0; i < len; i++) {
+        if (is_data) {
+            data(buf[i]);
+        } else {
+            command(buf[i]);
+        }
+    }
+}
+
+void pcd8544_attach(uint32_t dc_pin) {
+    dc = dc_pin;
+    hal_host_spi_attach(spi_sink);
+}
+
+const uint8_t *pcd8544_ram(void) {
+    return ram;
+}
+
+uint32_t pcd8544_data_bytes(void) {
+    return data_bytes;
+}
+
+uint32_t pcd8544_command_bytes(void) {
+    return command_bytes;
+}
+
+uint32_t pcd8544_transactions(void) {
+    return transactions;
+}
+
+bool pcd8544_write_pbm(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "P1\n%d %d\n", PCD8544_WIDTH, PCD8544_BANKS * 8);
+    for (int row = 0; row < PCD8544_BANKS * 8; row++) {
+        for (int col = 0; col < PCD8544_WIDTH; col++) {
+            int bit = (ram[(row / 8) * PCD8544_WIDTH + col] >> (row % 8)) & 1;
+            fputs(bit ? "1 " : "0 ", f);
+        }
+        fputc('\n', f);
+    }
+    return fclose(f) == 0;
+}
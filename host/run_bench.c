@@ -0,0 +1,27 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "microbit_v2.h"
+#include "hal.h"
+#include "bench.h"
+#include "lcd.h"
+#include "profile.h"
+#include "sim.h"
+
+#define DEFAULT_ITERATIONS 1000
+
+// Runs the boot-time benchmark suite against the virtual panel and prints the
+// same CSV report the board does, in nanoseconds rather than cycles.
+int main(int argc, char **argv) {
+    long iterations = DEFAULT_ITERATIONS;
+    if (argc > 2 || (argc == 2 && ((iterations = strtol(argv[1], NULL, 0)) <= 0 || iterations > UINT16_MAX))) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+    profile_init();
+    hal_timer_init();
+    hal_spi_init();
+    pcd8544_attach(EDGE_P8);
+    lcdBegin();
+    bench_run((uint16_t)iterations);
+    return 0;
+}
@@ -0,0 +1,16 @@
+#ifndef APP_UTIL_PLATFORM_H
+#define APP_UTIL_PLATFORM_H
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+// Host stand-in. The simulation is single threaded and runs interrupts only
+// at event boundaries, so a critical region is just the block the SDK's
+// macros open and close.
+#define CRITICAL_REGION_ENTER() {
+#define CRITICAL_REGION_EXIT()  }
+
+#define APP_IRQ_PRIORITY_LOW    6
+#define APP_IRQ_PRIORITY_LOWEST 7
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef MICROBIT_V2_H
+#define MICROBIT_V2_H
+
+// Host stand-in with the board header's pin numbers.
+#define EDGE_P0  2
+#define EDGE_P1  3
+#define EDGE_P2  4
+#define EDGE_P3  31
+#define EDGE_P4  28
+#define EDGE_P8  10
+#define EDGE_P13 17
+#define EDGE_P14 33
+#define EDGE_P15 13
+
+#define UART_TX  6
+
+#define I2C_QWIIC_SCL 26
+#define I2C_QWIIC_SDA 32
+
+#endif
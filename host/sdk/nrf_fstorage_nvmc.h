@@ -0,0 +1,9 @@
+#ifndef NRF_FSTORAGE_NVMC_H
+#define NRF_FSTORAGE_NVMC_H
+
+#include "nrf_fstorage.h"
+
+// Host stand-in: the backend handle is only passed through to fstorage_sim.c.
+extern nrf_fstorage_api_t nrf_fstorage_nvmc;
+
+#endif
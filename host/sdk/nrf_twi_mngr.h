@@ -0,0 +1,41 @@
+#ifndef NRF_TWI_MNGR_H
+#define NRF_TWI_MNGR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+// Host stand-in for the TWI transaction manager, implemented by
+// twi_mngr_sim.c on top of the host HAL's I2C devices.
+
+typedef struct {
+    uint8_t *p_data;
+    uint8_t length;
+    uint8_t operation;  // address << 1, bit 0 set for reads
+    uint8_t flags;
+} nrf_twi_mngr_transfer_t;
+
+#define NRF_TWI_MNGR_WRITE(_address, _p_data, _length, _flags) \
+    { .p_data = (uint8_t *)(_p_data), .length = (_length), .operation = (uint8_t)((_address) << 1), .flags = (_flags) }
+#define NRF_TWI_MNGR_READ(_address, _p_data, _length, _flags) \
+    { .p_data = (uint8_t *)(_p_data), .length = (_length), .operation = (uint8_t)(((_address) << 1) | 1), .flags = (_flags) }
+
+typedef void (*nrf_twi_mngr_callback_t)(ret_code_t result, void *p_user_data);
+
+typedef struct {
+    nrf_twi_mngr_callback_t callback;
+    void *p_user_data;
+    nrf_twi_mngr_transfer_t const *p_transfers;
+    uint8_t number_of_transfers;
+    void const *p_required_twi_cfg;
+} nrf_twi_mngr_transaction_t;
+
+typedef struct {
+    uint8_t queue_size;
+} nrf_twi_mngr_t;
+
+ret_code_t nrf_twi_mngr_schedule(nrf_twi_mngr_t const *p_nrf_twi_mngr,
+                                 nrf_twi_mngr_transaction_t const *p_transaction);
+bool nrf_twi_mngr_is_idle(nrf_twi_mngr_t const *p_nrf_twi_mngr);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef NRFX_UARTE_H
+#define NRFX_UARTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+// Host stand-in for the UARTE driver, implemented by uarte_sim.c.
+
+typedef struct {
+    uint8_t drv_inst_idx;
+} nrfx_uarte_t;
+
+#define NRFX_UARTE_INSTANCE(id) { .drv_inst_idx = (id) }
+
+#define NRF_UARTE_PSEL_DISCONNECTED 0xFFFFFFFFUL
+#define NRF_UARTE_BAUDRATE_115200   115200UL
+
+typedef struct {
+    uint32_t pseltxd;
+    uint32_t pselrxd;
+    uint32_t baudrate;
+    uint8_t interrupt_priority;
+} nrfx_uarte_config_t;
+
+#define NRFX_UARTE_DEFAULT_CONFIG { \
+    .pseltxd = NRF_UARTE_PSEL_DISCONNECTED, .pselrxd = NRF_UARTE_PSEL_DISCONNECTED, \
+    .baudrate = NRF_UARTE_BAUDRATE_115200, .interrupt_priority = 6 }
+
+typedef enum {
+    NRFX_UARTE_EVT_TX_DONE,
+    NRFX_UARTE_EVT_RX_DONE,
+    NRFX_UARTE_EVT_ERROR,
+} nrfx_uarte_evt_type_t;
+
+typedef struct {
+    nrfx_uarte_evt_type_t type;
+} nrfx_uarte_event_t;
+
+typedef void (*nrfx_uarte_event_handler_t)(nrfx_uarte_event_t const *p_event, void *p_context);
+
+nrfx_err_t nrfx_uarte_init(nrfx_uarte_t const *p_instance, nrfx_uarte_config_t const *p_config,
+                           nrfx_uarte_event_handler_t event_handler);
+nrfx_err_t nrfx_uarte_tx(nrfx_uarte_t const *p_instance, uint8_t const *p_data, size_t length);
+
+#endif
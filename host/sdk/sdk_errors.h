@@ -0,0 +1,26 @@
+#ifndef SDK_ERRORS_H
+#define SDK_ERRORS_H
+
+#include <stdint.h>
+
+// Host stand-in: the nRF5 SDK error codes the portable modules use.
+
+typedef uint32_t ret_code_t;
+typedef uint32_t nrfx_err_t;
+
+#define NRF_SUCCESS                 0x0000
+#define NRF_ERROR_INTERNAL          0x0003
+#define NRF_ERROR_NO_MEM            0x0004
+#define NRF_ERROR_INVALID_STATE     0x0008
+#define NRF_ERROR_INVALID_LENGTH    0x0009
+#define NRF_ERROR_INVALID_DATA      0x000B
+#define NRF_ERROR_TIMEOUT           0x000D
+#define NRF_ERROR_INVALID_ADDR      0x0010
+#define NRF_ERROR_BUSY              0x0011
+#define NRF_ERROR_DRV_TWI_ERR_ANACK 0x8201
+#define NRF_ERROR_DRV_TWI_ERR_DNACK 0x8202
+
+#define NRFX_SUCCESS                NRF_SUCCESS
+#define NRFX_ERROR_BUSY             NRF_ERROR_BUSY
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Virtual peripherals of the host build, alongside the controls in hal_host.h.
+
+#define PCD8544_WIDTH  84
+#define PCD8544_BANKS  6
+
+// A PCD8544 on the host SPI bus, decoding commands and data by the DC pin.
+// The panel RAM has the same bank-major layout as displayMap. Every SPI
+// transfer it sees counts as one transaction.
+void pcd8544_attach(uint32_t dc_pin);
+const uint8_t *pcd8544_ram(void);
+uint32_t pcd8544_data_bytes(void);
+uint32_t pcd8544_command_bytes(void);
+uint32_t pcd8544_transactions(void);
+bool pcd8544_write_pbm(const char *path);
+
+// While stalled, the transaction on the bus never finishes, as with a slave
+// that stretches the clock for good; it completes once the stall ends.
+void twi_mngr_sim_stall(bool stall);
+// The bus clock for transactions started from now on, 100 kHz until set,
+// and the ticks the bus has spent on transactions so far.
+void twi_mngr_sim_clock(uint32_t hz);
+uint64_t twi_mngr_sim_busy_ticks(void);
+
+// The flash behind fstorage, all erased at the first nrf_fstorage_init. A
+// power cut lets the given number of words or pages complete and then stops
+// the flash partway through the next one; it stays off until power_on.
+#define FSTORAGE_SIM_PAGE_SIZE 4096
+
+typedef struct {
+    uint32_t read_bytes;
+    uint32_t programmed_words;
+    uint32_t erased_pages;
+} fstorage_sim_stats_t;
+
+void fstorage_sim_erase_all(void);
+void fstorage_sim_cut_after(uint32_t words);
+void fstorage_sim_power_on(void);
+bool fstorage_sim_powered(void);
+void fstorage_sim_stats(fstorage_sim_stats_t *out);
+void fstorage_sim_clear_stats(void);
+
+// Everything the UARTE has sent since the last clear.
+const uint8_t *uarte_sim_output(size_t *len);
+void uarte_sim_clear(void);
+
+#endif
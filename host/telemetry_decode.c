@@ -0,0 +1,32 @@
+#include <stdio.h>
+#include "telemetry_decoder.h"
+
+// Reads the raw telemetry byte stream from a file or stdin (for example a
+// serial port set to 115200 8N1 and raw mode) and writes one CSV row per
+// record to stdout. Damaged and lost frames are reported on stderr.
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    if (argc > 2 || (argc == 2 && (in = fopen(argv[1], "rb")) == NULL)) {
+        fprintf(stderr, "usage: %s [capture-file]\n", argv[0]);
+        return 2;
+    }
+
+    telemetry_decoder_t decoder;
+    telemetry_decoder_init(&decoder);
+    telemetry_csv_header(stdout);
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        telemetry_record_t rec;
+        telemetry_decode_result_t result = telemetry_decoder_push(&decoder, (uint8_t)c, &rec);
+        if (result == TELEMETRY_DECODE_RECORD) {
+            telemetry_csv_row(stdout, &rec);
+            fflush(stdout);
+        } else if (result != TELEMETRY_DECODE_NONE) {
+            fprintf(stderr, "bad frame (%s)\n", result == TELEMETRY_DECODE_BAD_CRC ? "crc" :
+                                               result == TELEMETRY_DECODE_BAD_COBS ? "cobs" : "record");
+        }
+    }
+    fprintf(stderr, "%lu records, %lu bad frames, %lu lost\n", (unsigned long)decoder.records,
+            (unsigned long)decoder.errors, (unsigned long)decoder.lost);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sensor.h"
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+
+void telemetry_decoder_init(telemetry_decoder_t *d) {
+    *d = (telemetry_decoder_t){0};
+}
+
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst) {
+    size_t in = 0, out = 0;
+    while (in < len) {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            dst[out++] = src[in++];
+        }
+        // A full block (0xFF) carries no implied zero, nor does the last one.
+        if (code != 0xFF && in < len) {
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static telemetry_decode_result_t parse(const uint8_t *raw, size_t len, telemetry_record_t *out) {
+    if (len < 3) {
+        return TELEMETRY_DECODE_BAD_RECORD;
+    }
+    if (sgp30_crc8(raw, (uint8_t)(len - 1)) != raw[len - 1]) {
+        return TELEMETRY_DECODE_BAD_CRC;
+    }
+    const uint8_t *payload = &raw[2];
+    size_t payload_len = len - 3;
+    *out = (telemetry_record_t){ .type = raw[0], .seq = raw[1] };
+    switch (out->type) {
+    case TELEMETRY_REC_SAMPLE:
+        if (payload_len != 13) {
+            return TELEMETRY_DECODE_BAD_RECORD;
+        }
+        out->timestamp_ms = get_u32(payload);
+        out->eco2 = get_u16(payload + 4);
+        out->tvoc = get_u16(payload + 6);
+        out->temperature_ticks = get_u16(payload + 8);
+        out->humidity_ticks = get_u16(payload + 10);
+        out->air_status = TELEMETRY_STATUS_AIR(payload[12]);
+        out->climate_status = TELEMETRY_STATUS_CLIMATE(payload[12]);
+        return TELEMETRY_DECODE_RECORD;
+    case TELEMETRY_REC_EVENT:
+        if (payload_len != 7) {
+            return TELEMETRY_DECODE_BAD_RECORD;
+        }
+        out->timestamp_ms = get_u32(payload);
+        out->code = payload[4];
+        out->arg = get_u16(payload + 5);
+        return TELEMETRY_DECODE_RECORD;
+    default:
+        return TELEMETRY_DECODE_BAD_RECORD;
+    }
+}
+
+// Bytes before the first delimiter may be the tail of a frame sent before the
+// decoder started listening; they fail COBS or the CRC and are counted once.
+telemetry_decode_result_t telemetry_decoder_push(telemetry_decoder_t *d, uint8_t byte, telemetry_record_t *out) {
+    if (byte != 0) {
+        if (d->len < sizeof(d->frame)) {
+            d->frame[d->len++] = byte;
+        } else {
+            d->overflow = true;
+        }
+        return TELEMETRY_DECODE_NONE;
+    }
+
+    uint8_t raw[TELEMETRY_DECODER_MAX_FRAME];
+    size_t frame_len = d->len;
+    bool overflow = d->overflow;
+    d->len = 0;
+    d->overflow = false;
+    if (frame_len == 0) {
+        return TELEMETRY_DECODE_NONE;
+    }
+
+    telemetry_decode_result_t result;
+    size_t raw_len = overflow ? 0 : cobs_decode(d->frame, frame_len, raw);
+    if (raw_len == 0) {
+        result = TELEMETRY_DECODE_BAD_COBS;
+    } else {
+        result = parse(raw, raw_len, out);
+    }
+    if (result != TELEMETRY_DECODE_RECORD) {
+        d->errors++;
+        return result;
+    }
+
+    if (d->have_seq) {
+        d->lost += (uint8_t)(out->seq - d->next_seq);
+    }
+    d->have_seq = true;
+    d->next_seq = out->seq + 1;
+    d->records++;
+    return result;
+}
+
+static const char *event_name(uint8_t code) {
+    switch (code) {
+    case TELEMETRY_EVT_BOOT:     return "boot";
+    case TELEMETRY_EVT_STATE:    return "state";
+    case TELEMETRY_EVT_RULE_ON:  return "rule_on";
+    case TELEMETRY_EVT_RULE_OFF: return "rule_off";
+    default:                     return "unknown";
+    }
+}
+
+static const char *status_name(uint8_t status) {
+    switch (status) {
+    case SENSOR_OK:      return "ok";
+    case SENSOR_STALE:   return "stale";
+    case SENSOR_INVALID: return "invalid";
+    default:             return "unknown";
+    }
+}
+
+static void print_centi(FILE *f, int16_t centi) {
+    int32_t magnitude = centi < 0 ? -(int32_t)centi : centi;
+    fprintf(f, "%s%ld.%02ld", centi < 0 ? "-" : "", (long)(magnitude / 100), (long)(magnitude % 100));
+}
+
+void telemetry_csv_header(FILE *f) {
+    fputs("type,seq,timestamp_ms,eco2_ppm,tvoc_ppb,temperature_c,humidity_rh,air_status,climate_status,"
+          "event,arg\n", f);
+}
+
+void telemetry_csv_row(FILE *f, const telemetry_record_t *rec) {
+    if (rec->type == TELEMETRY_REC_SAMPLE) {
+        fprintf(f, "sample,%u,%lu,%u,%u,", rec->seq, (unsigned long)rec->timestamp_ms, rec->eco2, rec->tvoc);
+        print_centi(f, sht45_ticks_to_centi_celsius(rec->temperature_ticks));
+        fputc(',', f);
+        print_centi(f, sht45_ticks_to_centi_rh(rec->humidity_ticks));
+        fprintf(f, ",%s,%s,,\n", status_name(rec->air_status), status_name(rec->climate_status));
+    } else {
+        fprintf(f, "event,%u,%lu,,,,,,,%s,%u\n", rec->seq, (unsigned long)rec->timestamp_ms,
+                event_name(rec->code), rec->arg);
+    }
+}
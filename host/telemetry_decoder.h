@@ -0,0 +1,59 @@
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Host side of the telemetry stream described in telemetry.h: splits the byte
+// stream at the 0x00 delimiters, undoes COBS, checks the CRC-8 and unpacks
+// each record. Lost frames show up as gaps in seq.
+
+#define TELEMETRY_DECODER_MAX_FRAME 64
+
+typedef struct {
+    uint8_t type;
+    uint8_t seq;
+    uint32_t timestamp_ms;
+    // TELEMETRY_REC_SAMPLE
+    uint16_t eco2;
+    uint16_t tvoc;
+    uint16_t temperature_ticks;
+    uint16_t humidity_ticks;
+    uint8_t air_status;      // sensor_status_t
+    uint8_t climate_status;  // sensor_status_t
+    // TELEMETRY_REC_EVENT
+    uint8_t code;
+    uint16_t arg;
+} telemetry_record_t;
+
+typedef enum {
+    TELEMETRY_DECODE_NONE,     // more bytes needed
+    TELEMETRY_DECODE_RECORD,   // *out holds a record
+    TELEMETRY_DECODE_BAD_COBS,
+    TELEMETRY_DECODE_BAD_CRC,
+    TELEMETRY_DECODE_BAD_RECORD,  // unknown type or wrong payload length
+} telemetry_decode_result_t;
+
+typedef struct {
+    uint8_t frame[TELEMETRY_DECODER_MAX_FRAME];
+    size_t len;
+    bool overflow;
+    bool have_seq;
+    uint8_t next_seq;
+    uint32_t records;
+    uint32_t errors;
+    uint32_t lost;  // frames missing from the seq sequence
+} telemetry_decoder_t;
+
+void telemetry_decoder_init(telemetry_decoder_t *d);
+telemetry_decode_result_t telemetry_decoder_push(telemetry_decoder_t *d, uint8_t byte, telemetry_record_t *out);
+
+// Returns the decoded length, or 0 if src is not valid COBS.
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst);
+
+void telemetry_csv_header(FILE *f);
+void telemetry_csv_row(FILE *f, const telemetry_record_t *rec);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+// Minimal checks for the host tests: failures are printed and counted, and
+// test_report() turns the count into the exit status.
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+    test_checks++; \
+    if (!(cond)) { \
+        test_failures++; \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long check_a = (long long)(a), check_b = (long long)(b); \
+    test_checks++; \
+    if (check_a != check_b) { \
+        test_failures++; \
+        printf("%s:%d: %s == %lld, expected %s == %lld\n", __FILE__, __LINE__, #a, check_a, #b, check_b); \
+    } \
+} while (0)
+
+static inline int test_report(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
+
+#endif
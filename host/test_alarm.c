@@ -0,0 +1,134 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "alarm.h"
+#include "hal.h"
+#include "timekeeping.h"
+#include "test.h"
+
+// Scripts overlapping alarm conditions against the host PWM and checks the
+// timeline of patterns that reach the speaker.
+
+#define TICKS_PER_MS 33  // close enough to 32.768 for stepping
+
+typedef struct {
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    uint16_t min_hz;
+    uint16_t max_hz;
+    bool has[3];  // 500, 600 and 700 Hz tones present
+} play_t;
+
+static play_t plays[16];
+static uint8_t play_count = 0;
+static uint32_t seen_starts = 0;
+
+static uint16_t entry_hz(const hal_pwm_entry_t *e) {
+    return (uint16_t)(HAL_PWM_CLOCK_HZ / (e->counter_top + 1));
+}
+
+static void note_start(void) {
+    uint16_t count, loops;
+    const hal_pwm_entry_t *entries = hal_host_pwm_playing(&count, &loops);
+    seen_starts = hal_host_pwm_starts();
+    if (entries == NULL || play_count == 16) return;
+    play_t *p = &plays[play_count++];
+    *p = (play_t){ .start_ms = timekeeping_uptime_ms(), .min_hz = UINT16_MAX };
+    uint64_t clocks = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t hz = entry_hz(&entries[i]);
+        if (hz < p->min_hz) p->min_hz = hz;
+        if (hz > p->max_hz) p->max_hz = hz;
+        if (hz == 500) p->has[0] = true;
+        if (hz == 600) p->has[1] = true;
+        if (hz == 700) p->has[2] = true;
+        clocks += (uint64_t)HAL_PWM_PERIODS_PER_ENTRY * (entries[i].counter_top + 1);
+    }
+    p->duration_ms = (uint32_t)(clocks * loops / (HAL_PWM_CLOCK_HZ / 1000));
+}
+
+static void run_ms(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        hal_host_advance(TICKS_PER_MS);
+        if (hal_host_pwm_starts() != seen_starts) note_start();
+    }
+}
+
+static bool near(uint32_t a, uint32_t b, uint32_t tolerance) {
+    return (a > b ? a - b : b - a) <= tolerance;
+}
+
+static void test_overlap(void) {
+    uint32_t t0 = timekeeping_uptime_ms();
+    // Two thresholds within the coalesce window share one alternating pattern.
+    alarm_raise(ALARM_SRC_TEMPERATURE);
+    run_ms(3);
+    alarm_raise(ALARM_SRC_ECO2);
+    run_ms(500);
+    // The clock outranks the humidity tone queued with it, but neither cuts
+    // off what is playing; a repeat of a sounding source is ignored.
+    alarm_raise(ALARM_SRC_HUMIDITY);
+    alarm_raise(ALARM_SRC_CLOCK);
+    alarm_raise(ALARM_SRC_TEMPERATURE);
+    run_ms(8000);
+
+    CHECK_EQ(play_count, 3);
+    CHECK(near(plays[0].start_ms, t0 + 13, 3));
+    CHECK(plays[0].has[0] && !plays[0].has[1] && plays[0].has[2]);
+    CHECK(near(plays[0].duration_ms, 2000, 60));
+
+    CHECK(near(plays[1].start_ms, plays[0].start_ms + plays[0].duration_ms, 3));
+    CHECK_EQ(plays[1].min_hz, 400);
+    CHECK(plays[1].max_hz >= 790);
+    CHECK(near(plays[1].duration_ms, 3000, 60));
+
+    CHECK(near(plays[2].start_ms, plays[1].start_ms + plays[1].duration_ms, 3));
+    CHECK(!plays[2].has[0] && plays[2].has[1] && !plays[2].has[2]);
+    CHECK(!alarm_playing());
+}
+
+static void test_latching(void) {
+    uint8_t before = play_count;
+    // Still latched from the last excursion: nothing until alarm_clear().
+    alarm_raise(ALARM_SRC_TEMPERATURE);
+    run_ms(100);
+    CHECK_EQ(play_count, before);
+    // Cleared, but inside the hold-off.
+    alarm_clear(ALARM_SRC_TEMPERATURE);
+    alarm_raise(ALARM_SRC_TEMPERATURE);
+    run_ms(100);
+    CHECK_EQ(play_count, before);
+    // Past the hold-off it plays again.
+    run_ms(60000);
+    alarm_raise(ALARM_SRC_TEMPERATURE);
+    run_ms(2500);
+    CHECK_EQ(play_count, before + 1);
+    CHECK(plays[before].has[0] && !plays[before].has[2]);
+}
+
+static void test_silence(void) {
+    uint16_t count, loops;
+    uint8_t before = play_count;
+    alarm_raise(ALARM_SRC_CLOCK);
+    alarm_clear(ALARM_SRC_HUMIDITY);
+    run_ms(100);
+    CHECK_EQ(play_count, before + 1);
+    CHECK(alarm_playing());
+    // A threshold queued behind the sweep goes too.
+    alarm_raise(ALARM_SRC_HUMIDITY);
+    alarm_silence();
+    CHECK(!alarm_playing());
+    CHECK(hal_host_pwm_playing(&count, &loops) == NULL);
+    run_ms(5000);
+    CHECK_EQ(play_count, before + 1);
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_pwm_init();
+    timekeeping_init();
+    alarm_init();
+    test_overlap();
+    test_latching();
+    test_silence();
+    return test_report("test_alarm");
+}
@@ -0,0 +1,189 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal.h"
+#include "button.h"
+#include "timekeeping.h"
+#include "test.h"
+
+// Edge timelines played through the virtual GPIO pins: clean and bouncy
+// presses, a bounce still going on BUTTON_DEBOUNCE_MS after the first edge,
+// noise that is not a press, long presses with repeats, and presses queued up while the main loop is
+// stuck in a long sensor read.
+
+#define PIN_A 14
+#define PIN_B 23
+#define DEBOUNCE_MS 20
+
+static void wait_ms(uint32_t ms) {
+    hal_host_advance(HAL_MS_TO_TICKS(ms));
+}
+
+// Buttons pull the line low while pressed.
+static void line(uint32_t pin, bool pressed) {
+    hal_host_gpio_input(pin, !pressed);
+}
+
+// Contact bounce: the line flips at each gap, ending at the pressed state.
+static void bounce(uint32_t pin, bool pressed, const uint8_t *gaps_ms, uint8_t n) {
+    bool level = pressed;
+    if (n % 2 == 0) level = !level;
+    for (uint8_t i = 0; i < n; i++) {
+        line(pin, level);
+        wait_ms(gaps_ms[i]);
+        level = !level;
+    }
+    line(pin, pressed);
+}
+
+static uint8_t drain(button_event_t *events, uint8_t max) {
+    uint8_t n = 0;
+    button_event_t evt;
+    while (button_event_get(&evt)) {
+        if (n < max) events[n] = evt;
+        n++;
+    }
+    return n;
+}
+
+static void test_clean_press(void) {
+    button_event_t evt[4];
+    line(PIN_A, true);
+    wait_ms(100);
+    line(PIN_A, false);
+    wait_ms(100);
+    CHECK_EQ(drain(evt, 4), 1);
+    CHECK_EQ(evt[0].button, BUTTON_A);
+    CHECK_EQ(evt[0].type, BUTTON_EVT_SHORT);
+    CHECK(evt[0].duration_ms >= 99 && evt[0].duration_ms <= 101);
+}
+
+static void test_bouncy_press(void) {
+    static const uint8_t press[] = { 1, 2, 1, 3, 2 };
+    static const uint8_t release[] = { 2, 1, 3, 1 };
+    button_event_t evt[4];
+    bounce(PIN_B, true, press, sizeof(press));
+    wait_ms(150);
+    bounce(PIN_B, false, release, sizeof(release));
+    wait_ms(100);
+    CHECK_EQ(drain(evt, 4), 1);
+    CHECK_EQ(evt[0].button, BUTTON_B);
+    CHECK_EQ(evt[0].type, BUTTON_EVT_SHORT);
+    CHECK(!button_is_pressed(BUTTON_B));
+}
+
+// Still bouncing, and released, at DEBOUNCE_MS after the first edge. A
+// sample taken then would miss the press altogether.
+static void test_slow_bounce(void) {
+    static const uint8_t press[] = { 6, 6, 6, 3, 4 };
+    static const uint8_t release[] = { 6, 6, 6, 3, 4 };
+    button_event_t evt[4];
+    bounce(PIN_A, true, press, sizeof(press));
+    wait_ms(DEBOUNCE_MS / 2);
+    CHECK(!button_is_pressed(BUTTON_A));
+    wait_ms(DEBOUNCE_MS);
+    CHECK(button_is_pressed(BUTTON_A));
+    wait_ms(200);
+    bounce(PIN_A, false, release, sizeof(release));
+    wait_ms(DEBOUNCE_MS / 2);
+    CHECK(button_is_pressed(BUTTON_A));
+    wait_ms(DEBOUNCE_MS);
+    CHECK(!button_is_pressed(BUTTON_A));
+    CHECK_EQ(drain(evt, 4), 1);
+    CHECK_EQ(evt[0].type, BUTTON_EVT_SHORT);
+    // Measured between the last edges of each bounce: the 30 ms of checks,
+    // 200 ms held and the 25 ms the release bounced for.
+    CHECK(evt[0].duration_ms >= 254 && evt[0].duration_ms <= 256);
+}
+
+// Contact noise that never holds a level for DEBOUNCE_MS, though it goes
+// on for longer than that, is not a press.
+static void test_noise(void) {
+    button_event_t evt[4];
+    line(PIN_B, true);
+    wait_ms(3);
+    line(PIN_B, false);
+    wait_ms(14);
+    line(PIN_B, true);
+    wait_ms(5);
+    line(PIN_B, false);
+    wait_ms(100);
+    CHECK_EQ(drain(evt, 4), 0);
+    CHECK(!button_is_pressed(BUTTON_B));
+}
+
+static void test_long_press(void) {
+    button_event_t evt[16];
+    line(PIN_B, true);
+    wait_ms(BUTTON_REPEAT_DELAY_MS + 3 * BUTTON_REPEAT_INTERVAL_MS + 50);
+    line(PIN_B, false);
+    wait_ms(100);
+    uint8_t n = drain(evt, 16);
+    CHECK_EQ(n, 5);
+    for (uint8_t i = 0; i < 4 && i < n; i++) {
+        CHECK_EQ(evt[i].type, BUTTON_EVT_REPEAT);
+        CHECK_EQ(evt[i].timestamp_ms, evt[0].timestamp_ms);
+    }
+    CHECK_EQ(evt[4].type, BUTTON_EVT_LONG);
+    CHECK(evt[4].duration_ms >= BUTTON_REPEAT_DELAY_MS + 3 * BUTTON_REPEAT_INTERVAL_MS);
+}
+
+// The main loop is busy for 300 ms while six bouncy presses alternate
+// between the buttons; all of them are waiting in order afterwards.
+static void test_presses_during_read(void) {
+    static const uint8_t gaps[] = { 1, 2, 1 };
+    button_event_t evt[16];
+    uint32_t dropped = button_dropped_events();
+    for (uint8_t i = 0; i < 6; i++) {
+        uint32_t pin = (i % 2) ? PIN_B : PIN_A;
+        bounce(pin, true, gaps, sizeof(gaps));
+        wait_ms(30);
+        bounce(pin, false, gaps, sizeof(gaps));
+        wait_ms(14);
+    }
+    wait_ms(DEBOUNCE_MS);
+    uint8_t n = drain(evt, 16);
+    CHECK_EQ(n, 6);
+    for (uint8_t i = 0; i < n; i++) {
+        CHECK_EQ(evt[i].button, (i % 2) ? BUTTON_B : BUTTON_A);
+        CHECK_EQ(evt[i].type, BUTTON_EVT_SHORT);
+        if (i > 0) CHECK(evt[i].timestamp_ms > evt[i - 1].timestamp_ms);
+    }
+    CHECK_EQ(button_dropped_events(), dropped);
+}
+
+// One slot of the ring is kept empty; the rest fill, and the overflow is counted.
+static void test_overflow(void) {
+    button_event_t evt[16];
+    uint32_t dropped = button_dropped_events();
+    for (uint8_t i = 0; i < 16; i++) {
+        line(PIN_A, true);
+        wait_ms(40);
+        line(PIN_A, false);
+        wait_ms(40);
+    }
+    CHECK_EQ(drain(evt, 16), 15);
+    CHECK_EQ(button_dropped_events(), dropped + 1);
+}
+
+static uint32_t notified = 0;
+
+static void notify(void) {
+    notified++;
+}
+
+int main(void) {
+    hal_timer_init();
+    timekeeping_init();
+    buttons_init(notify);
+    CHECK(!button_is_pressed(BUTTON_A));
+    CHECK(!button_is_pressed(BUTTON_B));
+    test_clean_press();
+    CHECK_EQ(notified, 1);
+    test_bouncy_press();
+    test_slow_bounce();
+    test_noise();
+    test_long_press();
+    test_presses_during_read();
+    test_overflow();
+    return test_report("test_button");
+}
@@ -0,0 +1,110 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "microbit_v2.h"
+#include "hal.h"
+#include "history.h"
+#include "lcd.h"
+#include "view.h"
+#include "sim.h"
+#include "test.h"
+
+// The history iterator against history_get, then the chart drawn one sample
+// at a time (scrolling) against the same chart drawn from scratch, through
+// the LCD driver to the virtual panel.
+
+#define CHART_X 24
+#define CHART_Y 8
+#define CHART_W (LCD_WIDTH - CHART_X)
+
+static env_sample_t make_sample(uint32_t i) {
+    env_sample_t sample = {0};
+    sample.air.eco2 = (uint16_t)(600 + (i * 37) % 90);
+    sample.air.tvoc = (uint16_t)(i % 13);
+    sample.climate.temperature_ticks = (uint16_t)(26000 + i * 3);
+    sample.climate.humidity_ticks = (uint16_t)(30000 + (i * 101) % 700);
+    return sample;
+}
+
+static bool pixel(const uint8_t *map, uint8_t x, uint8_t y) {
+    return (map[x + (y / 8) * LCD_WIDTH] >> (y % 8)) & 1;
+}
+
+static void check_iterator(void) {
+    for (uint8_t w = 0; w < HISTORY_WINDOWS; w++) {
+        for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+            history_iter_t it;
+            history_bucket_t a, b;
+            uint16_t age = 0;
+            history_iter_begin(&it, (history_channel_t)ch, (history_window_t)w);
+            while (history_iter_next(&it, &a)) {
+                CHECK(history_get((history_channel_t)ch, (history_window_t)w, age, &b));
+                CHECK(a.min == b.min && a.max == b.max && a.avg == b.avg);
+                age++;
+            }
+            CHECK_EQ(age, history_length((history_window_t)w));
+        }
+    }
+}
+
+static void test_scroll_matches_redraw(history_channel_t channel, history_window_t window,
+                                       uint32_t samples, uint32_t stride) {
+    uint8_t scrolled[sizeof(displayMap)];
+    uint32_t mismatches = 0;
+    history_init();
+    view_invalidate();
+    for (uint32_t i = 0; i < samples; i++) {
+        env_sample_t sample = make_sample(i);
+        history_add(&sample);
+        if (i % stride != 0) continue;
+        view_chart(channel, window);
+        lcdFlush();
+        memcpy(scrolled, displayMap, sizeof(displayMap));
+        CHECK(memcmp(pcd8544_ram(), displayMap, sizeof(displayMap)) == 0);
+        view_invalidate();
+        view_chart(channel, window);
+        mismatches += memcmp(scrolled, displayMap, sizeof(displayMap)) != 0;
+        if (i % (stride * 97) == 0) check_iterator();
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// A constant signal charts as one flat line across every filled column.
+static void test_flat_line(void) {
+    history_init();
+    view_invalidate();
+    for (uint32_t i = 0; i < 100; i++) {
+        env_sample_t sample = make_sample(0);
+        history_add(&sample);
+    }
+    view_chart(HISTORY_ECO2, HISTORY_WINDOW_MINUTE);
+    int row = -1;
+    bool flat = true;
+    for (uint8_t x = CHART_X; x < LCD_WIDTH; x++) {
+        uint8_t lit = 0;
+        for (uint8_t y = CHART_Y; y < LCD_HEIGHT; y++) {
+            if (!pixel(displayMap, x, y)) continue;
+            lit++;
+            if (row < 0) row = y;
+            flat &= (y == row);
+        }
+        flat &= (lit == 1);
+    }
+    CHECK(row >= CHART_Y);
+    CHECK(flat);
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_spi_init();
+    pcd8544_attach(EDGE_P8);
+    lcdBegin();
+    // Every sample, so the minute sparkline scrolls one column at a time,
+    // including while the tier is still filling and once it wraps.
+    test_scroll_matches_redraw(HISTORY_ECO2, HISTORY_WINDOW_MINUTE, 200, 1);
+    test_scroll_matches_redraw(HISTORY_HUMIDITY_TICKS, HISTORY_WINDOW_MINUTE, 200, 1);
+    // Every few minutes for the hour bars.
+    test_scroll_matches_redraw(HISTORY_TEMPERATURE_TICKS, HISTORY_WINDOW_HOUR, 80 * 60, 180);
+    test_flat_line();
+    return test_report("test_chart");
+}
@@ -0,0 +1,74 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "fmt.h"
+#include "sensor.h"
+#include "test.h"
+
+// The integer SHT45 conversions and fmt_centi over every tick value, against
+// the exact rational result and the float formula printed with %.2f. The
+// reference is evaluated in double: in single precision the formula itself
+// misrounds a few values that sit within 1e-6 of a rounding boundary, and
+// those are only counted. printf's "-0.00" is read as "0.00". Every result
+// is also within TOLERANCE of the float formula. The speed comparison is in
+// the benchmark (format_fixed against format_float), not here.
+
+// Half a hundredth from rounding, plus float's own error at 130 C.
+#define TOLERANCE 0.00501
+
+static int single_mismatches = 0;
+
+static float float_celsius(uint16_t ticks) {
+    return -45.0f + (175.0f * (float)ticks / 65535.0f);
+}
+
+static float float_rh(uint16_t ticks) {
+    return -6.0f + (125.0f * (float)ticks / 65535.0f);
+}
+
+static void format_reference(char *dst, size_t size, double value) {
+    snprintf(dst, size, "%.2f", value);
+    if (strcmp(dst, "-0.00") == 0) {
+        strcpy(dst, "0.00");
+    }
+}
+
+static int compare(const char *what, uint32_t ticks, double reference, float single, int16_t centi) {
+    char ref[16], out[16];
+    format_reference(ref, sizeof(ref), reference);
+    *fmt_centi(out, centi) = '\0';
+    if (strcmp(ref, out) != 0) {
+        printf("%s ticks %u: reference %s, fixed %s\n", what, ticks, ref, out);
+        return 1;
+    }
+    format_reference(ref, sizeof(ref), single);
+    single_mismatches += strcmp(ref, out) != 0;
+    return 0;
+}
+
+// round(ticks * scale / 65535), ties up
+static long exact(uint32_t ticks, uint32_t scale, long offset) {
+    return (long)((2ULL * ticks * scale + 65535) / 131070) + offset;
+}
+
+int main(void) {
+    int text_mismatches = 0, exact_mismatches = 0, out_of_tolerance = 0;
+    for (uint32_t t = 0; t < 65536; t++) {
+        int16_t celsius = sht45_ticks_to_centi_celsius((uint16_t)t);
+        int16_t rh = sht45_ticks_to_centi_rh((uint16_t)t);
+        exact_mismatches += celsius != exact(t, 17500, -4500);
+        exact_mismatches += rh != exact(t, 12500, -600);
+        out_of_tolerance += fabs(celsius / 100.0 - float_celsius((uint16_t)t)) > TOLERANCE;
+        out_of_tolerance += fabs(rh / 100.0 - float_rh((uint16_t)t)) > TOLERANCE;
+
+        text_mismatches += compare("T", t, -45.0 + 175.0 * t / 65535.0, float_celsius((uint16_t)t), celsius);
+        text_mismatches += compare("RH", t, -6.0 + 125.0 * t / 65535.0, float_rh((uint16_t)t), rh);
+    }
+    CHECK_EQ(exact_mismatches, 0);
+    CHECK_EQ(text_mismatches, 0);
+    CHECK_EQ(out_of_tolerance, 0);
+    printf("single-precision formula misrounds %d of %d values\n", single_mismatches, 2 * 65536);
+
+    return test_report("test_fixed_point");
+}
@@ -0,0 +1,234 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+// Built in so a reboot can clear the module's RAM state and the pages can be
+// walked with its own readers.
+#include "flashlog.c"
+
+// The flash log on the simulated NVMC: batching, page rotation with the
+// settings carried over, write amplification and recovery reads, then a
+// power cut at every word of a save-and-append sequence that crosses a
+// rotation, each followed by a reboot.
+
+#define MAX_RECORDS (FLASHLOG_PAGES * FLASHLOG_SLOTS)
+
+static uint32_t next_timestamp = 1;
+
+// Power comes back with RAM cleared; only the flash is left.
+static bool reboot(void) {
+    active_page = 0;
+    active_sequence = 0;
+    write_slot = FLASHLOG_SLOTS;
+    record_seq = 0;
+    queue_head = queue_tail = 0;
+    queued = 0;
+    flush_requested = false;
+    op = FLASH_IDLE;
+    op_records = 0;
+    memset(&settings, 0, sizeof(settings));
+    have_settings = false;
+    return flashlog_init();
+}
+
+static void append(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        flashlog_sample_t sample = { next_timestamp, 400, 10, 26000, 30000 };
+        sample.eco2 = (uint16_t)(400 + next_timestamp % 1000);
+        next_timestamp++;
+        flashlog_append_sample(&sample);
+    }
+}
+
+static flashlog_settings_t make_settings(uint8_t minutes) {
+    flashlog_settings_t s = { 7, minutes, true, true, 0x8F00, 0x9100 };
+    return s;
+}
+
+static bool settings_equal(const flashlog_settings_t *a, const flashlog_settings_t *b) {
+    return a->alarm_hours == b->alarm_hours && a->alarm_minutes == b->alarm_minutes &&
+           a->alarm_enabled == b->alarm_enabled && a->baseline_valid == b->baseline_valid &&
+           a->baseline_eco2 == b->baseline_eco2 && a->baseline_tvoc == b->baseline_tvoc;
+}
+
+// Timestamps of every intact sample record, oldest page first. Damaged slots
+// are counted and skipped, as recovery does.
+static uint32_t scan(uint32_t *out, uint32_t *damaged) {
+    uint8_t order[FLASHLOG_PAGES];
+    uint32_t seqs[FLASHLOG_PAGES];
+    uint8_t pages = 0;
+    flashlog_page_header_t hdr;
+    for (uint8_t page = 0; page < FLASHLOG_PAGES; page++) {
+        read_header(page, &hdr);
+        if (hdr.magic != FLASHLOG_MAGIC) continue;
+        uint8_t i = pages++;
+        while (i > 0 && seqs[i - 1] > hdr.sequence) {
+            seqs[i] = seqs[i - 1];
+            order[i] = order[i - 1];
+            i--;
+        }
+        seqs[i] = hdr.sequence;
+        order[i] = page;
+    }
+    uint32_t n = 0;
+    *damaged = 0;
+    for (uint8_t p = 0; p < pages; p++) {
+        for (uint16_t slot = 1; slot < FLASHLOG_SLOTS && !slot_erased(order[p], slot); slot++) {
+            flashlog_record_t rec;
+            read_slot(order[p], slot, &rec);
+            if (!record_valid(&rec)) {
+                (*damaged)++;
+            } else if (rec.type == FLASHLOG_REC_SAMPLE) {
+                memcpy(&out[n++], &rec.payload[0], 4);
+            }
+        }
+    }
+    return n;
+}
+
+static bool increasing(const uint32_t *ts, uint32_t n) {
+    for (uint32_t i = 1; i < n; i++) {
+        if (ts[i] <= ts[i - 1]) return false;
+    }
+    return true;
+}
+
+static void test_format_and_settings(void) {
+    flashlog_settings_t loaded;
+    fstorage_sim_erase_all();
+    CHECK(reboot());
+    CHECK(!flashlog_load_settings(&loaded));
+    flashlog_settings_t saved = make_settings(30);
+    flashlog_save_settings(&saved);
+    CHECK(flashlog_load_settings(&loaded));
+    CHECK(settings_equal(&loaded, &saved));
+
+    CHECK(reboot());
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(flashlog_load_settings(&loaded));
+    CHECK(settings_equal(&loaded, &saved));
+}
+
+// Samples wait for a whole batch; a flush sends a part batch.
+static void test_batching(void) {
+    fstorage_sim_stats_t before, after;
+    fstorage_sim_stats(&before);
+    append(FLASHLOG_BATCH_RECORDS - 1);
+    fstorage_sim_stats(&after);
+    CHECK_EQ(after.programmed_words, before.programmed_words);
+    append(1);
+    fstorage_sim_stats(&after);
+    CHECK_EQ(after.programmed_words - before.programmed_words, FLASHLOG_BATCH_RECORDS * FLASHLOG_RECORD_SIZE / 4);
+
+    append(3);
+    flashlog_flush();
+    fstorage_sim_stats(&before);
+    CHECK_EQ(before.programmed_words - after.programmed_words, 3 * FLASHLOG_RECORD_SIZE / 4);
+}
+
+// Enough samples to go round all four pages twice.
+static void test_rotation(void) {
+    static uint32_t ts[MAX_RECORDS];
+    uint32_t damaged;
+    flashlog_settings_t saved = make_settings(45), loaded;
+    flashlog_save_settings(&saved);
+    fstorage_sim_stats_t before, after;
+    fstorage_sim_stats(&before);
+    uint32_t records = 2 * MAX_RECORDS;
+    append(records);
+    flashlog_flush();
+    fstorage_sim_stats(&after);
+
+    double amplification = (double)(after.programmed_words - before.programmed_words) * 4 /
+                           ((double)records * FLASHLOG_RECORD_SIZE);
+    printf("write amplification %.4f over %lu records, %lu page erases\n", amplification,
+           (unsigned long)records, (unsigned long)(after.erased_pages - before.erased_pages));
+    CHECK(amplification < 1.01);
+    CHECK(after.erased_pages - before.erased_pages >= records / FLASHLOG_SLOTS);
+
+    // Three full pages and the active one, newest last, with nothing damaged.
+    uint32_t n = scan(ts, &damaged);
+    CHECK_EQ(damaged, 0);
+    CHECK(n >= 3 * (FLASHLOG_SLOTS - 2));
+    CHECK(increasing(ts, n));
+    CHECK_EQ(ts[n - 1], next_timestamp - 1);
+
+    // Recovery reads the headers, bisects for the write slot and searches one
+    // page at most for the settings.
+    fstorage_sim_clear_stats();
+    CHECK(reboot());
+    fstorage_sim_stats(&after);
+    printf("recovery read %lu bytes of %u\n", (unsigned long)after.read_bytes,
+           FLASHLOG_PAGES * FLASHLOG_PAGE_SIZE);
+    CHECK(after.read_bytes <= (FLASHLOG_PAGES + 1) * sizeof(flashlog_page_header_t) + 9 * 4 +
+                              FLASHLOG_PAGE_SIZE);
+    CHECK(flashlog_load_settings(&loaded));
+    CHECK(settings_equal(&loaded, &saved));
+}
+
+// A page nearly full, then a settings change and a run of samples that
+// rotates onto the next page, with the power failing after `words` words.
+static bool cut_run(uint32_t words, uint32_t *base_samples) {
+    static uint32_t ts[MAX_RECORDS];
+    uint32_t damaged;
+    fstorage_sim_erase_all();
+    fstorage_sim_power_on();
+    reboot();
+    flashlog_settings_t a = make_settings(10), b = make_settings(20), c = make_settings(30), loaded = {0};
+    flashlog_save_settings(&a);
+    append(FLASHLOG_SLOTS - 10);
+    flashlog_flush();
+    uint32_t last_before = next_timestamp - 1;
+    *base_samples = scan(ts, &damaged);
+
+    fstorage_sim_cut_after(words);
+    flashlog_save_settings(&b);
+    append(4 * FLASHLOG_BATCH_RECORDS);
+    flashlog_flush();
+    bool cut = !fstorage_sim_powered();
+    fstorage_sim_power_on();
+
+    CHECK(reboot());
+    CHECK(flashlog_load_settings(&loaded));
+    CHECK(settings_equal(&loaded, &a) || settings_equal(&loaded, &b));
+    uint32_t n = scan(ts, &damaged);
+    CHECK(damaged <= 1);
+    CHECK(increasing(ts, n));
+    CHECK(n >= *base_samples);
+    CHECK(n > 0 && ts[n - 1] >= last_before);
+
+    // The log carries on from wherever the cut left it.
+    flashlog_save_settings(&c);
+    append(2 * FLASHLOG_BATCH_RECORDS);
+    flashlog_flush();
+    CHECK(reboot());
+    CHECK(flashlog_load_settings(&loaded));
+    CHECK(settings_equal(&loaded, &c));
+    n = scan(ts, &damaged);
+    CHECK(increasing(ts, n));
+    CHECK_EQ(ts[n - 1], next_timestamp - 1);
+    return cut;
+}
+
+static void test_power_cuts(void) {
+    uint32_t base, runs = 0;
+    int failures = test_failures;
+    while (cut_run(runs, &base)) {
+        runs++;
+        if (test_failures != failures) {
+            printf("power cut after %lu words\n", (unsigned long)runs - 1);
+            break;
+        }
+    }
+    printf("power cut at each of %lu words\n", (unsigned long)runs);
+    CHECK(runs > 4 * FLASHLOG_BATCH_RECORDS * FLASHLOG_RECORD_SIZE / 4);
+}
+
+int main(void) {
+    test_format_and_settings();
+    test_batching();
+    test_rotation();
+    test_power_cuts();
+    return test_report("test_flashlog");
+}
@@ -0,0 +1,115 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "font.h"
+#include "lcd.h"
+#include "test.h"
+
+// The compile-time atlases against a plain nearest-neighbour stretch of the
+// 1x glyphs, then drawCharScaled at every scale and at aligned, unaligned
+// and clipped positions against the same glyph set pixel by pixel. The
+// timing of the blitter against setPixel is in the bench (`make bench`).
+
+static bool glyph_bit(const uint8_t *glyph, uint8_t col, uint8_t row) {
+    return (glyph[col] >> row) & 1;
+}
+
+static void test_atlas(void) {
+    for (int c = 0; c < 128; c++) {
+        const uint8_t *glyph = font_glyph((char)c);
+        bool printable = c >= FONT_FIRST && c <= FONT_LAST;
+        CHECK(printable || glyph == font_glyph('?'));
+        for (uint8_t scale = 1; scale <= 3; scale++) {
+            const uint8_t *atlas = font_atlas((char)c, scale);
+            uint16_t width = FONT_WIDTH * scale;
+            uint32_t wrong = 0;
+            for (uint16_t x = 0; x < width; x++) {
+                for (uint16_t y = 0; y < FONT_HEIGHT * scale; y++) {
+                    bool got = (atlas[(y / 8) * width + x] >> (y % 8)) & 1;
+                    wrong += got != glyph_bit(glyph, x / scale, y / scale);
+                }
+            }
+            CHECK_EQ(wrong, 0);
+        }
+        CHECK(font_atlas((char)c, 0) == NULL);
+        CHECK(font_atlas((char)c, 4) == NULL);
+    }
+    CHECK(font_atlas('A', 1) == font_glyph('A'));
+}
+
+static void reference_char(char c, int x, int y, uint8_t scale) {
+    const uint8_t *glyph = font_glyph(c);
+    for (int col = 0; col < FONT_WIDTH * scale; col++) {
+        for (int row = 0; row < FONT_HEIGHT * scale; row++) {
+            int px = x + col, py = y + row;
+            if (px >= LCD_WIDTH || py >= LCD_HEIGHT) continue;
+            if (glyph_bit(glyph, col / scale, row / scale)) setPixel(px, py, 1);
+        }
+    }
+}
+
+static void test_draw(void) {
+    uint8_t drawn[sizeof(displayMap)];
+    uint32_t cases = 0, wrong = 0;
+    for (int c = FONT_FIRST - 1; c <= FONT_LAST; c++) {
+        for (uint8_t scale = 1; scale <= 4; scale++) {
+            for (int y = 0; y < LCD_HEIGHT; y += 3) {
+                for (int x = 0; x < LCD_WIDTH; x += 13) {
+                    lcdClearBuffer();
+                    drawCharScaled((char)c, x, y, scale);
+                    memcpy(drawn, displayMap, sizeof(drawn));
+                    lcdClearBuffer();
+                    reference_char((char)c, x, y, scale);
+                    wrong += memcmp(drawn, displayMap, sizeof(drawn)) != 0;
+                    cases++;
+                }
+            }
+        }
+    }
+    CHECK(cases > 10000);
+    CHECK_EQ(wrong, 0);
+}
+
+// Glyphs are ORed in, so drawing over existing pixels keeps them.
+static void test_overdraw(void) {
+    lcdClearBuffer();
+    for (int y = 0; y < LCD_HEIGHT; y += 2) setPixel(10, y, 1);
+    drawCharScaled('8', 8, 5, 2);
+    for (int y = 0; y < LCD_HEIGHT; y += 2) {
+        CHECK((displayMap[10 + (y / 8) * LCD_WIDTH] >> (y % 8)) & 1);
+    }
+}
+
+// Bytes of displayMap a clock digit lands in, which the blitter ORs once
+// each, against the lit pixels setPixel would read-modify-write one by one.
+static void test_output_bytes(void) {
+    static const char digits[] = "0123456789:";
+    uint32_t bytes = 0, pixels = 0;
+    for (const char *c = digits; *c; c++) {
+        const uint8_t *glyph = font_glyph(*c);
+        for (uint8_t col = 0; col < FONT_WIDTH; col++) {
+            for (uint8_t row = 0; row < FONT_HEIGHT; row++) {
+                pixels += glyph_bit(glyph, col, row) * 2 * 2;
+            }
+        }
+        lcdClearBuffer();
+        drawCharScaled(*c, 10, 13, 2);
+        uint32_t touched = 0;
+        for (uint16_t i = 0; i < sizeof(displayMap); i++) touched += displayMap[i] != 0;
+        // 14 rows from y = 13 cover banks 1 to 3.
+        CHECK(touched <= FONT_WIDTH * 2 * 3);
+        bytes += touched;
+    }
+    printf("clock digits at scale 2: %lu bytes written, %lu setPixel calls\n",
+           (unsigned long)bytes, (unsigned long)pixels);
+    CHECK(bytes * 2 < pixels);
+}
+
+int main(void) {
+    test_atlas();
+    test_draw();
+    test_overdraw();
+    test_output_bytes();
+    return test_report("test_font");
+}
@@ -0,0 +1,70 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "microbit_v2.h"
+#include "hal.h"
+#include "lcd.h"
+#include "view.h"
+#include "sim.h"
+#include "test.h"
+
+// The host backend itself, then a frame through the LCD driver to the
+// virtual panel. Pass a path to also write the frame out as a PBM.
+
+HAL_TIMER_DEF(timer_a);
+HAL_TIMER_DEF(timer_b);
+static uint32_t fired[8];
+static uint8_t fired_count = 0;
+
+static void record_cb(void *p_context) {
+    if (fired_count < 8) fired[fired_count++] = (uint32_t)(uintptr_t)p_context;
+}
+
+static void test_timers(void) {
+    CHECK_EQ(hal_timer_create(&timer_a, false, record_cb), HAL_SUCCESS);
+    CHECK_EQ(hal_timer_create(&timer_b, true, record_cb), HAL_SUCCESS);
+    hal_timer_start(timer_a, 300, (void *)1);
+    hal_timer_start(timer_b, 100, (void *)2);
+    hal_host_advance(350);
+    // b at 100, 200, a at 300, b at 300 (created later, so after a)
+    CHECK_EQ(fired_count, 4);
+    CHECK_EQ(fired[0], 2);
+    CHECK_EQ(fired[1], 2);
+    CHECK_EQ(fired[2], 1);
+    CHECK_EQ(fired[3], 2);
+    hal_timer_stop(timer_b);
+    CHECK(!hal_host_step());
+
+    // Tick arithmetic survives the 24-bit counter wrapping.
+    uint32_t before = hal_ticks();
+    hal_host_advance(HAL_TICKS_MASK);
+    CHECK(hal_ticks() < before);
+    CHECK_EQ(hal_ticks_elapsed(hal_ticks(), before), HAL_TICKS_MASK);
+}
+
+static void test_display(const char *pbm_path) {
+    pcd8544_attach(EDGE_P8);
+    lcdBegin();
+    view_clock(12, 34, 56);
+    lcdFlush();
+    CHECK(memcmp(pcd8544_ram(), displayMap, sizeof(displayMap)) == 0);
+    uint32_t full = pcd8544_data_bytes();
+
+    // One changed digit only resends the columns it covers.
+    view_clock(12, 34, 57);
+    lcdFlush();
+    CHECK(memcmp(pcd8544_ram(), displayMap, sizeof(displayMap)) == 0);
+    CHECK(pcd8544_data_bytes() - full < sizeof(displayMap) / 4);
+
+    if (pbm_path) {
+        CHECK(pcd8544_write_pbm(pbm_path));
+    }
+}
+
+int main(int argc, char **argv) {
+    hal_timer_init();
+    hal_spi_init();
+    test_timers();
+    test_display(argc > 1 ? argv[1] : NULL);
+    return test_report("test_hal");
+}
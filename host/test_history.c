@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "test.h"
+// Built in so the footprint can be taken from the module's own arrays.
+#include "history.c"
+
+// Three simulated days of 1 s samples against brute-force aggregates over
+// everything ever added, plus the store's memory footprint and query cost.
+
+#define DAYS         3
+#define SECONDS      (DAYS * 86400)
+#define CHECK_EVERY  997
+#define QUERY_ROUNDS 1000000
+
+static uint16_t samples[SECONDS][HISTORY_CHANNELS];
+static history_bucket_t minutes[SECONDS / 60][HISTORY_CHANNELS];
+static history_bucket_t quarters[SECONDS / 900][HISTORY_CHANNELS];
+
+static history_bucket_t aggregate(const history_bucket_t *b, long first, long n, uint8_t ch) {
+    history_bucket_t out = { UINT16_MAX, 0, 0 };
+    uint32_t sum = 0;
+    for (long i = first; i < first + n; i++) {
+        if (b[i * HISTORY_CHANNELS + ch].min < out.min) out.min = b[i * HISTORY_CHANNELS + ch].min;
+        if (b[i * HISTORY_CHANNELS + ch].max > out.max) out.max = b[i * HISTORY_CHANNELS + ch].max;
+        sum += b[i * HISTORY_CHANNELS + ch].avg;
+    }
+    out.avg = (uint16_t)((sum + n / 2) / n);
+    return out;
+}
+
+static history_bucket_t raw_aggregate(long first, long n, uint8_t ch) {
+    history_bucket_t out = { UINT16_MAX, 0, 0 };
+    uint32_t sum = 0;
+    for (long i = first; i < first + n; i++) {
+        if (samples[i][ch] < out.min) out.min = samples[i][ch];
+        if (samples[i][ch] > out.max) out.max = samples[i][ch];
+        sum += samples[i][ch];
+    }
+    out.avg = (uint16_t)((sum + n / 2) / n);
+    return out;
+}
+
+static void check_window(history_window_t window, history_bucket_t expected, long count, uint8_t ch) {
+    history_stats_t stats;
+    CHECK(history_query(ch, window, &stats));
+    CHECK_EQ(stats.count, count);
+    CHECK_EQ(stats.min, expected.min);
+    CHECK_EQ(stats.max, expected.max);
+    CHECK_EQ(stats.avg, expected.avg);
+}
+
+// Everything added up to and including sample n.
+static void check_all(long n) {
+    long added = n + 1, closed_minutes = added / 60, closed_quarters = added / 900;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        long raw_n = added < HISTORY_RAW_LEN ? added : HISTORY_RAW_LEN;
+        check_window(HISTORY_WINDOW_MINUTE, raw_aggregate(added - raw_n, raw_n, ch), raw_n, ch);
+        history_bucket_t b = {0};
+        CHECK(history_get(ch, HISTORY_WINDOW_MINUTE, raw_n - 1, &b));
+        CHECK_EQ(b.avg, samples[added - raw_n][ch]);
+
+        if (closed_minutes > 0) {
+            long m_n = closed_minutes < HISTORY_MINUTE_LEN ? closed_minutes : HISTORY_MINUTE_LEN;
+            check_window(HISTORY_WINDOW_HOUR, aggregate(&minutes[0][0], closed_minutes - m_n, m_n, ch), m_n, ch);
+            CHECK(history_get(ch, HISTORY_WINDOW_HOUR, m_n - 1, &b));
+            CHECK_EQ(b.avg, minutes[closed_minutes - m_n][ch].avg);
+        }
+        if (closed_quarters > 0) {
+            long q_n = closed_quarters < HISTORY_QUARTER_LEN ? closed_quarters : HISTORY_QUARTER_LEN;
+            check_window(HISTORY_WINDOW_DAY, aggregate(&quarters[0][0], closed_quarters - q_n, q_n, ch), q_n, ch);
+        }
+    }
+}
+
+static double query_ns(void) {
+    struct timespec t0, t1;
+    volatile uint32_t sink = 0;
+    history_stats_t stats = {0};
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < QUERY_ROUNDS; i++) {
+        history_query(i % HISTORY_CHANNELS, i % HISTORY_WINDOWS, &stats);
+        sink += stats.avg;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / QUERY_ROUNDS;
+}
+
+// Full-scale steps both ways, as after an SHT45 outage: each sample decodes
+// exactly from the raw tier and lands unchanged in its minute bucket.
+static void test_full_scale_jump(void) {
+    static const uint16_t steps[] = { 0x0000, 0xFFFF, 0x0000, 0x8000, 0x7FFF, 0xFFFF, 0x0001 };
+    history_init();
+    for (uint8_t i = 0; i < HISTORY_RAW_LEN; i++) {
+        uint16_t value = steps[(i / 10) % (sizeof(steps) / sizeof(steps[0]))];
+        env_sample_t sample = {0};
+        sample.air.eco2 = value;
+        sample.climate.temperature_ticks = value;
+        history_add(&sample);
+    }
+    for (uint8_t age = 0; age < HISTORY_RAW_LEN; age++) {
+        uint16_t expected = steps[((HISTORY_RAW_LEN - 1 - age) / 10) % (sizeof(steps) / sizeof(steps[0]))];
+        history_bucket_t b = {0};
+        CHECK(history_get(HISTORY_TEMPERATURE_TICKS, HISTORY_WINDOW_MINUTE, age, &b));
+        CHECK_EQ(b.avg, expected);
+        CHECK(history_get(HISTORY_ECO2, HISTORY_WINDOW_MINUTE, age, &b));
+        CHECK_EQ(b.avg, expected);
+    }
+    history_bucket_t b = {0};
+    CHECK(history_get(HISTORY_ECO2, HISTORY_WINDOW_HOUR, 0, &b));
+    CHECK_EQ(b.min, 0x0000);
+    CHECK_EQ(b.max, 0xFFFF);
+    // Ten samples each of 0, 0xFFFF, 0, 0x8000, 0x7FFF, 0xFFFF.
+    CHECK_EQ(b.avg, (10UL * (0xFFFF + 0x8000 + 0x7FFF + 0xFFFF) + 30) / 60);
+}
+
+int main(void) {
+    size_t footprint = sizeof(raw_min_q) + sizeof(raw_max_q) + sizeof(minute_min_q) + sizeof(minute_max_q) +
+                       sizeof(quarter_min_q) + sizeof(quarter_max_q) + sizeof(windows) +
+                       sizeof(raw_delta) + sizeof(raw_anchor) + sizeof(raw_last) +
+                       sizeof(minute_buckets) + sizeof(quarter_buckets) + sizeof(minute_acc) + sizeof(quarter_acc);
+    printf("history footprint %zu bytes\n", footprint);
+    CHECK(footprint <= 12 * 1024);
+
+    test_full_scale_jump();
+    history_init();
+    srand(1);
+    uint16_t v[HISTORY_CHANNELS] = { 400, 0, 26000, 30000 };
+    double early_ns = 0;
+    for (long n = 0; n < SECONDS; n++) {
+        for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+            // A random walk with the odd jump anywhere in the 16-bit range.
+            int32_t next = v[ch] + rand() % 201 - 100;
+            if (rand() % 5000 == 0) next = rand() % 65536;
+            v[ch] = next < 0 ? 0 : next > 65535 ? 65535 : next;
+            samples[n][ch] = v[ch];
+        }
+        env_sample_t sample = {0};
+        sample.air.eco2 = v[HISTORY_ECO2];
+        sample.air.tvoc = v[HISTORY_TVOC];
+        sample.climate.temperature_ticks = v[HISTORY_TEMPERATURE_TICKS];
+        sample.climate.humidity_ticks = v[HISTORY_HUMIDITY_TICKS];
+        history_add(&sample);
+
+        if ((n + 1) % 60 == 0) {
+            long m = (n + 1) / 60 - 1;
+            for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+                minutes[m][ch] = raw_aggregate(m * 60, 60, ch);
+            }
+            if ((m + 1) % HISTORY_QUARTER_MINUTES == 0) {
+                long q = (m + 1) / HISTORY_QUARTER_MINUTES - 1;
+                for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+                    quarters[q][ch] = aggregate(&minutes[0][0], q * HISTORY_QUARTER_MINUTES, HISTORY_QUARTER_MINUTES, ch);
+                }
+            }
+        }
+        if (n % CHECK_EVERY == 0 || n == SECONDS - 1) {
+            check_all(n);
+        }
+        if (n == 3600) {
+            early_ns = query_ns();
+        }
+    }
+    CHECK_EQ(history_minutes_total(), SECONDS / 60);
+    CHECK_EQ(history_total(HISTORY_WINDOW_DAY), SECONDS / 900);
+
+    double late_ns = query_ns();
+    printf("query cost: %.1f ns after 1 hour, %.1f ns after %d days\n", early_ns, late_ns, DAYS);
+    CHECK(late_ns < 4 * early_ns + 20);
+
+    return test_report("test_history");
+}
@@ -0,0 +1,118 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sdk_errors.h"
+#include "hal.h"
+#include "i2c_sched.h"
+#include "sim.h"
+#include "test.h"
+
+// An SGP30 and an SHT45 measurement through the scheduler on the simulated
+// bus, one after the other as the sensors used to be read and then with
+// both conversions overlapped, at 100 kHz and at 400 kHz. Reports the
+// latency of a whole sample and the share of it the bus was busy.
+
+#define SGP30_ADDR       0x58
+#define SHT45_ADDR       0x44
+#define SGP30_MEASURE_MS 12
+#define SHT45_MEASURE_MS 9
+
+static uint32_t bus(uint8_t addr, bool read, uint8_t *data, uint8_t len) {
+    if (addr != SGP30_ADDR && addr != SHT45_ADDR) {
+        return NRF_ERROR_DRV_TWI_ERR_ANACK;
+    }
+    if (read) {
+        for (uint8_t i = 0; i < len; i++) data[i] = (uint8_t)(addr + i);
+    }
+    return NRF_SUCCESS;
+}
+
+static i2c_job_t sgp30 = {
+    .addr = SGP30_ADDR, .cmd = { 0x20, 0x08 }, .cmd_len = 2, .rx_len = 6,
+    .conversion_ms = SGP30_MEASURE_MS,
+};
+static i2c_job_t sht45 = {
+    .addr = SHT45_ADDR, .cmd = { 0xFD }, .cmd_len = 1, .rx_len = 6,
+    .conversion_ms = SHT45_MEASURE_MS,
+};
+
+static i2c_job_t *finished[2];
+static uint8_t finished_count = 0;
+static uint64_t finished_at = 0;
+
+static void job_done(i2c_job_t *job, ret_code_t result) {
+    CHECK_EQ(result, NRF_SUCCESS);
+    for (uint8_t i = 0; i < job->rx_len; i++) {
+        CHECK_EQ(job->rx[i], (uint8_t)(job->addr + i));
+    }
+    if (finished_count < 2) finished[finished_count++] = job;
+    finished_at = hal_host_now();
+}
+
+static void wait_for(uint8_t count) {
+    while (finished_count < count && hal_host_step()) {
+    }
+    CHECK_EQ(finished_count, count);
+}
+
+typedef struct {
+    uint64_t latency;
+    uint64_t busy;
+} sample_cost_t;
+
+static sample_cost_t take_sample(bool overlapped) {
+    finished_count = 0;
+    uint64_t start = hal_host_now();
+    uint64_t busy = twi_mngr_sim_busy_ticks();
+    CHECK_EQ(i2c_sched_submit(&sgp30), NRF_SUCCESS);
+    if (!overlapped) wait_for(1);
+    CHECK_EQ(i2c_sched_submit(&sht45), NRF_SUCCESS);
+    wait_for(2);
+    CHECK(i2c_sched_idle());
+    return (sample_cost_t){ finished_at - start, twi_mngr_sim_busy_ticks() - busy };
+}
+
+static void report(const char *name, uint32_t khz, sample_cost_t c) {
+    printf("%s at %lu kHz: %lu us per sample, bus busy %lu us (%lu%%)\n", name, (unsigned long)khz,
+           (unsigned long)(c.latency * 1000000 / HAL_TICKS_PER_SECOND),
+           (unsigned long)(c.busy * 1000000 / HAL_TICKS_PER_SECOND),
+           (unsigned long)(c.busy * 100 / c.latency));
+}
+
+static void test_schedules(uint32_t khz) {
+    twi_mngr_sim_clock(khz * 1000);
+    sample_cost_t sequential = take_sample(false);
+    CHECK(finished[0] == &sgp30);
+    sample_cost_t overlapped = take_sample(true);
+    // Deadline order: the shorter SHT45 conversion is read first.
+    CHECK(finished[0] == &sht45);
+    report("sequential", khz, sequential);
+    report("overlapped", khz, overlapped);
+
+    CHECK(sequential.latency >= HAL_MS_TO_TICKS(SGP30_MEASURE_MS + SHT45_MEASURE_MS));
+    CHECK(overlapped.latency <= HAL_MS_TO_TICKS(SGP30_MEASURE_MS) + overlapped.busy);
+    CHECK(overlapped.latency < sequential.latency);
+    CHECK_EQ(overlapped.busy, sequential.busy);
+}
+
+static void test_faster_bus(void) {
+    twi_mngr_sim_clock(100000);
+    sample_cost_t slow = take_sample(true);
+    twi_mngr_sim_clock(400000);
+    sample_cost_t fast = take_sample(true);
+    CHECK(fast.busy * 2 < slow.busy);
+    CHECK(fast.latency < slow.latency);
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_i2c_init();
+    hal_host_i2c_attach(bus);
+    i2c_sched_init();
+    sgp30.handler = job_done;
+    sht45.handler = job_done;
+    test_schedules(100);
+    test_schedules(400);
+    test_faster_bus();
+    return test_report("test_i2c_sched");
+}
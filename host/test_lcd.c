@@ -0,0 +1,215 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "microbit_v2.h"
+#include "hal.h"
+#include "lcd.h"
+#include "sim.h"
+#include "test.h"
+
+// The LCD driver measured at the virtual panel: init commands go out as one
+// batch and a full frame as one DMA transfer, each under one chip select.
+// Dirty-span diffing then sends only the changed spans, nearby changes share one gotoXY, a
+// crowded bank folds into its last span, and whatever the drawing, frame
+// pacing or dropped frames, the panel ends up matching the back buffer.
+
+static bool notified = false;
+
+static void frame_notify(void) {
+    notified = true;
+}
+
+typedef struct {
+    uint32_t data;
+    uint32_t commands;
+    uint32_t frames;
+} traffic_t;
+
+#define LCD_SCE_PIN EDGE_P1
+
+static traffic_t traffic(void) {
+    uint32_t sent, dropped;
+    lcdFrameStats(&sent, &dropped);
+    return (traffic_t){ pcd8544_data_bytes(), pcd8544_command_bytes(), sent };
+}
+
+// Flushes and returns what the frame cost on the bus.
+static traffic_t flush(void) {
+    traffic_t before = traffic();
+    lcdFlush();
+    traffic_t after = traffic();
+    CHECK(memcmp(pcd8544_ram(), displayMap, sizeof(displayMap)) == 0);
+    return (traffic_t){ after.data - before.data, after.commands - before.commands,
+                        after.frames - before.frames };
+}
+
+// A byte per transaction, as the driver used to write, would be 504
+// transactions and chip selects for a full frame, and 6 for the init.
+static void test_bulk_writes(void) {
+    uint32_t transactions = pcd8544_transactions();
+    uint32_t selects = hal_host_gpio_falls(LCD_SCE_PIN);
+    lcdBegin();
+    CHECK_EQ(pcd8544_command_bytes(), 6);
+    CHECK_EQ(pcd8544_transactions() - transactions, 1);
+    CHECK_EQ(hal_host_gpio_falls(LCD_SCE_PIN) - selects, 1);
+
+    // The first frame after init is the whole buffer. Queuing it costs no
+    // time; the DMA runs in the background.
+    drawStringScaled("12:34", 0, 10, 2, 2);
+    transactions = pcd8544_transactions();
+    selects = hal_host_gpio_falls(LCD_SCE_PIN);
+    traffic_t before = traffic();
+    uint64_t start = hal_host_now();
+    updateDisplay();
+    CHECK_EQ(hal_host_now(), start);
+    lcdFlush();
+    uint64_t bus_ticks = hal_host_now() - start;
+    traffic_t after = traffic();
+    CHECK(memcmp(pcd8544_ram(), displayMap, sizeof(displayMap)) == 0);
+    CHECK_EQ(after.frames - before.frames, 1);
+    CHECK_EQ(after.data - before.data, sizeof(displayMap));
+    CHECK_EQ(after.commands - before.commands, 2);
+    CHECK_EQ(pcd8544_transactions() - transactions, 2);
+    CHECK_EQ(hal_host_gpio_falls(LCD_SCE_PIN) - selects, 1);
+    printf("full frame: %lu transactions, %lu chip select, %lu us on the bus\n",
+           (unsigned long)(pcd8544_transactions() - transactions),
+           (unsigned long)(hal_host_gpio_falls(LCD_SCE_PIN) - selects),
+           (unsigned long)(bus_ticks * 1000000 / HAL_TICKS_PER_SECOND));
+    // 506 bytes at 4 MHz, plus a tick of rounding for each transfer.
+    CHECK(bus_ticks <= HAL_MS_TO_TICKS(1) + 3);
+}
+
+static void test_spans(void) {
+    lcdClearBuffer();
+    updateDisplay();
+    flush();
+
+    setPixel(10, 3, 1);
+    updateDisplay();
+    traffic_t t = flush();
+    CHECK_EQ(t.frames, 1);
+    CHECK_EQ(t.data, 1);
+    CHECK_EQ(t.commands, 2);
+
+    // A gap shorter than the merge distance is cheaper to resend.
+    setPixel(20, 3, 1);
+    setPixel(23, 3, 1);
+    updateDisplay();
+    t = flush();
+    CHECK_EQ(t.data, 4);
+    CHECK_EQ(t.commands, 2);
+
+    // Further apart, and in two banks, they are separate spans.
+    setPixel(40, 3, 1);
+    setPixel(60, 3, 1);
+    setPixel(60, 40, 1);
+    updateDisplay();
+    t = flush();
+    CHECK_EQ(t.data, 3);
+    CHECK_EQ(t.commands, 6);
+
+    // Six changes in one bank: three spans, then the rest folded into a fourth.
+    for (uint8_t x = 0; x < 60; x += 10) setPixel(x, 12, 1);
+    updateDisplay();
+    t = flush();
+    CHECK_EQ(t.commands, 8);
+    CHECK_EQ(t.data, 3 + 21);
+
+    // Drawn and erased again before the frame: dirty but unchanged, so nothing is sent.
+    setPixel(70, 30, 1);
+    setPixel(70, 30, 0);
+    updateDisplay();
+    t = flush();
+    CHECK_EQ(t.frames, 0);
+    CHECK_EQ(t.data, 0);
+}
+
+// A day of the clock face repainted from scratch every 100 ms, as the main
+// loop used to: clear, draw the time, update. Only the digits that changed
+// reach the bus, and repaints within the same second send nothing.
+static void test_clock_day(void) {
+    lcdClearBuffer();
+    updateDisplay();
+    flush();
+    traffic_t before = traffic();
+    uint32_t renders = 0;
+    for (uint32_t t = 0; t < 24 * 3600; t++) {
+        char text[9];
+        snprintf(text, sizeof(text), "%02lu:%02lu:%02lu", (unsigned long)(t / 3600),
+                 (unsigned long)(t / 60 % 60), (unsigned long)(t % 60));
+        for (uint8_t i = 0; i < 10; i++) {
+            lcdClearBuffer();
+            drawStringScaled(text, 0, 16, 1, 1);
+            updateDisplay();
+            renders++;
+            hal_host_advance(HAL_MS_TO_TICKS(100));
+            if (notified) {
+                notified = false;
+                lcdService();
+            }
+        }
+    }
+    flush();
+    traffic_t after = traffic();
+    uint64_t sent = (uint64_t)(after.data - before.data) + (after.commands - before.commands);
+    uint64_t full = (uint64_t)renders * (sizeof(displayMap) + 2);
+    printf("24 h clock: %llu SPI bytes in %lu frames, full frames would be %llu (%.1fx)\n",
+           (unsigned long long)sent, (unsigned long)(after.frames - before.frames),
+           (unsigned long long)full, (double)full / (double)sent);
+    CHECK_EQ(after.frames - before.frames, 24 * 3600);
+    // A seconds digit or two each frame, with the gotoXY in front.
+    CHECK(sent <= 24 * 3600 * (2 * 6 + 2) + 24 * 60 * 12 * 2);
+}
+
+// Random drawing from a main loop that renders faster than frames are paced,
+// so some frames are dropped and folded into the next.
+static void test_random_frames(void) {
+    srand(2024);
+    uint32_t sent0, dropped0, sent1, dropped1;
+    lcdFrameStats(&sent0, &dropped0);
+    for (uint32_t frame = 0; frame < 3000; frame++) {
+        uint8_t x = rand() % LCD_WIDTH, y = rand() % LCD_HEIGHT;
+        switch (rand() % 5) {
+        case 0:
+            clearRect(x, y, rand() % 20 + 1, rand() % 20 + 1);
+            break;
+        case 1:
+            drawVLine(x, y, rand() % LCD_HEIGHT);
+            break;
+        case 2:
+            scrollRectLeft(x, y, rand() % 30 + 1, rand() % 30 + 1, rand() % 4 + 1);
+            break;
+        case 3:
+            drawCharScaled((char)(' ' + rand() % 95), x, y, rand() % 3 + 1);
+            break;
+        default:
+            setPixel(x, y, rand() & 1);
+            break;
+        }
+        updateDisplay();
+        // 10 ms per render, under the frame interval.
+        hal_host_advance(HAL_MS_TO_TICKS(10));
+        if (notified) {
+            notified = false;
+            lcdService();
+        }
+    }
+    flush();
+    lcdFrameStats(&sent1, &dropped1);
+    CHECK(sent1 - sent0 > 500);
+    CHECK(dropped1 - dropped0 > 500);
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_spi_init();
+    pcd8544_attach(EDGE_P8);
+    lcdSetFrameNotify(frame_notify);
+    test_bulk_writes();
+    test_spans();
+    test_clock_day();
+    test_random_frames();
+    return test_report("test_lcd");
+}
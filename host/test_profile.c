@@ -0,0 +1,64 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "test.h"
+// Built in to reach the bucketing and percentile helpers.
+#include "profile.c"
+
+// Percentiles from the log-linear histogram against the exact order
+// statistics of the same samples: never low, at most 25% high.
+
+#define SAMPLES 20000
+
+static uint32_t values[SAMPLES];
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void check_distribution(const char *name, uint32_t (*next)(void)) {
+    profile_reset();
+    for (int i = 0; i < SAMPLES; i++) {
+        values[i] = next();
+        profile_record(PROFILE_MAIN_LOOP, values[i]);
+    }
+    qsort(values, SAMPLES, sizeof(values[0]), cmp_u32);
+    static const uint8_t pcts[] = { 1, 50, 90, 99, 100 };
+    for (size_t i = 0; i < sizeof(pcts); i++) {
+        uint32_t exact = values[((uint64_t)SAMPLES * pcts[i] + 99) / 100 - 1];
+        uint32_t reported = percentile(&hists[PROFILE_MAIN_LOOP], pcts[i]);
+        printf("%s p%u: exact %lu, reported %lu\n", name, pcts[i], (unsigned long)exact, (unsigned long)reported);
+        CHECK(reported >= exact);
+        CHECK((uint64_t)reported * 4 <= (uint64_t)exact * 5);
+    }
+}
+
+static uint32_t uniform(void) {
+    return 1000 + rand() % 100000;
+}
+
+// Mostly fast with a slow tail, like a loop that sometimes redraws.
+static uint32_t bimodal(void) {
+    return (rand() % 100 < 95) ? 3000 + rand() % 500 : 250000 + rand() % 50000;
+}
+
+static uint32_t tiny(void) {
+    return rand() % 9;
+}
+
+int main(void) {
+    srand(1);
+    for (uint32_t v = 0; v < 1000000; v += 7) {
+        uint8_t b = bucket_of(v);
+        CHECK(b < PROFILE_BUCKETS);
+        CHECK(bucket_upper(b) >= v);
+        CHECK(b == 0 || bucket_upper(b - 1) < v);
+    }
+    CHECK_EQ(bucket_of(UINT32_MAX), PROFILE_BUCKETS - 1);
+    CHECK_EQ(bucket_upper(PROFILE_BUCKETS - 1), UINT32_MAX);
+
+    check_distribution("uniform", uniform);
+    check_distribution("bimodal", bimodal);
+    check_distribution("tiny", tiny);
+    return test_report("test_profile");
+}
@@ -0,0 +1,244 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "alarm.h"
+#include "rules.h"
+#include "telemetry.h"
+#include "test.h"
+
+// rules.c against stand-in alarm and telemetry modules: sustain holds off
+// single-sample spikes, hysteresis keeps a rule on through the band below
+// its threshold, and each excursion produces exactly one on/off pair.
+
+static bool raised[ALARM_SRC_COUNT];
+static int rule_on[RULES_MAX];
+static int rule_off[RULES_MAX];
+static bool rule_is_on[RULES_MAX];
+
+void alarm_raise(alarm_source_t source) {
+    raised[source] = true;
+}
+
+void alarm_clear(alarm_source_t source) {
+    raised[source] = false;
+}
+
+bool telemetry_event(telemetry_event_t code, uint16_t arg) {
+    if (code == TELEMETRY_EVT_RULE_ON) {
+        rule_on[arg]++;
+        rule_is_on[arg] = true;
+    } else if (code == TELEMETRY_EVT_RULE_OFF) {
+        rule_off[arg]++;
+        rule_is_on[arg] = false;
+    }
+    return true;
+}
+
+static void reset_counts(void) {
+    for (uint8_t i = 0; i < RULES_MAX; i++) {
+        rule_on[i] = rule_off[i] = 0;
+        rule_is_on[i] = false;
+    }
+}
+
+static env_sample_t sample;
+
+static void feed(uint16_t *field, uint16_t value) {
+    *field = value;
+    rules_evaluate(&sample);
+}
+
+// The default eCO2 rule: above 800 ppm for 3 samples, released at 750.
+static void test_above(void) {
+    rules_init();
+    reset_counts();
+    sample = (env_sample_t){0};
+    sample.air.eco2 = 400;
+
+    // Spikes shorter than the sustain never fire.
+    static const uint16_t flicker[] = { 801, 799, 805, 810, 800, 900, 901, 700 };
+    for (uint8_t i = 0; i < sizeof(flicker) / sizeof(flicker[0]); i++) {
+        feed(&sample.air.eco2, flicker[i]);
+    }
+    CHECK_EQ(rule_on[2], 0);
+    CHECK(!raised[ALARM_SRC_ECO2]);
+
+    feed(&sample.air.eco2, 801);
+    feed(&sample.air.eco2, 802);
+    CHECK(!rule_is_on[2]);
+    feed(&sample.air.eco2, 803);
+    CHECK(rule_is_on[2]);
+    CHECK(raised[ALARM_SRC_ECO2]);
+
+    // Wandering inside the band neither releases nor re-fires.
+    static const uint16_t band[] = { 799, 760, 751, 820, 790, 810, 751, 805 };
+    for (uint8_t i = 0; i < sizeof(band) / sizeof(band[0]); i++) {
+        feed(&sample.air.eco2, band[i]);
+        CHECK(rule_is_on[2]);
+    }
+    CHECK_EQ(rule_on[2], 1);
+    CHECK_EQ(rule_off[2], 0);
+
+    feed(&sample.air.eco2, 750);
+    CHECK(!rule_is_on[2]);
+    CHECK(!raised[ALARM_SRC_ECO2]);
+    CHECK_EQ(rule_off[2], 1);
+
+    // A second excursion needs the full sustain again.
+    feed(&sample.air.eco2, 900);
+    feed(&sample.air.eco2, 900);
+    CHECK_EQ(rule_on[2], 1);
+    feed(&sample.air.eco2, 900);
+    CHECK_EQ(rule_on[2], 2);
+
+    // The other defaults track their own channels.
+    CHECK_EQ(rule_on[0] + rule_on[1], 0);
+    CHECK(!raised[ALARM_SRC_TEMPERATURE] && !raised[ALARM_SRC_HUMIDITY]);
+}
+
+// A rule on a stale or invalid half is held as it was: the carried-over value
+// neither counts toward the sustain nor releases it, while the other half's
+// rules keep running.
+static void test_stale(void) {
+    static const rule_t table[] = {
+        { HISTORY_ECO2, RULE_ABOVE, 2, 0, 800, 50, ALARM_SRC_ECO2 },
+        { HISTORY_HUMIDITY_TICKS, RULE_ABOVE, 1, 0,
+          RULE_CENTI_RH_TICKS(7000), RULE_CENTI_RH_SPAN(200), ALARM_SRC_HUMIDITY },
+    };
+    CHECK(rules_load(table, 2));
+    reset_counts();
+    sample = (env_sample_t){0};
+
+    sample.air_status = SENSOR_STALE;
+    for (uint8_t i = 0; i < 5; i++) {
+        feed(&sample.air.eco2, 900);
+    }
+    CHECK_EQ(rule_on[0], 0);
+    feed(&sample.climate.humidity_ticks, RULE_CENTI_RH_TICKS(7500));
+    CHECK(rule_is_on[1]);
+
+    sample.air_status = SENSOR_OK;
+    feed(&sample.air.eco2, 900);
+    sample.air_status = SENSOR_INVALID;
+    feed(&sample.air.eco2, 900);
+    CHECK_EQ(rule_on[0], 0);
+    sample.air_status = SENSOR_OK;
+    feed(&sample.air.eco2, 900);
+    CHECK(rule_is_on[0]);
+    CHECK(raised[ALARM_SRC_ECO2]);
+
+    // Going stale below the release point keeps it on until a fresh reading.
+    sample.air_status = SENSOR_STALE;
+    feed(&sample.air.eco2, 400);
+    CHECK(rule_is_on[0]);
+    CHECK(raised[ALARM_SRC_ECO2]);
+    sample.air_status = SENSOR_OK;
+    feed(&sample.air.eco2, 400);
+    CHECK(!rule_is_on[0]);
+    CHECK(rule_is_on[1]);
+}
+
+static void test_below_and_shared_source(void) {
+    static const rule_t table[] = {
+        { HISTORY_TEMPERATURE_TICKS, RULE_BELOW, 1, 0,
+          RULE_CENTI_CELSIUS_TICKS(1000), RULE_CENTI_CELSIUS_SPAN(100), ALARM_SRC_TEMPERATURE },
+        { HISTORY_TEMPERATURE_TICKS, RULE_ABOVE, 1, 0,
+          RULE_CENTI_CELSIUS_TICKS(3000), RULE_CENTI_CELSIUS_SPAN(100), ALARM_SRC_TEMPERATURE },
+    };
+    CHECK(rules_load(table, 2));
+    reset_counts();
+    sample = (env_sample_t){0};
+    uint16_t *t = &sample.climate.temperature_ticks;
+
+    feed(t, RULE_CENTI_CELSIUS_TICKS(2000));
+    CHECK(!raised[ALARM_SRC_TEMPERATURE]);
+    feed(t, RULE_CENTI_CELSIUS_TICKS(900));
+    CHECK(rule_is_on[0]);
+    CHECK(raised[ALARM_SRC_TEMPERATURE]);
+    feed(t, RULE_CENTI_CELSIUS_TICKS(1050));
+    CHECK(rule_is_on[0]);
+    feed(t, RULE_CENTI_CELSIUS_TICKS(1150));
+    CHECK(!rule_is_on[0]);
+    CHECK(!raised[ALARM_SRC_TEMPERATURE]);
+
+    // Either rule keeps the shared source raised.
+    feed(t, RULE_CENTI_CELSIUS_TICKS(3100));
+    CHECK(rule_is_on[1]);
+    CHECK(raised[ALARM_SRC_TEMPERATURE]);
+    feed(t, RULE_CENTI_CELSIUS_TICKS(2950));
+    CHECK(raised[ALARM_SRC_TEMPERATURE]);
+    feed(t, RULE_CENTI_CELSIUS_TICKS(2800));
+    CHECK(!raised[ALARM_SRC_TEMPERATURE]);
+    CHECK_EQ(rule_on[0] + rule_on[1], 2);
+    CHECK_EQ(rule_off[0] + rule_off[1], 2);
+}
+
+// TVOC climbing more than 100 ppb over 5 samples, released below 80.
+static void test_rise(void) {
+    static const rule_t table[] = {
+        { HISTORY_TVOC, RULE_RISE, 1, 5, 100, 20, ALARM_SRC_ECO2 },
+    };
+    CHECK(rules_load(table, 1));
+    reset_counts();
+    sample = (env_sample_t){0};
+
+    // The window keeps earlier samples across a reload, so settle it first.
+    for (uint8_t i = 0; i < RULES_MAX_WINDOW; i++) {
+        feed(&sample.air.tvoc, 500);
+    }
+    reset_counts();
+
+    // 25 ppb per sample is exactly 100 over the window: not enough.
+    uint16_t v = 500;
+    for (uint8_t i = 0; i < 8; i++) {
+        feed(&sample.air.tvoc, v += 20);
+    }
+    CHECK_EQ(rule_on[0], 0);
+    for (uint8_t i = 0; i < 5; i++) {
+        feed(&sample.air.tvoc, v += 25);
+    }
+    CHECK_EQ(rule_on[0], 1);
+    CHECK(raised[ALARM_SRC_ECO2]);
+    // Slowing to 17 per sample (85 over the window) is inside the band.
+    for (uint8_t i = 0; i < 5; i++) {
+        feed(&sample.air.tvoc, v += 17);
+    }
+    CHECK(rule_is_on[0]);
+    // Flat again releases it.
+    for (uint8_t i = 0; i < 5; i++) {
+        feed(&sample.air.tvoc, v);
+    }
+    CHECK(!rule_is_on[0]);
+    CHECK_EQ(rule_off[0], 1);
+}
+
+static void test_load_rejects(void) {
+    const rule_t good = { HISTORY_ECO2, RULE_ABOVE, 1, 0, 800, 50, ALARM_SRC_ECO2 };
+    rule_t bad;
+    rule_t many[RULES_MAX + 1];
+    for (uint8_t i = 0; i <= RULES_MAX; i++) {
+        many[i] = good;
+    }
+    CHECK(!rules_load(many, RULES_MAX + 1));
+    bad = good;
+    bad.channel = HISTORY_CHANNELS;
+    CHECK(!rules_load(&bad, 1));
+    bad = good;
+    bad.source = ALARM_SRC_COUNT;
+    CHECK(!rules_load(&bad, 1));
+    bad = good;
+    bad.kind = RULE_RISE;
+    bad.window = RULES_MAX_WINDOW;
+    CHECK(!rules_load(&bad, 1));
+    bad.window = 0;
+    CHECK(!rules_load(&bad, 1));
+    CHECK(rules_load(many, RULES_MAX));
+}
+
+int main(void) {
+    test_above();
+    test_stale();
+    test_below_and_shared_source();
+    test_rise();
+    test_load_rejects();
+    return test_report("test_rules");
+}
@@ -0,0 +1,141 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "hal.h"
+#include "schedule.h"
+#include "timekeeping.h"
+#include "test.h"
+
+// A month of simulated wall time against a brute-force list of when every
+// slot should go off: alarms fire in due-time order, on the right days and
+// the right second, ONCE slots fire once, disabled slots never, and snoozes
+// land on top of the rest. Run again with a clock trim, where long waits are
+// split and the due time is re-checked against the corrected clock.
+
+#define DAYS       31
+#define MAX_TIMES  1024
+#define SNOOZE_MIN 5
+
+HAL_TIMER_DEF(clock_timer);
+static volatile bool notified = false;
+
+static uint32_t fired_at[MAX_TIMES];
+static uint32_t fired_count = 0;
+static uint32_t expected[MAX_TIMES];
+static uint32_t expected_count = 0;
+
+static void schedule_notify(void) {
+    notified = true;
+}
+
+// Keeps the 24-bit tick counter extended, as main's clock timer does.
+static void clock_timer_cb(void *p_context) {
+    (void)p_context;
+    timekeeping_ticks();
+}
+
+static void expect(uint32_t t) {
+    for (uint32_t i = 0; i < expected_count; i++) {
+        if (expected[i] == t) return;
+    }
+    if (expected_count < MAX_TIMES) expected[expected_count++] = t;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static const schedule_alarm_t alarms[SCHEDULE_MAX] = {
+    { 7, 0, SCHEDULE_DAILY, true },
+    { 7, 0, SCHEDULE_WEEKDAYS, true },   // same minute as slot 0
+    { 7, 1, SCHEDULE_WEEKEND, true },
+    { 0, 0, SCHEDULE_DAILY, true },
+    { 23, 59, SCHEDULE_DAILY, true },
+    { 12, 30, 0x15, true },              // Monday, Wednesday, Friday
+    { 9, 15, SCHEDULE_ONCE, true },
+    { 8, 0, SCHEDULE_DAILY, false },
+};
+
+static void expect_alarms(uint32_t start, uint32_t end) {
+    for (uint8_t slot = 0; slot < SCHEDULE_MAX; slot++) {
+        const schedule_alarm_t *a = &alarms[slot];
+        if (!a->enabled) continue;
+        for (uint32_t day = 0; day <= DAYS + 1; day++) {
+            uint32_t t = day * 86400 + a->hours * 3600 + a->minutes * 60;
+            if (t <= start || t > end) continue;
+            if (a->days == SCHEDULE_ONCE) {
+                expect(t);
+                break;
+            }
+            if (a->days & (1 << timekeeping_weekday(day))) expect(t);
+        }
+    }
+}
+
+static void run(int32_t trim_ppm, uint32_t tolerance_s) {
+    fired_count = expected_count = 0;
+    timekeeping_init();
+    timekeeping_set_trim_ppm(trim_ppm);
+    timekeeping_set_time(6, 58, 3);
+    timekeeping_set_weekday(4);  // day 0 is a Friday
+    uint32_t start = timekeeping_wall_seconds();
+    for (uint8_t slot = 0; slot < SCHEDULE_MAX; slot++) {
+        CHECK(schedule_set(slot, &alarms[slot]));
+    }
+    uint32_t end = start + DAYS * 86400;
+    expect_alarms(start, end);
+
+    uint32_t snoozes = 0;
+    while (timekeeping_wall_seconds() < end && hal_host_step()) {
+        if (!notified) continue;
+        notified = false;
+        CHECK(schedule_take_fired());
+        uint32_t now = timekeeping_wall_seconds();
+        if (fired_count < MAX_TIMES) fired_at[fired_count++] = now;
+        // Snooze every third one, as a user would.
+        if (fired_count % 3 == 0) {
+            schedule_snooze(SNOOZE_MIN);
+            expect(now + SNOOZE_MIN * 60);
+            snoozes++;
+        }
+    }
+    CHECK(snoozes > 10);
+    CHECK(!schedule_take_fired());
+
+    // Firings come strictly in order; simultaneous ones share a notification.
+    qsort(expected, expected_count, sizeof(expected[0]), compare_u32);
+    while (expected_count > 0 && expected[expected_count - 1] > timekeeping_wall_seconds()) {
+        expected_count--;
+    }
+    CHECK_EQ(fired_count, expected_count);
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < fired_count && i < expected_count; i++) {
+        if (i > 0 && fired_at[i] <= fired_at[i - 1]) wrong++;
+        if (fired_at[i] < expected[i] || fired_at[i] - expected[i] > tolerance_s) wrong++;
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+static void test_reject(void) {
+    schedule_alarm_t bad = { 24, 0, SCHEDULE_DAILY, true };
+    CHECK(!schedule_set(0, &bad));
+    bad = (schedule_alarm_t){ 7, 60, SCHEDULE_DAILY, true };
+    CHECK(!schedule_set(0, &bad));
+    bad = (schedule_alarm_t){ 7, 0, 0x80, true };
+    CHECK(!schedule_set(0, &bad));
+    bad = (schedule_alarm_t){ 7, 0, SCHEDULE_DAILY, true };
+    CHECK(!schedule_set(SCHEDULE_MAX, &bad));
+}
+
+int main(void) {
+    hal_timer_init();
+    schedule_init(schedule_notify);
+    hal_timer_create(&clock_timer, true, clock_timer_cb);
+    hal_timer_start(clock_timer, HAL_TICKS_PER_SECOND, NULL);
+    run(0, 0);
+    run(500, 1);
+    run(-500, 1);
+    test_reject();
+    return test_report("test_schedule");
+}
@@ -0,0 +1,497 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <stdio.h>
+#include "sdk_errors.h"
+#include "hal.h"
+#include "history.h"
+#include "i2c_sched.h"
+#include "sensor.h"
+#include "sim.h"
+#include "test.h"
+
+// The acquisition state machine against simulated SGP30 and SHT45 chips on
+// the host I2C bus: CRC-checked decoding, retries within a period, stale and
+// invalid halves through an outage, a stuck SDA that only shows up as CRC
+// failures, and a transfer that never completes. The fake SGP30 also logs
+// every command but the measurement and checks the CRC of each parameter
+// word: a boot with a restored baseline, absolute humidity against the
+// datasheet formula and only resent when it moves, and the baseline read
+// back an hour later and hourly after that. Last, how late a 10 ms main loop
+// runs with acquisition in the background, against the blocking reads it
+// replaced.
+
+#define PERIOD_MS       1000
+#define SGP30_ADDR      0x58
+#define SHT45_ADDR      0x44
+#define SGP30_INIT      0x2003
+#define SGP30_MEASURE   0x2008
+#define SGP30_GET_BASELINE 0x2015
+#define SGP30_SET_BASELINE 0x201E
+#define SGP30_SET_HUMIDITY 0x2061
+#define SGP30_COMMAND_MS 10
+#define SGP30_LOG_MAX   16
+#define STALE_PERIODS   10
+#define DEADLINE_PERIODS 2
+#define LOOP_MS         10
+// The waits inside the old blocking sgp30_read_data and sht45_read_data.
+#define SGP30_BLOCK_MS  15
+#define SHT45_BLOCK_MS  30
+
+typedef struct {
+    uint8_t addr;
+    uint16_t cmd;        // last command written
+    uint16_t words[2];   // what a measurement reads back
+    uint32_t bad_crc;    // reads left that come back with a damaged CRC
+    bool nack;
+} chip_t;
+
+typedef struct {
+    uint16_t cmd;
+    uint16_t params[2];
+    uint8_t param_count;
+    bool crc_ok;
+    uint64_t at;
+} sgp30_cmd_t;
+
+static chip_t sgp30 = { SGP30_ADDR, 0, { 450, 12 }, 0, false };
+static chip_t sht45 = { SHT45_ADDR, 0, { 26000, 30000 }, 0, false };
+static uint32_t sgp30_inits = 0;
+// eCO2 then TVOC, as Get_baseline reads them back.
+static uint16_t sgp30_baseline[2] = { 0x8F00, 0x9100 };
+static uint32_t sgp30_bad_baseline_reads = 0;
+static sgp30_cmd_t sgp30_log[SGP30_LOG_MAX];
+static uint8_t sgp30_logged = 0;
+static uint64_t sgp30_first_measure = 0;
+
+// Parameter words follow the command, each with its own CRC.
+static void sgp30_write(const uint8_t *data, uint8_t len) {
+    sgp30_cmd_t c = { .cmd = sgp30.cmd, .crc_ok = (len - 2) % 3 == 0, .at = hal_host_now() };
+    for (uint8_t i = 2; i + 3 <= len && c.param_count < 2; i += 3) {
+        c.params[c.param_count++] = (uint16_t)(data[i] << 8 | data[i + 1]);
+        c.crc_ok = c.crc_ok && sgp30_crc8(&data[i], 2) == data[i + 2];
+    }
+    if (c.cmd == SGP30_INIT) sgp30_inits++;
+    if (c.cmd == SGP30_SET_BASELINE && c.crc_ok && c.param_count == 2) {
+        // Written TVOC first.
+        sgp30_baseline[0] = c.params[1];
+        sgp30_baseline[1] = c.params[0];
+    }
+    if (c.cmd == SGP30_MEASURE) {
+        if (sgp30_first_measure == 0) sgp30_first_measure = c.at;
+    } else if (sgp30_logged < SGP30_LOG_MAX) {
+        sgp30_log[sgp30_logged++] = c;
+    }
+}
+
+static uint32_t bus(uint8_t addr, bool read, uint8_t *data, uint8_t len) {
+    chip_t *chip = (addr == SGP30_ADDR) ? &sgp30 : (addr == SHT45_ADDR) ? &sht45 : NULL;
+    if (chip == NULL || chip->nack) {
+        return NRF_ERROR_DRV_TWI_ERR_ANACK;
+    }
+    if (!read) {
+        chip->cmd = (len >= 2 && chip == &sgp30) ? (uint16_t)(data[0] << 8 | data[1]) : data[0];
+        if (chip == &sgp30) sgp30_write(data, len);
+        return NRF_SUCCESS;
+    }
+    uint16_t words[2] = { chip->words[0], chip->words[1] };
+    if (chip == &sgp30 && chip->cmd == SGP30_GET_BASELINE) {
+        words[0] = sgp30_baseline[0];
+        words[1] = sgp30_baseline[1];
+    }
+    for (uint8_t i = 0; i < 2 && 3 * i + 2 < len; i++) {
+        data[3 * i] = words[i] >> 8;
+        data[3 * i + 1] = words[i] & 0xFF;
+        data[3 * i + 2] = sgp30_crc8(&data[3 * i], 2);
+    }
+    if (chip->bad_crc) {
+        chip->bad_crc--;
+        data[5] ^= 0x01;
+    } else if (chip == &sgp30 && chip->cmd == SGP30_GET_BASELINE && sgp30_bad_baseline_reads) {
+        sgp30_bad_baseline_reads--;
+        data[2] ^= 0x01;
+    }
+    return NRF_SUCCESS;
+}
+
+static env_sample_t run_periods(uint32_t n) {
+    env_sample_t sample;
+    hal_host_advance(HAL_MS_TO_TICKS(PERIOD_MS * n));
+    sensor_get_latest(&sample);
+    return sample;
+}
+
+static sensor_health_t health_of(sensor_dev_t dev) {
+    sensor_health_t h;
+    sensor_get_health(dev, &h);
+    return h;
+}
+
+static uint8_t count_cmd(uint16_t cmd) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < sgp30_logged; i++) n += sgp30_log[i].cmd == cmd;
+    return n;
+}
+
+// Each command's execution time is over before the next one is written.
+static bool commands_spaced(void) {
+    for (uint8_t i = 1; i < sgp30_logged; i++) {
+        if (sgp30_log[i].at - sgp30_log[i - 1].at < HAL_MS_TO_TICKS(SGP30_COMMAND_MS)) return false;
+    }
+    return true;
+}
+
+static uint16_t expected_humidity(void) {
+    return sensor_absolute_humidity(sht45_ticks_to_centi_celsius(sht45.words[0]),
+                                    sht45_ticks_to_centi_rh(sht45.words[1]));
+}
+
+// Booted with a restored baseline: Init_air_quality, straight away
+// Set_baseline, then the first measurement with no warm-up wait. The SHT45
+// reading that finishes meanwhile goes in as absolute humidity first.
+static void test_boot(uint64_t started, const sgp30_data_t *restored) {
+    CHECK(run_periods(0).valid);
+    CHECK_EQ(sgp30_logged, 3);
+    CHECK_EQ(sgp30_log[0].cmd, SGP30_INIT);
+    CHECK_EQ(sgp30_log[0].param_count, 0);
+    CHECK_EQ(sgp30_log[1].cmd, SGP30_SET_BASELINE);
+    CHECK(sgp30_log[1].crc_ok);
+    CHECK_EQ(sgp30_log[1].param_count, 2);
+    CHECK_EQ(sgp30_log[1].params[0], restored->tvoc);
+    CHECK_EQ(sgp30_log[1].params[1], restored->eco2);
+    CHECK_EQ(sgp30_log[2].cmd, SGP30_SET_HUMIDITY);
+    CHECK(sgp30_log[2].crc_ok);
+    CHECK_EQ(sgp30_log[2].param_count, 1);
+    CHECK_EQ(sgp30_log[2].params[0], expected_humidity());
+    CHECK(commands_spaced());
+    CHECK(sgp30_first_measure - sgp30_log[2].at >= HAL_MS_TO_TICKS(SGP30_COMMAND_MS));
+    CHECK(sgp30_first_measure - started < HAL_MS_TO_TICKS(100));
+    CHECK_EQ(sgp30_inits, 1);
+
+    sgp30_logged = 0;
+    run_periods(1);
+    CHECK_EQ(sgp30_logged, 0);
+}
+
+// Sensirion's formula for absolute humidity, in g/m^3.
+static double reference_humidity(double t, double rh) {
+    return 216.7 * (rh / 100.0 * 6.112 * exp(17.62 * t / (243.12 + t)) / (273.15 + t));
+}
+
+static void test_humidity(void) {
+    // The fixed-point table against the formula across its range.
+    double worst = 0.0;
+    for (int16_t t = -2000; t <= 6000; t += 37) {
+        for (int16_t rh = 500; rh <= 10000; rh += 500) {
+            double ref = reference_humidity(t / 100.0, rh / 100.0);
+            double got = sensor_absolute_humidity(t, rh) / 256.0;
+            double error = fabs(got - ref) - 1.0 / 256;
+            if (error / ref > worst) worst = error / ref;
+        }
+    }
+    printf("absolute humidity within %.2f%% of the formula\n", worst * 100);
+    CHECK(worst < 0.005);
+    CHECK_EQ(sensor_absolute_humidity(2500, 0), 1);
+
+    // Unchanged air sends nothing; a small drift is not worth a command.
+    sgp30_logged = 0;
+    run_periods(5);
+    sht45.words[1] = 30100;
+    run_periods(2);
+    CHECK_EQ(sgp30_logged, 0);
+    // A wetter room is sent once.
+    sht45.words[1] = 36000;
+    run_periods(3);
+    CHECK_EQ(sgp30_logged, 1);
+    CHECK_EQ(sgp30_log[0].cmd, SGP30_SET_HUMIDITY);
+    CHECK(sgp30_log[0].crc_ok);
+    CHECK_EQ(sgp30_log[0].params[0], expected_humidity());
+    sht45.words[1] = 30000;
+    run_periods(2);
+}
+
+static void test_healthy(void) {
+    env_sample_t s = run_periods(1);
+    CHECK(s.valid);
+    CHECK_EQ(s.air_status, SENSOR_OK);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    CHECK_EQ(s.air.eco2, 450);
+    CHECK_EQ(s.air.tvoc, 12);
+    CHECK_EQ(s.climate.temperature_ticks, 26000);
+    CHECK_EQ(s.climate.humidity_ticks, 30000);
+    CHECK_EQ(s.climate.temperature_centi, sht45_ticks_to_centi_celsius(26000));
+    CHECK_EQ(sgp30_inits, 1);
+
+    // One sample per period, no more.
+    uint32_t seq = s.sequence;
+    for (uint32_t i = 1; i <= 10; i++) {
+        s = run_periods(1);
+        CHECK_EQ(s.sequence, seq + i);
+    }
+}
+
+// One damaged read is retried within the same period.
+static void test_crc_retry(void) {
+    sensor_health_t before = health_of(SENSOR_DEV_SHT45);
+    sht45.bad_crc = 1;
+    sht45.words[0] = 27000;
+    env_sample_t s = run_periods(1);
+    sensor_health_t after = health_of(SENSOR_DEV_SHT45);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    CHECK_EQ(s.climate.temperature_ticks, 27000);
+    CHECK_EQ(after.crc_errors - before.crc_errors, 1);
+    CHECK_EQ(after.retries - before.retries, 1);
+    CHECK_EQ(after.failed_periods, before.failed_periods);
+}
+
+// Every read damaged: the last good climate reading is carried as stale for
+// STALE_PERIODS, then the half turns invalid. The SGP30 carries on.
+static void test_outage(void) {
+    sht45.bad_crc = UINT32_MAX;
+    sht45.words[0] = 1234;
+    for (uint32_t i = 1; i <= STALE_PERIODS; i++) {
+        env_sample_t s = run_periods(1);
+        CHECK_EQ(s.climate_status, SENSOR_STALE);
+        CHECK_EQ(s.climate.temperature_ticks, 27000);
+        CHECK_EQ(s.air_status, SENSOR_OK);
+        CHECK(s.valid);
+    }
+    env_sample_t s = run_periods(1);
+    CHECK_EQ(s.climate_status, SENSOR_INVALID);
+    CHECK(!s.valid);
+    CHECK_EQ(hal_host_i2c_bus_clears(), 0);
+
+    sht45.bad_crc = 0;
+    s = run_periods(1);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    CHECK_EQ(s.climate.temperature_ticks, 1234);
+    CHECK(s.valid);
+    CHECK(health_of(SENSOR_DEV_SHT45).longest_outage >= STALE_PERIODS + 1);
+}
+
+// A stuck SDA ACKs everything and reads back zeros, which fail the CRC rather
+// than the transfer. That still has to lead to a bus clear.
+static void test_stuck_sda(void) {
+    uint32_t clears = hal_host_i2c_bus_clears();
+    hal_host_i2c_stick_sda(true);
+    env_sample_t s = run_periods(1);
+    CHECK_EQ(s.air_status, SENSOR_STALE);
+    CHECK_EQ(s.climate_status, SENSOR_STALE);
+    s = run_periods(1);
+    CHECK_EQ(hal_host_i2c_bus_clears(), clears + 1);
+    CHECK_EQ(s.air_status, SENSOR_OK);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    CHECK_EQ(health_of(SENSOR_DEV_SGP30).bus_clears + health_of(SENSOR_DEV_SHT45).bus_clears, 1);
+}
+
+static void test_nack(void) {
+    sensor_health_t before = health_of(SENSOR_DEV_SGP30);
+    sgp30.nack = true;
+    env_sample_t s = run_periods(1);
+    sensor_health_t after = health_of(SENSOR_DEV_SGP30);
+    CHECK_EQ(s.air_status, SENSOR_STALE);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    CHECK_EQ(after.transfer_errors - before.transfer_errors, 4);  // first try and three retries
+    sgp30.nack = false;
+    s = run_periods(1);
+    CHECK_EQ(s.air_status, SENSOR_OK);
+}
+
+// A transaction the bus never finishes holds its period open only until the
+// deadline; its answer, when it finally comes, does not publish twice.
+static void test_deadline(void) {
+    env_sample_t s = run_periods(0);
+    uint32_t seq = s.sequence;
+    twi_mngr_sim_stall(true);
+    s = run_periods(DEADLINE_PERIODS);
+    CHECK_EQ(s.sequence, seq);
+    s = run_periods(1);
+    CHECK(s.sequence >= seq + 1);
+    CHECK_EQ(s.air_status, SENSOR_STALE);
+    CHECK_EQ(s.climate_status, SENSOR_STALE);
+    s = run_periods(3);
+    CHECK_EQ(s.air_status, SENSOR_STALE);
+
+    twi_mngr_sim_stall(false);
+    s = run_periods(2);
+    CHECK_EQ(s.air_status, SENSOR_OK);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    seq = s.sequence;
+    for (uint32_t i = 1; i <= 5; i++) {
+        s = run_periods(1);
+        CHECK_EQ(s.sequence, seq + i);
+        CHECK(s.valid);
+    }
+}
+
+// Fed the way main.c's record_history does: every new sequence, whether or
+// not the sample as a whole is valid.
+static uint32_t recorded_sequence = 0;
+
+static env_sample_t record_periods(uint32_t n) {
+    env_sample_t s = {0};
+    for (uint32_t i = 0; i < n; i++) {
+        s = run_periods(1);
+        if (s.sequence != recorded_sequence) {
+            recorded_sequence = s.sequence;
+            history_add(&s);
+        }
+    }
+    return s;
+}
+
+// A dead SGP30 leaves the sample invalid, but the SHT45 channels keep
+// recording while the air channels hold their last value.
+static void test_dead_sgp30(void) {
+    history_init();
+    recorded_sequence = run_periods(0).sequence;
+    uint32_t minutes = history_minutes_total();
+    sgp30.nack = true;
+    sht45.words[0] = 20000;
+    env_sample_t s = record_periods(3 * 60);
+    CHECK_EQ(s.air_status, SENSOR_INVALID);
+    CHECK_EQ(s.climate_status, SENSOR_OK);
+    CHECK(!s.valid);
+    CHECK_EQ(history_minutes_total(), minutes + 3);
+
+    history_bucket_t b;
+    CHECK(history_get(HISTORY_TEMPERATURE_TICKS, HISTORY_WINDOW_MINUTE, 0, &b));
+    CHECK_EQ(b.avg, 20000);
+    CHECK(history_get(HISTORY_TEMPERATURE_TICKS, HISTORY_WINDOW_HOUR, 0, &b));
+    CHECK_EQ(b.min, 20000);
+    CHECK_EQ(b.max, 20000);
+    CHECK(history_get(HISTORY_ECO2, HISTORY_WINDOW_HOUR, 0, &b));
+    CHECK_EQ(b.avg, 450);
+
+    sht45.words[0] = 21000;
+    s = record_periods(60);
+    CHECK(history_get(HISTORY_TEMPERATURE_TICKS, HISTORY_WINDOW_HOUR, 0, &b));
+    CHECK_EQ(b.max, 21000);
+
+    sgp30.nack = false;
+    s = record_periods(1);
+    CHECK_EQ(s.air_status, SENSOR_OK);
+    CHECK(s.valid);
+}
+
+HAL_TIMER_DEF(loop_timer);
+static bool loop_pending = false;
+static uint64_t loop_due = 0;
+
+static void loop_timer_cb(void *p_context) {
+    (void)p_context;
+    if (!loop_pending) loop_due = hal_host_now();
+    loop_pending = true;
+}
+
+// The main loop sleeping until its tick, as main.c does, for `seconds`.
+// Returns the most its tick was left waiting, in ticks. With `blocking`, each
+// new second first spends the old driver's waits reading both sensors.
+static uint64_t loop_lateness(uint32_t seconds, bool blocking, uint32_t *samples) {
+    uint64_t worst = 0;
+    uint64_t end = hal_host_now() + HAL_MS_TO_TICKS(seconds * 1000);
+    uint32_t seq = run_periods(0).sequence;
+    uint32_t last_second = 0;
+    *samples = 0;
+    loop_pending = false;
+    hal_timer_start(loop_timer, HAL_MS_TO_TICKS(LOOP_MS), NULL);
+    while (hal_host_now() < end) {
+        hal_wait_event();
+        if (!loop_pending) continue;
+        uint64_t late = hal_host_now() - loop_due;
+        if (late > worst) worst = late;
+        loop_pending = false;
+
+        env_sample_t s;
+        sensor_get_latest(&s);
+        if (s.sequence != seq) {
+            seq = s.sequence;
+            (*samples)++;
+        }
+        uint32_t second = (uint32_t)(hal_host_now() / HAL_TICKS_PER_SECOND);
+        if (blocking && second != last_second) {
+            last_second = second;
+            hal_delay_ms(SGP30_BLOCK_MS);
+            hal_delay_ms(SHT45_BLOCK_MS);
+        }
+    }
+    hal_timer_stop(loop_timer);
+    return worst;
+}
+
+// Runs until the next baseline arrives and returns when, in periods.
+static uint32_t wait_baseline(sgp30_data_t *out, uint32_t limit) {
+    for (uint32_t i = 1; i <= limit; i++) {
+        run_periods(1);
+        if (sensor_take_baseline(out)) return i;
+    }
+    return 0;
+}
+
+// A restored baseline is read back an hour after boot, and then hourly. A
+// damaged read is retried rather than saved.
+static void test_baseline(uint64_t started) {
+    sgp30_data_t b;
+    sgp30_logged = 0;
+    sgp30_baseline[0] = 0x8E80;
+    sgp30_baseline[1] = 0x90C0;
+    CHECK(wait_baseline(&b, 3700) > 0);
+    uint64_t since_boot = hal_host_now() - started;
+    CHECK(since_boot >= (uint64_t)HAL_TICKS_PER_SECOND * 3600);
+    CHECK(since_boot <= (uint64_t)HAL_TICKS_PER_SECOND * (3600 + 2));
+    CHECK_EQ(b.eco2, 0x8E80);
+    CHECK_EQ(b.tvoc, 0x90C0);
+    CHECK_EQ(count_cmd(SGP30_GET_BASELINE), 1);
+    CHECK_EQ(count_cmd(SGP30_INIT) + count_cmd(SGP30_SET_BASELINE), 0);
+    CHECK(commands_spaced());
+
+    sgp30_logged = 0;
+    sgp30_baseline[0] = 0x8E00;
+    sgp30_bad_baseline_reads = 1;
+    sensor_health_t before = health_of(SENSOR_DEV_SGP30);
+    uint32_t periods = wait_baseline(&b, 3700);
+    CHECK(periods >= 3599 && periods <= 3601);
+    CHECK_EQ(b.eco2, 0x8E00);
+    CHECK_EQ(count_cmd(SGP30_GET_BASELINE), 2);
+    CHECK_EQ(health_of(SENSOR_DEV_SGP30).crc_errors - before.crc_errors, 1);
+    CHECK(!sensor_take_baseline(&b));
+}
+
+static void test_loop_jitter(void) {
+    uint32_t samples;
+    hal_timer_create(&loop_timer, true, loop_timer_cb);
+    uint64_t async_late = loop_lateness(60, false, &samples);
+    CHECK(samples >= 59);
+    uint64_t blocking_late = loop_lateness(60, true, &samples);
+    printf("main loop lateness: %lu us in the background, %lu us with blocking reads\n",
+           (unsigned long)(async_late * 1000000 / HAL_TICKS_PER_SECOND),
+           (unsigned long)(blocking_late * 1000000 / HAL_TICKS_PER_SECOND));
+    CHECK_EQ(async_late, 0);
+    CHECK(blocking_late >= HAL_MS_TO_TICKS(SGP30_BLOCK_MS + SHT45_BLOCK_MS - LOOP_MS));
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_i2c_init();
+    hal_host_i2c_attach(bus);
+    i2c_sched_init();
+    sensor_acq_init();
+    sgp30_data_t restored = { 0x8F00, 0x9100 };
+    sensor_set_baseline(&restored);
+    uint64_t started = hal_host_now();
+    sensor_acq_start(PERIOD_MS);
+    // The first period overlaps the start; settle on period boundaries.
+    hal_host_advance(HAL_MS_TO_TICKS(PERIOD_MS / 2));
+    test_boot(started, &restored);
+    test_humidity();
+    test_healthy();
+    test_crc_retry();
+    test_outage();
+    test_stuck_sda();
+    test_nack();
+    test_deadline();
+    test_dead_sgp30();
+    test_baseline(started);
+    test_loop_jitter();
+    return test_report("test_sensor");
+}
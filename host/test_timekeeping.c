@@ -0,0 +1,199 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "hal.h"
+#include "button.h"
+#include "timekeeping.h"
+#include "test.h"
+
+// A simulated day of main.c's event loop: it sleeps until a timer or a button
+// wakes it, and every wake is charged LOOP_WORK_TICKS of CPU. The same day of
+// the old loop, a 10 ms delay plus the same work per pass with the clock
+// counted in passes, is run for comparison. Reports the duty cycle and how
+// far each clock has drifted from the RTC by the end of the day. Then weeks
+// of the 24-bit RTC wrapping under the 64-bit extension, with and without a
+// ppm trim, and the time set while it runs.
+
+#define CLOCK_TICK_MS   1000
+#define UI_TICK_MS      100
+#define OLD_LOOP_MS     10
+// About 200 us of loop body at 64 MHz, a generous figure for a wake.
+#define LOOP_WORK_TICKS 7
+#define PIN_A           14
+#define DAY_TICKS       ((uint64_t)HAL_TICKS_PER_SECOND * 86400)
+#define WEEKS           3
+// Under the 512 s the RTC takes to wrap, and not a divisor of it.
+#define SAMPLE_TICKS    (HAL_TICKS_PER_SECOND * 500 + 12345)
+
+HAL_TIMER_DEF(clock_timer);
+HAL_TIMER_DEF(ui_timer);
+static volatile bool woken = false;
+
+static void wake_cb(void *p_context) {
+    (void)p_context;
+    woken = true;
+}
+
+static void button_notify(void) {
+    woken = true;
+}
+
+static void test_event_loop_day(void) {
+    timekeeping_init();
+    timekeeping_set_time(0, 0, 0);
+    hal_timer_create(&clock_timer, true, wake_cb);
+    hal_timer_create(&ui_timer, true, wake_cb);
+    hal_timer_start(clock_timer, HAL_MS_TO_TICKS(CLOCK_TICK_MS), NULL);
+    hal_timer_start(ui_timer, HAL_MS_TO_TICKS(UI_TICK_MS), NULL);
+
+    uint64_t start = hal_host_now();
+    uint64_t end = start + DAY_TICKS;
+    uint64_t next_press = start + HAL_MS_TO_TICKS(5 * 60 * 1000);
+    uint32_t wakes = 0, presses = 0;
+    while (hal_host_now() < end) {
+        // A press every ten minutes, from GPIOTE rather than a poll.
+        if (hal_host_now() >= next_press) {
+            hal_host_gpio_input(PIN_A, false);
+            hal_host_advance(HAL_MS_TO_TICKS(100));
+            hal_host_gpio_input(PIN_A, true);
+            next_press += HAL_MS_TO_TICKS(10 * 60 * 1000);
+        }
+        hal_wait_event();
+        if (!woken) continue;
+        woken = false;
+        wakes++;
+        button_event_t evt;
+        while (button_event_get(&evt)) presses++;
+        uint8_t h, m, s;
+        timekeeping_get_time(&h, &m, &s);
+        hal_host_advance(LOOP_WORK_TICKS);
+    }
+    hal_timer_stop(clock_timer);
+    hal_timer_stop(ui_timer);
+
+    uint64_t elapsed = hal_host_now() - start;
+    int64_t drift = (int64_t)timekeeping_wall_ticks() - (int64_t)elapsed;
+    double duty = 100.0 * wakes * LOOP_WORK_TICKS / (double)elapsed;
+    printf("event loop: %lu wakes, duty cycle %.3f%%, drift %lld ticks after a day\n",
+           (unsigned long)wakes, duty, (long long)drift);
+    CHECK_EQ(presses, 144);
+    // One per timer tick, and a couple for each press and release.
+    CHECK(wakes <= 86400 * (1000 / UI_TICK_MS + 1000 / CLOCK_TICK_MS) + 144 * 4);
+    CHECK(duty < 1.0);
+    CHECK_EQ(drift, 0);
+}
+
+// The loop it replaced never slept, and its clock only moved by OLD_LOOP_MS
+// per pass however long the pass took.
+static void test_old_loop_day(void) {
+    uint64_t start = hal_host_now();
+    uint64_t counted_ms = 0;
+    while (hal_host_now() - start < DAY_TICKS) {
+        hal_delay_ms(OLD_LOOP_MS);
+        hal_host_advance(LOOP_WORK_TICKS);
+        counted_ms += OLD_LOOP_MS;
+    }
+    uint64_t elapsed_ms = (hal_host_now() - start) * 1000 / HAL_TICKS_PER_SECOND;
+    printf("old loop: duty cycle 100%%, drift %lld s after a day\n",
+           (long long)((int64_t)counted_ms - (int64_t)elapsed_ms) / 1000);
+    CHECK(elapsed_ms - counted_ms > 60 * 1000);
+}
+
+// Every sample lands on a different counter value, and the extension must
+// equal the unwrapped virtual time throughout.
+static void test_overflow(void) {
+    timekeeping_init();
+    uint64_t start = hal_host_now();
+    uint32_t wrong = 0, wraps = 0;
+    uint32_t last = hal_ticks();
+    while (hal_host_now() - start < WEEKS * 7 * DAY_TICKS) {
+        hal_host_advance(SAMPLE_TICKS);
+        if (hal_ticks() < last) wraps++;
+        last = hal_ticks();
+        wrong += timekeeping_ticks() != hal_host_now() - start;
+    }
+    CHECK_EQ(wrong, 0);
+    CHECK(wraps >= WEEKS * 7 * 86400 / 512);
+    CHECK_EQ(timekeeping_uptime_ms(), (hal_host_now() - start) * 1000 / HAL_TICKS_PER_SECOND);
+}
+
+// The trimmed wall clock against the exact corrected time, to within a tick,
+// and continuous where the trim changes.
+static void check_trim(int32_t ppm) {
+    timekeeping_init();
+    timekeeping_set_time(0, 0, 0);
+    timekeeping_set_trim_ppm(ppm);
+    uint64_t start = hal_host_now();
+    uint32_t wrong = 0;
+    while (hal_host_now() - start < WEEKS * 7 * DAY_TICKS) {
+        hal_host_advance(SAMPLE_TICKS);
+        int64_t raw = (int64_t)(hal_host_now() - start);
+        int64_t expected = raw + raw * ppm / 1000000;
+        int64_t got = (int64_t)timekeeping_wall_ticks();
+        wrong += got - expected > 1 || expected - got > 1;
+    }
+    CHECK_EQ(wrong, 0);
+
+    uint64_t before = timekeeping_wall_ticks();
+    timekeeping_set_trim_ppm(-ppm);
+    CHECK_EQ(timekeeping_wall_ticks(), before);
+    hal_host_advance(HAL_TICKS_PER_SECOND * 100);
+    int64_t step = (int64_t)(timekeeping_wall_ticks() - before);
+    int64_t raw = HAL_TICKS_PER_SECOND * 100;
+    CHECK(step - (raw - raw * ppm / 1000000) <= 1 && (raw - raw * ppm / 1000000) - step <= 1);
+}
+
+static void test_trim(void) {
+    check_trim(50);
+    check_trim(-120);
+    check_trim(0);
+    // Over three weeks 50 ppm is 90.72 s; check the readout, not just ticks.
+    timekeeping_init();
+    timekeeping_set_time(0, 0, 0);
+    timekeeping_set_trim_ppm(50);
+    for (uint32_t i = 0; i < WEEKS * 7 * 86400 / 400; i++) {
+        hal_host_advance(HAL_TICKS_PER_SECOND * 400);
+        timekeeping_ticks();
+    }
+    uint8_t h, m, s;
+    timekeeping_get_time(&h, &m, &s);
+    CHECK_EQ(timekeeping_wall_seconds(), WEEKS * 7 * 86400 + 90);
+    CHECK_EQ(h, 0);
+    CHECK_EQ(m, 1);
+    CHECK_EQ(s, 30);
+}
+
+// Setting the time moves the clock within the day and keeps the day count.
+static void test_set_time(void) {
+    timekeeping_init();
+    timekeeping_set_trim_ppm(0);
+    timekeeping_set_time(23, 59, 50);
+    hal_host_advance(HAL_TICKS_PER_SECOND * 15);
+    uint8_t h, m, s;
+    timekeeping_get_time(&h, &m, &s);
+    CHECK_EQ(h, 0);
+    CHECK_EQ(m, 0);
+    CHECK_EQ(s, 5);
+    CHECK_EQ(timekeeping_wall_seconds() / 86400, 1);
+
+    timekeeping_set_time(12, 34, 56);
+    CHECK_EQ(timekeeping_seconds_of_day(), 12 * 3600 + 34 * 60 + 56);
+    CHECK_EQ(timekeeping_wall_seconds() / 86400, 1);
+    for (uint32_t i = 0; i < 7 * 86400 / 400; i++) {
+        hal_host_advance(HAL_TICKS_PER_SECOND * 400);
+        timekeeping_ticks();
+    }
+    CHECK_EQ(timekeeping_seconds_of_day(), 12 * 3600 + 34 * 60 + 56);
+    CHECK_EQ(timekeeping_wall_seconds() / 86400, 8);
+}
+
+int main(void) {
+    hal_timer_init();
+    buttons_init(button_notify);
+    test_event_loop_day();
+    test_old_loop_day();
+    test_overflow();
+    test_trim();
+    test_set_time();
+    return test_report("test_timekeeping");
+}
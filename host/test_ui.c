@@ -0,0 +1,341 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "microbit_v2.h"
+#include "hal.h"
+#include "alarm.h"
+#include "button.h"
+#include "flashlog.h"
+#include "lcd.h"
+#include "schedule.h"
+#include "telemetry.h"
+#include "timekeeping.h"
+#include "sim.h"
+#include "test.h"
+// Built in so the state machine can be checked after every step.
+#include "ui.c"
+
+// Presses on the virtual buttons, fed through the same loop as main.c, and
+// the state transitions they cause: the alarm toggle and edit, the clock
+// alarm with snooze and dismiss, an alarm coming due mid-edit, and the
+// environment screens. Then scripted event sequences straight into the
+// machine, each step with the state it should leave, and the frames the
+// screens send while nothing but the clock changes.
+
+#define PIN_A 14
+#define PIN_B 23
+#define STEP_MS 10
+#define UI_TICK_MS 100
+
+HAL_TIMER_DEF(clock_timer);
+
+static uint32_t loop_ms = 0;
+
+static void clock_timer_cb(void *p_context) {
+    (void)p_context;
+    timekeeping_ticks();
+}
+
+static void notify(void) {
+}
+
+// One pass of main's loop per step, with ui_tick at its own period.
+static void run_ms(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += STEP_MS) {
+        hal_host_advance(HAL_MS_TO_TICKS(STEP_MS));
+        button_event_t evt;
+        while (button_event_get(&evt)) {
+            ui_handle_button(&evt);
+        }
+        if (schedule_take_fired()) {
+            ui_alarm_due();
+        }
+        loop_ms += STEP_MS;
+        if (loop_ms % UI_TICK_MS == 0) {
+            ui_tick();
+        }
+        lcdService();
+    }
+}
+
+// Buttons pull the line low while pressed.
+static void press(uint32_t pin, uint32_t hold_ms) {
+    hal_host_gpio_input(pin, false);
+    run_ms(hold_ms);
+    hal_host_gpio_input(pin, true);
+    run_ms(100);
+}
+
+static void tap(uint32_t pin) {
+    press(pin, 100);
+}
+
+// Runs until the wall clock reaches h:m:s.
+static void run_until(uint8_t h, uint8_t m, uint8_t s) {
+    uint32_t target = (uint32_t)h * 3600 + m * 60 + s;
+    uint8_t ch, cm, cs;
+    do {
+        run_ms(STEP_MS);
+        timekeeping_get_time(&ch, &cm, &cs);
+    } while ((uint32_t)ch * 3600 + cm * 60 + cs != target);
+}
+
+static void test_toggle(void) {
+    flashlog_settings_t saved;
+    CHECK_EQ(state, STATE_NORMAL);
+    CHECK(!alarm_set_flag);
+    tap(PIN_B);
+    CHECK_EQ(state, STATE_NORMAL);
+    CHECK(alarm_set_flag);
+    CHECK(flashlog_load_settings(&saved) && saved.alarm_enabled);
+    tap(PIN_B);
+    CHECK(!alarm_set_flag);
+    CHECK(flashlog_load_settings(&saved) && !saved.alarm_enabled);
+}
+
+// Edit starts from the current time: three up, one down, then a held A that
+// repeats twice, and a long B to store it.
+static void test_alarm_edit(void) {
+    flashlog_settings_t saved;
+    press(PIN_B, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_ALARM_SET);
+    CHECK_EQ(alarm_hours, 6);
+    CHECK_EQ(alarm_minutes, 58);
+
+    bool shown = flash_on;
+    run_ms(ALARM_FLASH_PERIOD_MS + UI_TICK_MS);
+    CHECK(flash_on != shown);
+
+    tap(PIN_A);
+    tap(PIN_A);
+    tap(PIN_A);
+    tap(PIN_B);
+    CHECK_EQ(alarm_minutes, 0);
+    CHECK_EQ(alarm_hours, 7);
+    press(PIN_A, BUTTON_REPEAT_DELAY_MS + BUTTON_REPEAT_INTERVAL_MS + 50);
+    CHECK_EQ(alarm_minutes, 2);
+    CHECK_EQ(state, STATE_ALARM_SET);
+
+    press(PIN_B, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_NORMAL);
+    CHECK(alarm_set_flag);
+    CHECK(flashlog_load_settings(&saved));
+    CHECK(saved.alarm_enabled && saved.alarm_hours == 7 && saved.alarm_minutes == 2);
+}
+
+// 07:02 fires; B snoozes it to 07:07, where A dismisses it.
+static void test_snooze_and_dismiss(void) {
+    run_until(7, 1, 59);
+    CHECK_EQ(state, STATE_NORMAL);
+    run_ms(1100);
+    CHECK_EQ(state, STATE_TIMEUP);
+    run_ms(100);
+    CHECK(alarm_playing());
+
+    tap(PIN_B);
+    CHECK_EQ(state, STATE_NORMAL);
+    CHECK(!alarm_playing());
+    run_until(7, 6, 59);
+    CHECK_EQ(state, STATE_NORMAL);
+    run_ms(1100);
+    CHECK_EQ(state, STATE_TIMEUP);
+
+    tap(PIN_A);
+    CHECK_EQ(state, STATE_NORMAL);
+    CHECK(!alarm_playing());
+}
+
+// Left alone, the time-up screen stays while the sweep plays and then goes.
+static void test_timeout(void) {
+    ui_alarm_due();
+    CHECK_EQ(state, STATE_TIMEUP);
+    run_ms(TIMEUP_DURATION_MS + 200);
+    CHECK_EQ(state, STATE_TIMEUP);
+    CHECK(alarm_playing());
+    run_ms(3000);
+    CHECK(!alarm_playing());
+    CHECK_EQ(state, STATE_NORMAL);
+}
+
+// An alarm that comes due mid-edit waits, silent, for the edit to end. This
+// one is in another slot, so storing the edit leaves it alone.
+static void test_deferred(void) {
+    schedule_alarm_t other = { 7, 11, SCHEDULE_ONCE, true };
+    CHECK(schedule_set(UI_ALARM_SLOT + 1, &other));
+    run_until(7, 10, 58);
+    press(PIN_B, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_ALARM_SET);
+    tap(PIN_A);
+    run_ms(2000);
+    CHECK_EQ(state, STATE_ALARM_SET);
+    CHECK(alarm_deferred);
+    CHECK(!alarm_playing());
+
+    press(PIN_B, BUTTON_LONG_PRESS_MS + 100);
+    CHECK(state == STATE_NORMAL || state == STATE_TIMEUP);
+    run_ms(UI_TICK_MS);
+    CHECK_EQ(state, STATE_TIMEUP);
+    CHECK(!alarm_deferred);
+    tap(PIN_A);
+    CHECK_EQ(state, STATE_NORMAL);
+}
+
+// A has to be held for a second to get in; B pages, A steps the chart window.
+static void test_environment(void) {
+    press(PIN_A, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_NORMAL);
+    press(PIN_A, ENV_ENTER_HOLD_MS + 100);
+    CHECK_EQ(state, STATE_ENVIRONMENT);
+    CHECK_EQ(env_page, 0);
+
+    tap(PIN_A);
+    CHECK_EQ(env_window, HISTORY_WINDOW_MINUTE);
+    tap(PIN_B);
+    CHECK_EQ(env_page, 1);
+    tap(PIN_A);
+    CHECK(env_window != HISTORY_WINDOW_MINUTE);
+    for (uint8_t i = 0; i < HISTORY_CHANNELS; i++) {
+        tap(PIN_B);
+    }
+    CHECK_EQ(env_page, 0);
+
+    press(PIN_A, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_NORMAL);
+}
+
+typedef enum {
+    STEP_PRESS,   // a button event
+    STEP_ALARM,   // ui_alarm_due
+    STEP_WAIT,    // the main loop runs for ms
+} step_kind_t;
+
+typedef struct {
+    step_kind_t kind;
+    uint8_t button;
+    uint8_t type;
+    uint32_t ms;  // held for a press, run for a wait
+    system_state_t expect;
+} step_t;
+
+#define SHORT(b, st)    { STEP_PRESS, (b), BUTTON_EVT_SHORT, 100, (st) }
+#define LONG(b, ms, st) { STEP_PRESS, (b), BUTTON_EVT_LONG, (ms), (st) }
+#define REPEAT(b, st)   { STEP_PRESS, (b), BUTTON_EVT_REPEAT, BUTTON_REPEAT_DELAY_MS, (st) }
+#define ALARM(st)       { STEP_ALARM, 0, 0, 0, (st) }
+#define WAIT(ms, st)    { STEP_WAIT, 0, 0, (ms), (st) }
+#define END             { STEP_WAIT, 0, 0, 0, STATE_COUNT }
+
+static const step_t script_toggle[] = {
+    SHORT(BUTTON_B, STATE_NORMAL), SHORT(BUTTON_B, STATE_NORMAL), SHORT(BUTTON_A, STATE_NORMAL), END
+};
+static const step_t script_edit[] = {
+    LONG(BUTTON_B, 600, STATE_ALARM_SET), SHORT(BUTTON_A, STATE_ALARM_SET),
+    REPEAT(BUTTON_A, STATE_ALARM_SET), REPEAT(BUTTON_A, STATE_ALARM_SET),
+    LONG(BUTTON_A, 1400, STATE_ALARM_SET), SHORT(BUTTON_B, STATE_ALARM_SET),
+    WAIT(2000, STATE_ALARM_SET), LONG(BUTTON_B, 600, STATE_NORMAL), END
+};
+static const step_t script_environment[] = {
+    LONG(BUTTON_A, 600, STATE_NORMAL), LONG(BUTTON_A, 1200, STATE_ENVIRONMENT),
+    SHORT(BUTTON_B, STATE_ENVIRONMENT), SHORT(BUTTON_A, STATE_ENVIRONMENT),
+    LONG(BUTTON_B, 800, STATE_ENVIRONMENT), WAIT(3000, STATE_ENVIRONMENT),
+    LONG(BUTTON_A, 600, STATE_NORMAL), END
+};
+static const step_t script_alarm[] = {
+    ALARM(STATE_TIMEUP), LONG(BUTTON_A, 800, STATE_TIMEUP), REPEAT(BUTTON_B, STATE_TIMEUP),
+    SHORT(BUTTON_B, STATE_NORMAL), ALARM(STATE_TIMEUP), SHORT(BUTTON_A, STATE_NORMAL), END
+};
+static const step_t script_alarm_mid_edit[] = {
+    LONG(BUTTON_B, 600, STATE_ALARM_SET), ALARM(STATE_ALARM_SET), WAIT(500, STATE_ALARM_SET),
+    SHORT(BUTTON_A, STATE_ALARM_SET), LONG(BUTTON_B, 600, STATE_NORMAL),
+    WAIT(UI_TICK_MS, STATE_TIMEUP), SHORT(BUTTON_A, STATE_NORMAL), END
+};
+static const step_t script_alarm_in_environment[] = {
+    LONG(BUTTON_A, 1200, STATE_ENVIRONMENT), ALARM(STATE_TIMEUP), WAIT(500, STATE_TIMEUP),
+    SHORT(BUTTON_A, STATE_NORMAL), END
+};
+
+static void run_script(const char *name, const step_t *steps) {
+    for (uint8_t i = 0; steps[i].expect != STATE_COUNT; i++) {
+        const step_t *step = &steps[i];
+        if (step->kind == STEP_PRESS) {
+            button_event_t evt = { step->button, step->type, timekeeping_uptime_ms(), step->ms };
+            ui_handle_button(&evt);
+        } else if (step->kind == STEP_ALARM) {
+            ui_alarm_due();
+        } else {
+            run_ms(step->ms);
+        }
+        if (state != step->expect) {
+            printf("%s step %u: state %d, expected %d\n", name, i, state, step->expect);
+        }
+        CHECK_EQ(state, step->expect);
+    }
+    alarm_silence();
+}
+
+static void test_scripts(void) {
+    run_script("toggle", script_toggle);
+    run_script("edit", script_edit);
+    run_script("environment", script_environment);
+    run_script("alarm", script_alarm);
+    run_script("alarm mid-edit", script_alarm_mid_edit);
+    run_script("alarm in environment", script_alarm_in_environment);
+}
+
+// The clock renders once a second however often the loop ticks, and the
+// alarm edit once per flash, the first tick at least ALARM_FLASH_PERIOD_MS on.
+static void test_render_on_change(void) {
+    uint32_t sent0, sent1, dropped;
+    // The scripts left an alarm set a minute or two ahead.
+    schedule_alarm_t off = { 0, 0, SCHEDULE_DAILY, false };
+    schedule_set(UI_ALARM_SLOT, &off);
+    CHECK_EQ(state, STATE_NORMAL);
+    run_ms(1000);
+    lcdFrameStats(&sent0, &dropped);
+    run_ms(60 * 1000);
+    lcdFrameStats(&sent1, &dropped);
+    CHECK_EQ(sent1 - sent0, 60);
+    CHECK(!needs_render);
+
+    press(PIN_B, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_ALARM_SET);
+    lcdFrameStats(&sent0, &dropped);
+    uint32_t flashes = 0;
+    for (uint32_t t = 0; t < 10 * 1000; t += STEP_MS) {
+        bool shown = flash_on;
+        run_ms(STEP_MS);
+        flashes += flash_on != shown;
+    }
+    lcdFrameStats(&sent1, &dropped);
+    CHECK(flashes >= 10 * 1000 / (ALARM_FLASH_PERIOD_MS + UI_TICK_MS));
+    CHECK_EQ(sent1 - sent0, flashes);
+    press(PIN_B, BUTTON_LONG_PRESS_MS + 100);
+    CHECK_EQ(state, STATE_NORMAL);
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_spi_init();
+    pcd8544_attach(EDGE_P8);
+    lcdBegin();
+    hal_pwm_init();
+    telemetry_init();
+    alarm_init();
+    fstorage_sim_erase_all();
+    flashlog_init();
+    timekeeping_init();
+    timekeeping_set_time(6, 58, 0);
+    hal_timer_create(&clock_timer, true, clock_timer_cb);
+    hal_timer_start(clock_timer, HAL_MS_TO_TICKS(1000), NULL);
+    buttons_init(notify);
+    schedule_init(notify);
+    ui_init();
+
+    test_toggle();
+    test_alarm_edit();
+    test_snooze_and_dismiss();
+    test_timeout();
+    test_deferred();
+    test_environment();
+    test_scripts();
+    test_render_on_change();
+    return test_report("test_ui");
+}
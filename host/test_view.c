@@ -0,0 +1,195 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "microbit_v2.h"
+#include "hal.h"
+#include "font.h"
+#include "lcd.h"
+#include "view.h"
+#include "sim.h"
+#include "test.h"
+
+// The environment screen on the virtual panel: every line ends inside the
+// 84 px width, and the stale marker is drawn where it can be seen. Then an
+// hour of the clock drawn on every UI tick and of the environment screen
+// once a second: only the cells whose character changed are redrawn, and a
+// frame goes to the panel only when one did.
+
+#define CELL_W          (FONT_WIDTH + 1)
+#define LINE_CELLS      (LCD_WIDTH / CELL_W)
+#define HOUR_SECONDS    3600
+#define RENDERS_PER_S   10
+
+// True if the cell at column col of text line row shows the glyph for c.
+static bool cell_shows(const uint8_t *map, uint8_t row, uint8_t col, char c) {
+    const uint8_t *glyph = font_glyph(c);
+    const uint8_t *bank = &map[row * LCD_WIDTH + col * CELL_W];
+    for (uint8_t x = 0; x < FONT_WIDTH; x++) {
+        if (bank[x] != (c == ' ' ? 0 : glyph[x])) return false;
+    }
+    return true;
+}
+
+// Nothing may be drawn past the last whole cell; that is where a character
+// beyond LINE_CELLS would be clipped.
+static bool right_margin_clear(const uint8_t *map) {
+    for (uint8_t bank = 0; bank < PCD8544_BANKS; bank++) {
+        for (uint8_t x = LINE_CELLS * CELL_W; x < LCD_WIDTH; x++) {
+            if (map[bank * LCD_WIDTH + x]) return false;
+        }
+    }
+    return true;
+}
+
+static env_sample_t widest_sample(uint8_t air_status, uint8_t climate_status) {
+    env_sample_t s = {0};
+    s.sequence = 1;
+    s.air.eco2 = 65535;
+    s.air.tvoc = 65535;
+    s.climate.temperature_centi = 13000;
+    s.climate.humidity_centi = 11900;
+    s.air_status = air_status;
+    s.climate_status = climate_status;
+    s.valid = true;
+    return s;
+}
+
+// "Temp 130.00?C", "Hum 119.00?%RH", "eCO2 65535?ppm", "TVOC 65535?ppb"
+static void test_stale_marker(void) {
+    view_invalidate();
+    env_sample_t s = widest_sample(SENSOR_STALE, SENSOR_STALE);
+    view_environment(&s);
+    lcdFlush();
+    const uint8_t *ram = pcd8544_ram();
+    CHECK(cell_shows(ram, 0, 11, '?'));
+    CHECK(cell_shows(ram, 0, 12, 'C'));
+    CHECK(cell_shows(ram, 1, 10, '?'));
+    CHECK(cell_shows(ram, 1, 13, 'H'));
+    CHECK(cell_shows(ram, 2, 10, '?'));
+    CHECK(cell_shows(ram, 2, 13, 'm'));
+    CHECK(cell_shows(ram, 3, 10, '?'));
+    CHECK(cell_shows(ram, 3, 13, 'b'));
+    CHECK(right_margin_clear(ram));
+
+    // Back to fresh: the marker cells are cleared, only for the half that recovered.
+    s = widest_sample(SENSOR_OK, SENSOR_STALE);
+    view_environment(&s);
+    lcdFlush();
+    CHECK(cell_shows(ram, 1, 10, '?'));
+    CHECK(cell_shows(ram, 2, 10, ' '));
+    CHECK(cell_shows(ram, 3, 10, ' '));
+    CHECK(cell_shows(ram, 3, 13, 'b'));
+    CHECK(memcmp(ram, displayMap, sizeof(displayMap)) == 0);
+
+    // A 4-digit reading moves the marker left with it.
+    s.air.eco2 = 4123;
+    s.air_status = SENSOR_STALE;
+    view_environment(&s);
+    lcdFlush();
+    CHECK(cell_shows(ram, 2, 9, '?'));
+    CHECK(cell_shows(ram, 2, 10, 'p'));
+    CHECK(cell_shows(ram, 2, 13, ' '));
+}
+
+static void test_invalid(void) {
+    view_invalidate();
+    env_sample_t s = widest_sample(SENSOR_INVALID, SENSOR_OK);
+    view_environment(&s);
+    lcdFlush();
+    const uint8_t *ram = pcd8544_ram();
+    // "eCO2 -- ppm"
+    CHECK(cell_shows(ram, 2, 5, '-'));
+    CHECK(cell_shows(ram, 2, 6, '-'));
+    CHECK(cell_shows(ram, 2, 7, ' '));
+    CHECK(cell_shows(ram, 2, 8, 'p'));
+    CHECK(right_margin_clear(ram));
+}
+
+// Cells of a differ from b, counting the empty cells past the shorter one.
+static uint32_t changed_cells(const char *a, const char *b, uint8_t cells) {
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < cells; i++) {
+        char ca = *a ? *a++ : '\0';
+        char cb = *b ? *b++ : '\0';
+        n += ca != cb;
+    }
+    return n;
+}
+
+static void test_clock_hour(void) {
+    uint32_t renders0, cells0, renders, cells, frames0, frames, dropped;
+    view_stats(&renders0, &cells0);
+    lcdFrameStats(&frames0, &dropped);
+    view_invalidate();
+    char prev[9] = "", text[9];
+    uint32_t expected = 0;
+    for (uint32_t t = 0; t < HOUR_SECONDS; t++) {
+        snprintf(text, sizeof(text), "12:%02lu:%02lu", (unsigned long)(t / 60), (unsigned long)(t % 60));
+        expected += changed_cells(prev, text, 8);
+        memcpy(prev, text, sizeof(prev));
+        for (uint8_t i = 0; i < RENDERS_PER_S; i++) {
+            view_clock(12, (uint8_t)(t / 60), (uint8_t)(t % 60));
+        }
+        lcdFlush();
+    }
+    view_stats(&renders, &cells);
+    lcdFrameStats(&frames, &dropped);
+    printf("clock hour: %lu render calls, %lu cells redrawn of %lu, %lu frames\n",
+           (unsigned long)(renders - renders0), (unsigned long)(cells - cells0),
+           (unsigned long)HOUR_SECONDS * RENDERS_PER_S * 8, (unsigned long)(frames - frames0));
+    CHECK_EQ(renders - renders0, HOUR_SECONDS * RENDERS_PER_S);
+    CHECK_EQ(cells - cells0, expected);
+    CHECK_EQ(frames - frames0, HOUR_SECONDS);
+
+    // What is left on the panel is what a full redraw would give.
+    static uint8_t cached[sizeof(displayMap)];
+    memcpy(cached, pcd8544_ram(), sizeof(cached));
+    view_invalidate();
+    view_clock(12, 59, 59);
+    lcdFlush();
+    CHECK(memcmp(cached, pcd8544_ram(), sizeof(cached)) == 0);
+}
+
+// Readings that change in the displayed precision only now and then.
+static void test_environment_hour(void) {
+    uint32_t renders0, cells0, renders, cells, frames0, frames, dropped;
+    view_invalidate();
+    env_sample_t s = widest_sample(SENSOR_OK, SENSOR_OK);
+    s.climate.temperature_centi = 2150;
+    s.air.eco2 = 400;
+    view_environment(&s);
+    lcdFlush();
+    view_stats(&renders0, &cells0);
+    lcdFrameStats(&frames0, &dropped);
+    uint32_t changes = 0;
+    for (uint32_t t = 0; t < HOUR_SECONDS; t++) {
+        env_sample_t next = s;
+        next.sequence = t + 2;
+        next.climate.temperature_centi = 2150 + (int32_t)(t / 60 % 10);
+        next.air.eco2 = (uint16_t)(400 + t / 600);
+        changes += next.climate.temperature_centi != s.climate.temperature_centi ||
+                   next.air.eco2 != s.air.eco2;
+        s = next;
+        view_environment(&s);
+        lcdFlush();
+    }
+    view_stats(&renders, &cells);
+    lcdFrameStats(&frames, &dropped);
+    CHECK_EQ(renders - renders0, HOUR_SECONDS);
+    CHECK_EQ(frames - frames0, changes);
+    // A last digit, or two where it carries.
+    CHECK(cells - cells0 >= changes && cells - cells0 <= changes * 2);
+}
+
+int main(void) {
+    hal_timer_init();
+    hal_spi_init();
+    pcd8544_attach(EDGE_P8);
+    lcdBegin();
+    test_stale_marker();
+    test_invalid();
+    test_clock_hour();
+    test_environment_hour();
+    return test_report("test_view");
+}
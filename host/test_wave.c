@@ -0,0 +1,206 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "alarm.h"
+#include "hal.h"
+#include "timekeeping.h"
+#include "test.h"
+
+// The sequences the alarm hands to the PWM, rendered clock by clock into
+// audio samples and measured: the radar sweep's pitch at every period against
+// the ramp it was built from, with no period cut short where one entry or one
+// loop hands over to the next, and the tones' exact pitch, duty and length.
+// Each pattern is one hal_pwm_play(). `test_wave out.wav` also writes the
+// sweep to a file to listen to.
+
+// Every sample covers a whole number of PWM clocks.
+#define SAMPLE_RATE       40000
+#define CLOCKS_PER_SAMPLE (HAL_PWM_CLOCK_HZ / SAMPLE_RATE)
+#define AMPLITUDE         16000
+#define MAX_SAMPLES       (SAMPLE_RATE * 4)
+#define MAX_PERIODS       4096
+
+#define RADAR_MS          3000
+#define SWEEP_MS          1000
+#define RADAR_F_MIN       400
+#define RADAR_F_MAX       800
+#define TONE_MS           2000
+#define TEMPERATURE_HZ    500
+
+static int16_t samples[MAX_SAMPLES];
+static float periods[MAX_PERIODS];
+static float period_starts[MAX_PERIODS];
+
+// The output is high for the first compare clocks of each period. A sample is
+// the mean level over its clocks; a partial sample at the end is dropped.
+static uint32_t render(const hal_pwm_entry_t *entries, uint16_t count, uint16_t loops) {
+    uint32_t n = 0, clock = 0;
+    int32_t level = 0;
+    for (uint16_t loop = 0; loop < loops; loop++) {
+        for (uint16_t i = 0; i < count; i++) {
+            for (uint16_t p = 0; p < HAL_PWM_PERIODS_PER_ENTRY; p++) {
+                for (uint32_t c = 0; c <= entries[i].counter_top; c++) {
+                    level += (c < entries[i].compare) ? 1 : -1;
+                    if (++clock < CLOCKS_PER_SAMPLE) continue;
+                    if (n < MAX_SAMPLES) samples[n] = (int16_t)(level * AMPLITUDE / (int32_t)CLOCKS_PER_SAMPLE);
+                    n++;
+                    clock = 0;
+                    level = 0;
+                }
+            }
+        }
+    }
+    return n < MAX_SAMPLES ? n : MAX_SAMPLES;
+}
+
+// Rising zero crossings, placed between samples by linear interpolation; the
+// box filter makes each edge a straight ramp, so this is close to exact.
+static uint32_t measure_periods(uint32_t n) {
+    uint32_t count = 0;
+    float last = -1.0f;
+    for (uint32_t i = 1; i < n; i++) {
+        if (samples[i - 1] >= 0 || samples[i] < 0) continue;
+        float at = (float)(i - 1) + (float)-samples[i - 1] / (float)(samples[i] - samples[i - 1]);
+        if (last >= 0.0f && count < MAX_PERIODS) {
+            periods[count] = at - last;
+            period_starts[count] = last;
+            count++;
+        }
+        last = at;
+    }
+    return count;
+}
+
+static void put_le(FILE *f, uint32_t v, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++) fputc((int)((v >> (8 * i)) & 0xFF), f);
+}
+
+// 16-bit mono PCM.
+static void write_wav(FILE *f, uint32_t n) {
+    fwrite("RIFF", 1, 4, f);
+    put_le(f, 36 + n * 2, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put_le(f, 16, 4);
+    put_le(f, 1, 2);
+    put_le(f, 1, 2);
+    put_le(f, SAMPLE_RATE, 4);
+    put_le(f, SAMPLE_RATE * 2, 4);
+    put_le(f, 2, 2);
+    put_le(f, 16, 2);
+    fwrite("data", 1, 4, f);
+    put_le(f, n * 2, 4);
+    for (uint32_t i = 0; i < n; i++) put_le(f, (uint16_t)samples[i], 2);
+}
+
+// Raises source and catches the sequence as playback starts.
+static const hal_pwm_entry_t *start(alarm_source_t source, uint16_t *count, uint16_t *loops) {
+    uint32_t starts = hal_host_pwm_starts();
+    alarm_raise(source);
+    const hal_pwm_entry_t *entries = NULL;
+    for (uint32_t i = 0; i < 1000 && entries == NULL; i++) {
+        hal_host_advance(HAL_MS_TO_TICKS(1));
+        entries = hal_host_pwm_playing(count, loops);
+    }
+    CHECK(entries != NULL);
+    CHECK_EQ(hal_host_pwm_starts(), starts + 1);
+    return entries;
+}
+
+static uint64_t sequence_clocks(const hal_pwm_entry_t *entries, uint16_t count, uint16_t loops) {
+    uint64_t clocks = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        clocks += (uint64_t)HAL_PWM_PERIODS_PER_ENTRY * (entries[i].counter_top + 1);
+    }
+    return clocks * loops;
+}
+
+static float sweep_hz(float ms) {
+    float into = ms - SWEEP_MS * (float)(uint32_t)(ms / SWEEP_MS);
+    float half = SWEEP_MS / 2.0f;
+    float span = RADAR_F_MAX - RADAR_F_MIN;
+    return (into < half) ? RADAR_F_MIN + span * into / half : RADAR_F_MAX - span * (into - half) / half;
+}
+
+static float fabs_f(float v) {
+    return v < 0.0f ? -v : v;
+}
+
+static void test_radar(const char *wav_path) {
+    uint16_t count, loops;
+    const hal_pwm_entry_t *entries = start(ALARM_SRC_CLOCK, &count, &loops);
+    if (entries == NULL) return;
+    uint32_t n = render(entries, count, loops);
+    CHECK_EQ(n, sequence_clocks(entries, count, loops) / CLOCKS_PER_SAMPLE);
+    uint32_t ms = n * 1000 / SAMPLE_RATE;
+    CHECK(ms + 30 >= RADAR_MS && ms <= RADAR_MS + 30);
+
+    // Each period against the ramp at its midpoint. An entry holds its pitch
+    // for HAL_PWM_PERIODS_PER_ENTRY periods, so the ramp is a staircase: at
+    // 400 Hz an entry lasts 25 ms, over which the ramp climbs 5%.
+    uint32_t np = measure_periods(n);
+    float worst = 0.0f, worst_jump = 0.0f;
+    for (uint32_t i = 0; i < np; i++) {
+        float at_ms = (period_starts[i] + periods[i] / 2) * 1000.0f / SAMPLE_RATE;
+        float hz = SAMPLE_RATE / periods[i];
+        float error = fabs_f(hz - sweep_hz(at_ms)) / sweep_hz(at_ms);
+        if (error > worst) worst = error;
+        if (i > 0) {
+            float jump = fabs_f(periods[i] - periods[i - 1]) / periods[i - 1];
+            if (jump > worst_jump) worst_jump = jump;
+        }
+    }
+    printf("radar sweep: %lu entries x %u loops, %lu ms, %lu periods, pitch within %.1f%%, "
+           "largest step %.1f%%\n", (unsigned long)count, loops, (unsigned long)ms,
+           (unsigned long)np, worst * 100, worst_jump * 100);
+    CHECK(np > RADAR_MS / 1000 * (RADAR_F_MIN + RADAR_F_MAX) / 2 * 95 / 100);
+    CHECK(worst < 0.06f);
+    // Only staircase steps; a period cut short by a restart would be a jump
+    // of half or more.
+    CHECK(worst_jump < 0.06f);
+
+    FILE *f = wav_path ? fopen(wav_path, "wb") : tmpfile();
+    CHECK(f != NULL);
+    if (f == NULL) return;
+    write_wav(f, n);
+    CHECK_EQ(ftell(f), 44 + 2 * (long)n);
+    fclose(f);
+    if (wav_path) printf("wrote %s\n", wav_path);
+}
+
+static void test_tone(void) {
+    uint16_t count, loops;
+    // The sweep is still playing; the tone would queue behind it.
+    alarm_silence();
+    const hal_pwm_entry_t *entries = start(ALARM_SRC_TEMPERATURE, &count, &loops);
+    if (entries == NULL) return;
+    uint32_t n = render(entries, count, loops);
+    uint32_t ms = n * 1000 / SAMPLE_RATE;
+    CHECK(ms + 30 >= TONE_MS && ms <= TONE_MS + 30);
+
+    // 500 Hz is a whole 80 samples; every period is exactly that, across the
+    // block boundaries too.
+    uint32_t np = measure_periods(n);
+    uint32_t off = 0;
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < np; i++) {
+        off += fabs_f(periods[i] - (float)SAMPLE_RATE / TEMPERATURE_HZ) > 0.01f;
+    }
+    for (uint32_t i = 0; i < n; i++) sum += samples[i];
+    printf("tone: %lu entries x %u loops, %lu ms, %lu periods\n", (unsigned long)count, loops,
+           (unsigned long)ms, (unsigned long)np);
+    CHECK_EQ(off, 0);
+    CHECK(np + 2 >= ms * TEMPERATURE_HZ / 1000);
+    // 50% duty: the mean level is zero.
+    CHECK(sum / (int64_t)n == 0);
+    alarm_silence();
+}
+
+int main(int argc, char **argv) {
+    hal_timer_init();
+    hal_pwm_init();
+    timekeeping_init();
+    alarm_init();
+    test_radar(argc > 1 ? argv[1] : NULL);
+    test_tone();
+    return test_report("test_wave");
+}
@@ -0,0 +1,104 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "nrf_twi_mngr.h"
+#include "hal.h"
+#include "sim.h"
+
+// Transactions run one at a time against the host HAL's I2C devices and take
+// as long as they would at the bus clock, nine clocks per byte including the
+// address. As in the SDK, a transaction's callback runs before the next one
+// is started.
+#define TWI_QUEUE_SIZE  4
+#define TWI_CLOCK_HZ    100000UL
+
+static const nrf_twi_mngr_t twi_mngr_instance = { TWI_QUEUE_SIZE };
+const nrf_twi_mngr_t *i2c_manager = &twi_mngr_instance;
+
+HAL_TIMER_DEF(twi_timer);
+static bool timer_ready = false;
+static nrf_twi_mngr_transaction_t const *queue[TWI_QUEUE_SIZE + 1];
+static uint8_t queued = 0;
+static bool active = false;  // queue[0] is on the bus
+static bool stalled = false;
+static bool held = false;    // queue[0] is waiting for the stall to end
+static uint32_t clock_hz = TWI_CLOCK_HZ;
+static uint64_t busy_ticks = 0;
+
+static void start_transaction(void) {
+    active = true;
+    if (stalled) {
+        held = true;
+        return;
+    }
+    nrf_twi_mngr_transaction_t const *tr = queue[0];
+    uint64_t clocks = 0;
+    for (uint8_t i = 0; i < tr->number_of_transfers; i++) {
+        clocks += 9 * (1 + (uint64_t)tr->p_transfers[i].length);
+    }
+    uint32_t ticks = (uint32_t)((clocks * HAL_TICKS_PER_SECOND + clock_hz - 1) / clock_hz);
+    if (ticks < HAL_TIMER_MIN_TICKS) {
+        ticks = HAL_TIMER_MIN_TICKS;
+    }
+    busy_ticks += ticks;
+    hal_timer_start(twi_timer, ticks, NULL);
+}
+
+static void twi_timer_cb(void *p_context) {
+    (void)p_context;
+    nrf_twi_mngr_transaction_t const *tr = queue[0];
+    ret_code_t result = NRF_SUCCESS;
+    for (uint8_t i = 0; i < tr->number_of_transfers && result == NRF_SUCCESS; i++) {
+        nrf_twi_mngr_transfer_t const *xfer = &tr->p_transfers[i];
+        result = hal_host_i2c_transfer(xfer->operation >> 1, xfer->operation & 1, xfer->p_data, xfer->length);
+    }
+    for (uint8_t i = 1; i < queued; i++) {
+        queue[i - 1] = queue[i];
+    }
+    queued--;
+    active = false;
+    if (tr->callback) {
+        tr->callback(result, tr->p_user_data);
+    }
+    if (queued != 0 && !active) {
+        start_transaction();
+    }
+}
+
+ret_code_t nrf_twi_mngr_schedule(nrf_twi_mngr_t const *p_nrf_twi_mngr,
+                                 nrf_twi_mngr_transaction_t const *p_transaction) {
+    if (!timer_ready) {
+        hal_timer_create(&twi_timer, false, twi_timer_cb);
+        timer_ready = true;
+    }
+    // One transaction on the bus plus a full queue behind it.
+    if (queued == p_nrf_twi_mngr->queue_size + 1) {
+        return NRF_ERROR_NO_MEM;
+    }
+    queue[queued++] = p_transaction;
+    if (!active) {
+        start_transaction();
+    }
+    return NRF_SUCCESS;
+}
+
+bool nrf_twi_mngr_is_idle(nrf_twi_mngr_t const *p_nrf_twi_mngr) {
+    (void)p_nrf_twi_mngr;
+    return queued == 0;
+}
+
+void twi_mngr_sim_stall(bool stall) {
+    stalled = stall;
+    if (!stall && held) {
+        held = false;
+        start_transaction();
+    }
+}
+
+void twi_mngr_sim_clock(uint32_t hz) {
+    clock_hz = hz;
+}
+
+uint64_t twi_mngr_sim_busy_ticks(void) {
+    return busy_ticks;
+}
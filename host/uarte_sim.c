@@ -0,0 +1,54 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "nrfx_uarte.h"
+#include "hal.h"
+#include "sim.h"
+
+// Bytes land in a capture buffer as the DMA transfer starts; TX_DONE follows
+// after the ten bit times per byte it takes on the wire.
+#define UARTE_CAPTURE_SIZE 65536
+
+HAL_TIMER_DEF(uarte_timer);
+static nrfx_uarte_event_handler_t handler = NULL;
+static bool busy = false;
+static uint8_t capture[UARTE_CAPTURE_SIZE];
+static size_t captured = 0;
+static uint32_t baudrate = 0;
+
+static void uarte_timer_cb(void *p_context) {
+    (void)p_context;
+    nrfx_uarte_event_t evt = { .type = NRFX_UARTE_EVT_TX_DONE };
+    busy = false;
+    handler(&evt, NULL);
+}
+
+nrfx_err_t nrfx_uarte_init(nrfx_uarte_t const *p_instance, nrfx_uarte_config_t const *p_config,
+                           nrfx_uarte_event_handler_t event_handler) {
+    (void)p_instance;
+    handler = event_handler;
+    baudrate = p_config->baudrate;
+    return hal_timer_create(&uarte_timer, false, uarte_timer_cb);
+}
+
+nrfx_err_t nrfx_uarte_tx(nrfx_uarte_t const *p_instance, uint8_t const *p_data, size_t length) {
+    (void)p_instance;
+    if (busy) {
+        return NRFX_ERROR_BUSY;
+    }
+    size_t room = UARTE_CAPTURE_SIZE - captured;
+    memcpy(&capture[captured], p_data, length < room ? length : room);
+    captured += length < room ? length : room;
+    busy = true;
+    uint64_t bits = 10 * (uint64_t)length;
+    return hal_timer_start(uarte_timer, (uint32_t)((bits * HAL_TICKS_PER_SECOND + baudrate - 1) / baudrate), NULL);
+}
+
+const uint8_t *uarte_sim_output(size_t *len) {
+    *len = captured;
+    return capture;
+}
+
+void uarte_sim_clear(void) {
+    captured = 0;
+}
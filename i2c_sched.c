@@ -0,0 +1,150 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "app_util_platform.h"
+#include "nrf_twi_mngr.h"
+#include "hal.h"
+#include "i2c_sched.h"
+
+extern const nrf_twi_mngr_t* i2c_manager;
+
+HAL_TIMER_DEF(i2c_sched_timer);
+
+// Jobs whose command has been sent and which are waiting out their conversion.
+static i2c_job_t *pending = NULL;
+
+static void i2c_sched_dispatch(void);
+
+static void job_finish(i2c_job_t *job, ret_code_t result) {
+    job->busy = false;
+    if (job->handler) {
+        job->handler(job, result);
+    }
+}
+
+static void read_done(ret_code_t result, void *p_user_data) {
+    job_finish((i2c_job_t *)p_user_data, result);
+}
+
+static void issue_read(i2c_job_t *job) {
+    if (i2c_manager == NULL) {
+        job_finish(job, NRF_ERROR_INVALID_STATE);
+        return;
+    }
+    nrf_twi_mngr_transfer_t xfer = NRF_TWI_MNGR_READ(job->addr, job->rx, job->rx_len, 0);
+    job->xfer = xfer;
+    job->transaction.callback = read_done;
+    ret_code_t err_code = nrf_twi_mngr_schedule(i2c_manager, &job->transaction);
+    if (err_code != NRF_SUCCESS) {
+        printf("I2C 0x%02X read schedule failed! Error: 0x%lX\n", job->addr, (unsigned long)err_code);
+        job_finish(job, err_code);
+    }
+}
+
+static void write_done(ret_code_t result, void *p_user_data) {
+    i2c_job_t *job = (i2c_job_t *)p_user_data;
+    if (result != NRF_SUCCESS || (job->rx_len == 0 && job->conversion_ticks == 0)) {
+        job_finish(job, result);
+        return;
+    }
+    if (job->conversion_ticks == 0) {
+        issue_read(job);
+        return;
+    }
+
+    job->issued_ticks = hal_ticks();
+    CRITICAL_REGION_ENTER();
+    job->p_next = pending;
+    pending = job;
+    CRITICAL_REGION_EXIT();
+    i2c_sched_dispatch();
+}
+
+static uint32_t ticks_remaining(i2c_job_t const *job, uint32_t now) {
+    uint32_t elapsed = hal_ticks_elapsed(now, job->issued_ticks);
+    return (elapsed >= job->conversion_ticks) ? 0 : job->conversion_ticks - elapsed;
+}
+
+// Reads every job whose conversion has finished, earliest deadline first, then
+// arms the timer for the next one. Write-only jobs simply finish, so the device
+// is known to be ready again when their handler runs.
+static void i2c_sched_dispatch(void) {
+    while (1) {
+        i2c_job_t *due = NULL;
+        i2c_job_t **pp_due = NULL;
+        uint32_t due_remaining = 0;
+
+        CRITICAL_REGION_ENTER();
+        uint32_t now = hal_ticks();
+        for (i2c_job_t **pp = &pending; *pp != NULL; pp = &(*pp)->p_next) {
+            uint32_t remaining = ticks_remaining(*pp, now);
+            if (pp_due == NULL || remaining < due_remaining) {
+                pp_due = pp;
+                due_remaining = remaining;
+            }
+        }
+        if (pp_due != NULL && due_remaining == 0) {
+            due = *pp_due;
+            *pp_due = due->p_next;
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (due == NULL) {
+            if (pp_due != NULL) {
+                hal_timer_stop(i2c_sched_timer);
+                hal_timer_start(i2c_sched_timer, due_remaining, NULL);
+            }
+            return;
+        }
+        if (due->rx_len == 0) {
+            job_finish(due, NRF_SUCCESS);
+        } else {
+            issue_read(due);
+        }
+    }
+}
+
+static void i2c_sched_timer_cb(void *p_context) {
+    (void)p_context;
+    i2c_sched_dispatch();
+}
+
+void i2c_sched_init(void) {
+    hal_err_t err_code = hal_timer_create(&i2c_sched_timer, false, i2c_sched_timer_cb);
+    if (err_code != HAL_SUCCESS) {
+        printf("i2c_sched_timer init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
+
+ret_code_t i2c_sched_submit(i2c_job_t *job) {
+    if (job->busy) {
+        return NRF_ERROR_BUSY;
+    }
+    if (i2c_manager == NULL) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    job->busy = true;
+    job->conversion_ticks = HAL_MS_TO_TICKS(job->conversion_ms);
+
+    nrf_twi_mngr_transfer_t xfer = NRF_TWI_MNGR_WRITE(job->addr, job->cmd, job->cmd_len, 0);
+    job->xfer = xfer;
+    job->transaction.callback = write_done;
+    job->transaction.p_user_data = job;
+    job->transaction.p_transfers = &job->xfer;
+    job->transaction.number_of_transfers = 1;
+    job->transaction.p_required_twi_cfg = NULL;
+
+    ret_code_t err_code = nrf_twi_mngr_schedule(i2c_manager, &job->transaction);
+    if (err_code != NRF_SUCCESS) {
+        job->busy = false;
+    }
+    return err_code;
+}
+
+bool i2c_sched_idle(void) {
+    return pending == NULL && (i2c_manager == NULL || nrf_twi_mngr_is_idle(i2c_manager));
+}
+
+bool i2c_sched_ready(void) {
+    return i2c_manager != NULL;
+}
@@ -0,0 +1,42 @@
+#ifndef I2C_SCHED_H
+#define I2C_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nrf_twi_mngr.h"
+
+#define I2C_JOB_MAX_CMD 8
+#define I2C_JOB_MAX_RX  9
+
+typedef struct i2c_job_s i2c_job_t;
+typedef void (*i2c_job_handler_t)(i2c_job_t *job, ret_code_t result);
+
+// One command/convert/read exchange with a device. The caller fills the
+// public fields and keeps the job alive until its handler runs. A job with
+// rx_len 0 and a conversion time finishes once that time has passed.
+struct i2c_job_s {
+    uint8_t addr;
+    uint8_t cmd[I2C_JOB_MAX_CMD];
+    uint8_t cmd_len;
+    uint8_t rx[I2C_JOB_MAX_RX];
+    uint8_t rx_len;
+    uint16_t conversion_ms;
+    i2c_job_handler_t handler;
+    void *p_context;
+
+    // Owned by the scheduler.
+    nrf_twi_mngr_transfer_t xfer;
+    nrf_twi_mngr_transaction_t transaction;
+    uint32_t issued_ticks;
+    uint32_t conversion_ticks;
+    i2c_job_t *p_next;
+    volatile bool busy;
+};
+
+void i2c_sched_init(void);
+ret_code_t i2c_sched_submit(i2c_job_t *job);
+bool i2c_sched_idle(void);
+// False while the bus has no working manager, as after a failed re-init.
+bool i2c_sched_ready(void);
+
+#endif
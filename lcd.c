@@ -2,15 +2,11 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
-#include "nrf_delay.h"
-#include "nrfx_spim.h"
 #include "microbit_v2.h"
-#include "nrf_gpio.h"
-#include "nrf_twi_mngr.h"
-#include "nrf_drv_twi.h"
-#include "app_timer.h"
-
-extern volatile bool spi_xfer_done;
+#include "font.h"
+#include "hal.h"
+#include "lcd.h"
+#include "profile.h"
 
 #define WHITE 0
 #define BLACK 1
@@ -22,134 +18,338 @@ extern volatile bool spi_xfer_done;
 #define LCD_COMMAND 0
 #define LCD_DATA 1
 
-#define LCD_WIDTH 84
-#define LCD_HEIGHT 48
+#define LCD_BANKS (LCD_HEIGHT / 8)
+// Unchanged runs shorter than this are resent rather than paying for another gotoXY.
+#define LCD_SPAN_MERGE_GAP 4
+// Further changes in a bank are folded into its last span.
+#define LCD_SPANS_PER_BANK 4
+#define LCD_MAX_SPANS (LCD_BANKS * LCD_SPANS_PER_BANK)
+
+// Frames start at most this often; override with -DLCD_MIN_FRAME_MS=...
+#ifndef LCD_MIN_FRAME_MS
+#define LCD_MIN_FRAME_MS 50
+#endif
 
+// Back buffer: every drawing call renders here.
 uint8_t displayMap[LCD_WIDTH * LCD_HEIGHT / 8]; 
 
-const nrfx_spim_t SPIM_INST = NRFX_SPIM_INSTANCE(2);
-
-static const uint8_t font_digits[][5] = {
-    {0x3E,0x51,0x49,0x45,0x3E}, // '0'
-    {0x00,0x42,0x7F,0x40,0x00}, // '1'
-    {0x42,0x61,0x51,0x49,0x46}, // '2'
-    {0x21,0x41,0x45,0x4B,0x31}, // '3'
-    {0x18,0x14,0x12,0x7F,0x10}, // '4'
-    {0x27,0x45,0x45,0x45,0x39}, // '5'
-    {0x3C,0x4A,0x49,0x49,0x30}, // '6'
-    {0x01,0x71,0x09,0x05,0x03}, // '7'
-    {0x36,0x49,0x49,0x49,0x36}, // '8'
-    {0x06,0x49,0x49,0x29,0x1E}, // '9'
-    {0x00,0x36,0x36,0x00,0x00}, // ':'
-};
+// Front buffer: what the panel shows once the current flush ends. The flush
+// DMAs straight out of it, so it only changes while no flush is running.
+// dirty_x0/x1 are per-bank [x0, x1) column ranges of displayMap written since
+// the last swap.
+static uint8_t frontMap[LCD_WIDTH * LCD_HEIGHT / 8];
+static bool panel_valid = false;
+static uint8_t dirty_x0[LCD_BANKS];
+static uint8_t dirty_x1[LCD_BANKS];
 
-static const uint8_t font_upper[26][5] = {
-    {0x7C,0x12,0x11,0x12,0x7C}, // A
-    {0x7F,0x49,0x49,0x49,0x36}, // B
-    {0x3E,0x41,0x41,0x41,0x22}, // C
-    {0x7F,0x41,0x41,0x22,0x1C}, // D
-    {0x7F,0x49,0x49,0x49,0x41}, // E
-    {0x7F,0x09,0x09,0x09,0x01}, // F
-    {0x3E,0x41,0x49,0x49,0x7A}, // G
-    {0x7F,0x08,0x08,0x08,0x7F}, // H
-    {0x00,0x41,0x7F,0x41,0x00}, // I
-    {0x20,0x40,0x41,0x3F,0x01}, // J
-    {0x7F,0x08,0x14,0x22,0x41}, // K
-    {0x7F,0x40,0x40,0x40,0x40}, // L
-    {0x7F,0x02,0x0C,0x02,0x7F}, // M
-    {0x7F,0x04,0x08,0x10,0x7F}, // N
-    {0x3E,0x41,0x41,0x41,0x3E}, // O
-    {0x7F,0x09,0x09,0x09,0x06}, // P
-    {0x3E,0x41,0x51,0x21,0x5E}, // Q
-    {0x7F,0x09,0x19,0x29,0x46}, // R
-    {0x46,0x49,0x49,0x49,0x31}, // S
-    {0x01,0x01,0x7F,0x01,0x01}, // T
-    {0x3F,0x40,0x40,0x40,0x3F}, // U
-    {0x1F,0x20,0x40,0x20,0x1F}, // V
-    {0x3F,0x40,0x38,0x40,0x3F}, // W
-    {0x63,0x14,0x08,0x14,0x63}, // X
-    {0x07,0x08,0x70,0x08,0x07}, // Y
-    {0x61,0x51,0x49,0x45,0x43}  // Z
-};
+typedef struct {
+    uint16_t offset;
+    uint16_t len;
+} lcd_span_t;
+
+static lcd_span_t spans[LCD_MAX_SPANS];
+static uint8_t span_count = 0;
+static uint8_t span_next = 0;
+static uint8_t span_cmd[2];
+static bool flush_data_phase = false;
+static volatile bool flush_busy = false;
+
+// A rendered frame waiting for the flush in progress or the pacing interval.
+static volatile bool frame_pending = false;
+static bool have_flushed = false;
+static uint32_t last_flush_ticks = 0;
+static uint32_t frames_sent = 0;
+static uint32_t frames_dropped = 0;
+
+HAL_TIMER_DEF(lcd_pace_timer);
+static bool pace_timer_ready = false;
+static volatile bool pace_armed = false;
+static lcd_notify_t frame_notify = NULL;
 
-static const uint8_t font_lower[26][5] = {
-    {0x20,0x54,0x54,0x54,0x78}, // a
-    {0x7F,0x48,0x44,0x44,0x38}, // b
-    {0x38,0x44,0x44,0x44,0x20}, // c
-    {0x38,0x44,0x44,0x48,0x7F}, // d
-    {0x38,0x54,0x54,0x54,0x18}, // e
-    {0x08,0x7E,0x09,0x01,0x02}, // f
-    {0x0C,0x52,0x52,0x52,0x3E}, // g
-    {0x7F,0x08,0x04,0x04,0x78}, // h
-    {0x00,0x44,0x7D,0x40,0x00}, // i
-    {0x20,0x40,0x44,0x3D,0x00}, // j
-    {0x7F,0x10,0x28,0x44,0x00}, // k
-    {0x00,0x41,0x7F,0x40,0x00}, // l
-    {0x7C,0x04,0x18,0x04,0x78}, // m
-    {0x7C,0x08,0x04,0x04,0x78}, // n
-    {0x38,0x44,0x44,0x44,0x38}, // o
-    {0x7C,0x14,0x14,0x14,0x08}, // p
-    {0x08,0x14,0x14,0x18,0x7C}, // q
-    {0x7C,0x08,0x04,0x04,0x08}, // r
-    {0x48,0x54,0x54,0x54,0x20}, // s
-    {0x04,0x3F,0x44,0x40,0x20}, // t
-    {0x3C,0x40,0x40,0x20,0x7C}, // u
-    {0x1C,0x20,0x40,0x20,0x1C}, // v
-    {0x3C,0x40,0x30,0x40,0x3C}, // w
-    {0x44,0x28,0x10,0x28,0x44}, // x
-    {0x0C,0x50,0x50,0x50,0x3C}, // y
-    {0x44,0x64,0x54,0x4C,0x44}  // z
+// Nibble -> each bit repeated 4 times, used to stretch a glyph column vertically.
+// Smaller scales come pre-expanded from the font atlases.
+static const uint16_t scale4_nibble[16] = {
+    0x0000, 0x000F, 0x00F0, 0x00FF, 0x0F00, 0x0F0F, 0x0FF0, 0x0FFF,
+    0xF000, 0xF00F, 0xF0F0, 0xF0FF, 0xFF00, 0xFF0F, 0xFFF0, 0xFFFF
 };
 
-static const uint8_t font_space[5] = {0x00, 0x00, 0x00, 0x00, 0x00};
-static const uint8_t font_dot[5]   = {0x00, 0x00, 0x80, 0x00, 0x00};
+#define BLIT_MAX_SCALE 4
 
 
-void spim_event_handler(nrfx_spim_evt_t const * p_event, void * p_context) {
-    if (p_event->type == NRFX_SPIM_EVENT_DONE)
-        spi_xfer_done = true;
+void LCDWriteBuffer(uint8_t data_or_command, const uint8_t *buf, uint16_t len) {
+    if (len == 0) return;
+    while (flush_busy) {
+        hal_wait_event();
+    }
+    hal_gpio_write(LCD_DC_PIN, data_or_command == LCD_DATA);
+    hal_gpio_write(LCD_SCE_PIN, false);
+
+    // buf must live in RAM for EasyDMA.
+    hal_err_t err_code = hal_spi_write(buf, len);
+    if (err_code != HAL_SUCCESS) {
+        printf("SPI xfer failed! Error: 0x%lX\n", (unsigned long)err_code);
+    }
+    hal_gpio_write(LCD_SCE_PIN, true);
 }
 
-void spim_init(void) {
-    printf("SPI Init: Starting initialization.\r\n");
-    nrfx_spim_config_t spim_config = NRFX_SPIM_DEFAULT_CONFIG;
-    spim_config.sck_pin = EDGE_P13;
-    spim_config.mosi_pin = EDGE_P15;
-    spim_config.miso_pin = EDGE_P14;
-    spim_config.irq_priority = 0;
-    spim_config.frequency = NRF_SPIM_FREQ_4M;
-    spim_config.mode = NRF_SPIM_MODE_0;
-
-    nrfx_spim_init(&SPIM_INST, &spim_config, spim_event_handler, NULL);
-    printf("SPI Init: Initialization complete.\r\n");
+void LCDWriteCommands(const uint8_t *cmds, uint8_t len) {
+    LCDWriteBuffer(LCD_COMMAND, cmds, len);
 }
 
-void LCDWrite(uint8_t data_or_command, uint8_t data) {
-    if (data_or_command == LCD_DATA)
-        nrf_gpio_pin_set(LCD_DC_PIN);
-    else
-        nrf_gpio_pin_clear(LCD_DC_PIN);
+void gotoXY(uint8_t x, uint8_t y) {
+    uint8_t cmds[2] = { 0x80 | x, 0x40 | y };
+    LCDWriteCommands(cmds, sizeof(cmds));
+}
+
+static void markDirty(uint8_t bank, uint8_t x0, uint8_t x1) {
+    if (dirty_x0[bank] >= dirty_x1[bank]) {
+        dirty_x0[bank] = x0;
+        dirty_x1[bank] = x1;
+        return;
+    }
+    if (x0 < dirty_x0[bank]) dirty_x0[bank] = x0;
+    if (x1 > dirty_x1[bank]) dirty_x1[bank] = x1;
+}
+
+static void addSpan(uint8_t bank, uint8_t x0, uint8_t x1, uint8_t *bank_spans) {
+    uint16_t offset = bank * LCD_WIDTH + x0;
+    if (*bank_spans == LCD_SPANS_PER_BANK) {
+        lcd_span_t *last = &spans[span_count - 1];
+        last->len = offset + (x1 - x0) - last->offset;
+        return;
+    }
+    spans[span_count].offset = offset;
+    spans[span_count].len = x1 - x0;
+    span_count++;
+    (*bank_spans)++;
+}
 
-    nrf_gpio_pin_clear(LCD_SCE_PIN);
+// Diffs the back buffer against the front one and copies every changed span
+// across, leaving displayMap free for the next frame straight away.
+static void swapBuffers(void) {
+    PROFILE_SCOPE(PROFILE_UPDATE_DISPLAY);
+    span_count = 0;
+    if (!panel_valid) {
+        memcpy(frontMap, displayMap, sizeof(displayMap));
+        memset(dirty_x1, 0, sizeof(dirty_x1));
+        spans[0].offset = 0;
+        spans[0].len = sizeof(displayMap);
+        span_count = 1;
+        panel_valid = true;
+        return;
+    }
 
-    nrfx_spim_xfer_desc_t xfer = NRFX_SPIM_XFER_TX(&data, 1);
-    spi_xfer_done = false;
-    nrfx_spim_xfer(&SPIM_INST, &xfer, 0);
-    while (!spi_xfer_done) {
-        nrf_delay_us(10);
+    for (uint8_t bank = 0; bank < LCD_BANKS; bank++) {
+        const uint8_t *row = &displayMap[bank * LCD_WIDTH];
+        const uint8_t *shown = &frontMap[bank * LCD_WIDTH];
+        uint8_t x = dirty_x0[bank];
+        uint8_t end = dirty_x1[bank];
+        uint8_t bank_spans = 0;
+        dirty_x0[bank] = 0;
+        dirty_x1[bank] = 0;
+
+        while (x < end) {
+            while (x < end && row[x] == shown[x]) x++;
+            if (x == end) break;
+            uint8_t span_start = x;
+            uint8_t span_end = ++x;
+            while (x < end && x - span_end < LCD_SPAN_MERGE_GAP) {
+                if (row[x] != shown[x]) span_end = x + 1;
+                x++;
+            }
+            addSpan(bank, span_start, span_end, &bank_spans);
+            x = span_end;
+        }
+    }
+    for (uint8_t i = 0; i < span_count; i++) {
+        memcpy(&frontMap[spans[i].offset], &displayMap[spans[i].offset], spans[i].len);
     }
-    nrf_gpio_pin_set(LCD_SCE_PIN);
 }
 
-void gotoXY(uint8_t x, uint8_t y) {
-    LCDWrite(LCD_COMMAND, 0x80 | x);
-    LCDWrite(LCD_COMMAND, 0x40 | y);
+static void flushEnd(void) {
+    hal_gpio_write(LCD_SCE_PIN, true);
+    flush_busy = false;
+    if (frame_notify) frame_notify();
 }
 
+// Runs from the SPIM interrupt once started: each span is a gotoXY command
+// followed by its bytes, DMA'd out of frontMap.
+static void flushStep(void) {
+    hal_err_t err_code;
+    if (!flush_data_phase) {
+        if (span_next == span_count) {
+            flushEnd();
+            return;
+        }
+        const lcd_span_t *span = &spans[span_next];
+        span_cmd[0] = 0x80 | (span->offset % LCD_WIDTH);
+        span_cmd[1] = 0x40 | (span->offset / LCD_WIDTH);
+        hal_gpio_write(LCD_DC_PIN, false);
+        flush_data_phase = true;
+        err_code = hal_spi_write_async(span_cmd, sizeof(span_cmd), flushStep);
+    } else {
+        const lcd_span_t *span = &spans[span_next++];
+        hal_gpio_write(LCD_DC_PIN, true);
+        flush_data_phase = false;
+        err_code = hal_spi_write_async(&frontMap[span->offset], span->len, flushStep);
+    }
+    if (err_code != HAL_SUCCESS) {
+        printf("SPI xfer failed! Error: 0x%lX\n", (unsigned long)err_code);
+        // The panel no longer matches frontMap; resend everything next frame.
+        panel_valid = false;
+        flushEnd();
+    }
+}
+
+static void startFrame(void) {
+    frame_pending = false;
+    swapBuffers();
+    if (span_count == 0) return;
+    last_flush_ticks = hal_ticks();
+    have_flushed = true;
+    frames_sent++;
+    span_next = 0;
+    flush_data_phase = false;
+    flush_busy = true;
+    hal_gpio_write(LCD_SCE_PIN, false);
+    flushStep();
+}
+
+static void pace_timer_cb(void *p_context) {
+    (void)p_context;
+    pace_armed = false;
+    if (frame_notify) frame_notify();
+}
+
+void lcdService(void) {
+    if (!frame_pending || flush_busy) return;
+    if (have_flushed) {
+        uint32_t elapsed = hal_ticks_elapsed(hal_ticks(), last_flush_ticks);
+        uint32_t interval = HAL_MS_TO_TICKS(LCD_MIN_FRAME_MS);
+        if (elapsed < interval) {
+            if (pace_timer_ready && !pace_armed) {
+                pace_armed = true;
+                hal_timer_start(lcd_pace_timer, interval - elapsed, NULL);
+            }
+            return;
+        }
+    }
+    startFrame();
+}
+
+// Queues the back buffer for the panel without waiting on SPI. A frame still
+// queued when the next one arrives is dropped; its changes go out with the
+// newer frame, since the diff always runs against frontMap.
 void updateDisplay(void) {
-    gotoXY(0, 0);
-    for (uint16_t i = 0; i < (LCD_WIDTH * LCD_HEIGHT / 8); i++) {
-        LCDWrite(LCD_DATA, displayMap[i]);
+    bool dirty = !panel_valid;
+    for (uint8_t bank = 0; bank < LCD_BANKS && !dirty; bank++) {
+        dirty = dirty_x0[bank] < dirty_x1[bank];
+    }
+    if (!dirty) return;
+    if (frame_pending) frames_dropped++;
+    frame_pending = true;
+    lcdService();
+}
+
+void lcdFlush(void) {
+    while (flush_busy) {
+        hal_wait_event();
+    }
+    if (frame_pending) startFrame();
+    while (flush_busy) {
+        hal_wait_event();
+    }
+}
+
+void lcdSetFrameNotify(lcd_notify_t notify) {
+    frame_notify = notify;
+    if (!pace_timer_ready) {
+        hal_err_t err_code = hal_timer_create(&lcd_pace_timer, false, pace_timer_cb);
+        if (err_code != HAL_SUCCESS) {
+            printf("lcd_pace_timer init failed: 0x%lX\n", (unsigned long)err_code);
+            return;
+        }
+        pace_timer_ready = true;
+    }
+}
+
+void lcdFrameStats(uint32_t *sent, uint32_t *dropped) {
+    *sent = frames_sent;
+    *dropped = frames_dropped;
+}
+
+// Bits of a bank byte that fall inside rows [y, y_end).
+static uint8_t bankMask(uint8_t bank, uint8_t y, uint8_t y_end) {
+    uint8_t top = (bank * 8 > y) ? 0 : y % 8;
+    uint8_t bottom = (bank * 8 + 8 < y_end) ? 8 : y_end - bank * 8;
+    return (uint8_t)((0xFF << top) & (0xFF >> (8 - bottom)));
+}
+
+// Clears an arbitrary rectangle bank byte by bank byte, masking the partial top and bottom banks.
+void clearRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    if(x >= LCD_WIDTH || y >= LCD_HEIGHT || w == 0 || h == 0) return;
+    if(x + w > LCD_WIDTH) w = LCD_WIDTH - x;
+    if(y + h > LCD_HEIGHT) h = LCD_HEIGHT - y;
+
+    uint8_t y_end = y + h;
+    for(uint8_t bank = y / 8; bank * 8 < y_end; bank++) {
+        uint8_t keep = ~bankMask(bank, y, y_end);
+        uint8_t *row = &displayMap[bank * LCD_WIDTH + x];
+        for(uint8_t i = 0; i < w; i++) {
+            row[i] &= keep;
+        }
+        markDirty(bank, x, x + w);
+    }
+}
+
+// Sets rows y0..y1 of column x with one OR per bank instead of per pixel.
+void drawVLine(uint8_t x, uint8_t y0, uint8_t y1) {
+    if(y0 > y1) {
+        uint8_t t = y0;
+        y0 = y1;
+        y1 = t;
+    }
+    if(x >= LCD_WIDTH || y0 >= LCD_HEIGHT) return;
+    if(y1 >= LCD_HEIGHT) y1 = LCD_HEIGHT - 1;
+
+    uint8_t y_end = y1 + 1;
+    for(uint8_t bank = y0 / 8; bank * 8 < y_end; bank++) {
+        displayMap[bank * LCD_WIDTH + x] |= bankMask(bank, y0, y_end);
+        markDirty(bank, x, x + 1);
+    }
+}
+
+// Moves the rectangle's contents n columns left and clears the n columns
+// freed on its right, leaving pixels outside the rectangle alone.
+void scrollRectLeft(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t n) {
+    if(x >= LCD_WIDTH || y >= LCD_HEIGHT || w == 0 || h == 0 || n == 0) return;
+    if(x + w > LCD_WIDTH) w = LCD_WIDTH - x;
+    if(y + h > LCD_HEIGHT) h = LCD_HEIGHT - y;
+    if(n >= w) {
+        clearRect(x, y, w, h);
+        return;
+    }
+
+    uint8_t y_end = y + h;
+    for(uint8_t bank = y / 8; bank * 8 < y_end; bank++) {
+        uint8_t mask = bankMask(bank, y, y_end);
+        uint8_t *row = &displayMap[bank * LCD_WIDTH + x];
+        uint8_t i = 0;
+        for(; i < w - n; i++) {
+            row[i] = (row[i] & ~mask) | (row[i + n] & mask);
+        }
+        for(; i < w; i++) {
+            row[i] &= ~mask;
+        }
+        markDirty(bank, x, x + w);
+    }
+}
+
+void lcdClearBuffer(void) {
+    memset(displayMap, 0x00, sizeof(displayMap));
+    for (uint8_t bank = 0; bank < LCD_BANKS; bank++) {
+        dirty_x0[bank] = 0;
+        dirty_x1[bank] = LCD_WIDTH;
     }
 }
 
@@ -157,135 +357,133 @@ void setPixel(uint8_t x, uint8_t y, uint8_t color) {
     if(x >= LCD_WIDTH || y >= LCD_HEIGHT) return;
     uint16_t byteIndex = x + (y / 8) * LCD_WIDTH;
     uint8_t bit_mask = 1 << (y % 8);
+    uint8_t old = displayMap[byteIndex];
     if(color == BLACK)
         displayMap[byteIndex] |= bit_mask;
     else
         displayMap[byteIndex] &= ~bit_mask;
+    if(displayMap[byteIndex] != old)
+        markDirty(y / 8, x, x + 1);
+}
+
+static uint32_t scaleColumn(uint8_t line, uint8_t scale) {
+    if(scale == 4) {
+        return scale4_nibble[line & 0x0F] | ((uint32_t)scale4_nibble[line >> 4] << 16);
+    }
+    return line;
+}
+
+// ORs banks rows of pre-expanded columns into displayMap, splitting each byte
+// across two banks when y is not bank aligned.
+static void blitColumns(const uint8_t *cols, uint8_t stride, uint8_t banks, uint8_t x, uint8_t y) {
+    uint8_t bank = y / 8;
+    uint8_t shift = y % 8;
+    uint8_t width = stride;
+    if(x + width > LCD_WIDTH) width = LCD_WIDTH - x;
+
+    for(uint8_t b = 0; b < banks && bank + b < LCD_BANKS; b++) {
+        const uint8_t *src = &cols[b * stride];
+        uint8_t *dst = &displayMap[(bank + b) * LCD_WIDTH + x];
+        if(shift == 0) {
+            for(uint8_t i = 0; i < width; i++) {
+                dst[i] |= src[i];
+            }
+        } else {
+            bool spill = bank + b + 1 < LCD_BANKS;
+            for(uint8_t i = 0; i < width; i++) {
+                dst[i] |= (uint8_t)(src[i] << shift);
+                if(spill) dst[i + LCD_WIDTH] |= src[i] >> (8 - shift);
+            }
+            if(spill) markDirty(bank + b + 1, x, x + width);
+        }
+        markDirty(bank + b, x, x + width);
+    }
+}
+
+// ORs a 5-column glyph into displayMap one bank byte at a time, stretching
+// each column at draw time; used for scales without an atlas.
+static void blitGlyph(const uint8_t *bitmap, uint8_t x, uint8_t y, uint8_t scale) {
+    uint8_t bank = y / 8;
+    uint8_t shift = y % 8;
+    uint8_t banks = (8 * scale + shift + 7) / 8;
+    if(bank + banks > LCD_BANKS) banks = LCD_BANKS - bank;
+    uint16_t width = FONT_WIDTH * scale;
+    if(x + width > LCD_WIDTH) width = LCD_WIDTH - x;
+
+    uint8_t *dst = &displayMap[bank * LCD_WIDTH + x];
+    uint16_t col = 0;
+    for(uint8_t i = 0; i < FONT_WIDTH && col < width; i++) {
+        uint64_t column = (uint64_t)scaleColumn(bitmap[i], scale) << shift;
+        for(uint8_t dx = 0; dx < scale && col < width; dx++, col++) {
+            uint64_t bits = column;
+            for(uint8_t b = 0; b < banks; b++, bits >>= 8) {
+                dst[b * LCD_WIDTH + col] |= (uint8_t)bits;
+            }
+        }
+    }
+    for(uint8_t b = 0; b < banks; b++) {
+        markDirty(bank + b, x, x + width);
+    }
 }
 
 void drawCharScaled(char c, uint8_t x, uint8_t y, uint8_t scale) {
-    const uint8_t *bitmap = NULL;
-    if(c >= '0' && c <= '9') {
-        bitmap = font_digits[c - '0'];
-    } else if(c == ':') {
-        bitmap = font_digits[10];
-    } else if(c == '.') {
-        bitmap = font_dot;
-    } else if(c >= 'A' && c <= 'Z') {
-        bitmap = font_upper[c - 'A'];
-    } else if(c >= 'a' && c <= 'z') {
-        bitmap = font_lower[c - 'a'];
-    } else if(c == '!') {
-        static const uint8_t font_exclam[5] = {
-            0x00,
-            0x5F,
-            0x00,
-            0x00,
-            0x00
-        };
-        bitmap = font_exclam;
-    } else if(c == ' ') {
-        bitmap = font_space;
-    } else {
+    if(scale == 0 || x >= LCD_WIDTH || y >= LCD_HEIGHT) return;
+
+    const uint8_t *atlas = font_atlas(c, scale);
+    if(atlas) {
+        blitColumns(atlas, FONT_WIDTH * scale, scale, x, y);
         return;
     }
 
-    for(uint8_t i = 0; i < 5; i++) {
-        uint8_t line = bitmap[i];
-        for(uint8_t row = 0; row < 8; row++) {
-            if(line & (1 << row)) {
-                for(uint8_t dy = 0; dy < scale; dy++) {
-                    for(uint8_t dx = 0; dx < scale; dx++) {
-                        setPixel(x + i * scale + dx, y + row * scale + dy, BLACK);
+    const uint8_t *bitmap = font_glyph(c);
+    if(scale > BLIT_MAX_SCALE) {
+        for(uint8_t i = 0; i < FONT_WIDTH; i++) {
+            uint8_t line = bitmap[i];
+            for(uint8_t row = 0; row < FONT_HEIGHT; row++) {
+                if(line & (1 << row)) {
+                    for(uint8_t dy = 0; dy < scale; dy++) {
+                        for(uint8_t dx = 0; dx < scale; dx++) {
+                            setPixel(x + i * scale + dx, y + row * scale + dy, BLACK);
+                        }
                     }
                 }
             }
         }
+        return;
     }
+    blitGlyph(bitmap, x, y, scale);
 }
 
 void lcdBegin(void) {
     printf("LCD Init: Configuring control pins...\r\n");
-    nrf_gpio_cfg_output(LCD_RST_PIN);
-    nrf_gpio_cfg_output(LCD_SCE_PIN);
-    nrf_gpio_cfg_output(LCD_DC_PIN);
+    hal_gpio_output(LCD_RST_PIN);
+    hal_gpio_output(LCD_SCE_PIN);
+    hal_gpio_output(LCD_DC_PIN);
     
     printf("LCD Init: Setting initial state...\r\n");
-    nrf_gpio_pin_set(LCD_RST_PIN);
-    nrf_gpio_pin_set(LCD_DC_PIN);
-    nrf_gpio_pin_set(LCD_SCE_PIN);
+    hal_gpio_write(LCD_RST_PIN, true);
+    hal_gpio_write(LCD_DC_PIN, true);
+    hal_gpio_write(LCD_SCE_PIN, true);
     
     printf("LCD Init: Starting reset sequence...\r\n");
-    nrf_delay_ms(10);
-    nrf_gpio_pin_clear(LCD_RST_PIN);
-    nrf_delay_ms(100);
-    nrf_gpio_pin_set(LCD_RST_PIN);
-    nrf_delay_ms(10);
+    hal_delay_ms(10);
+    hal_gpio_write(LCD_RST_PIN, false);
+    hal_delay_ms(100);
+    hal_gpio_write(LCD_RST_PIN, true);
+    hal_delay_ms(10);
     
     printf("LCD Init: Sending initialization commands...\r\n");
-    LCDWrite(LCD_COMMAND, 0x21);
-    LCDWrite(LCD_COMMAND, 0xBF);
-    LCDWrite(LCD_COMMAND, 0x04);
-    LCDWrite(LCD_COMMAND, 0x14);
-    LCDWrite(LCD_COMMAND, 0x20);
-    LCDWrite(LCD_COMMAND, 0x0C);
+    panel_valid = false;
+    uint8_t init_cmds[] = { 0x21, 0xBF, 0x04, 0x14, 0x20, 0x0C };
+    LCDWriteCommands(init_cmds, sizeof(init_cmds));
     printf("LCD Init: Initialization complete.\r\n");
 }
 
 void drawStringScaled(const char *str, uint8_t x, uint8_t y, uint8_t scale, uint8_t spacing) {
+    PROFILE_SCOPE(PROFILE_DRAW_STRING);
     while(*str) {
         drawCharScaled(*str, x, y, scale);
         x += (5 * scale) + spacing;
         str++;
     }
 }
-
-void clear_display(void) {
-    memset(displayMap, 0x00, sizeof(displayMap));
-    updateDisplay();
-}
-
-static uint8_t hours = 0, minutes = 0, seconds = 0;
-static uint8_t alarm_hours = 0, alarm_minutes = 0;
-extern bool alarm_set_flag;
-
-void update_time_display(void) {
-    char timeStr[9];
-    sprintf(timeStr, "%02d:%02d:%02d", hours, minutes, seconds);
-    memset(displayMap, 0x00, sizeof(displayMap));
-    uint8_t scale = 2, spacing = 0;
-    uint8_t len = strlen(timeStr);
-    uint8_t textWidth = len * (5 * scale) + (len - 1) * spacing;
-    uint8_t startX = (LCD_WIDTH > textWidth) ? (LCD_WIDTH - textWidth) / 2 : 0;
-    uint8_t textHeight = 8 * scale;
-    uint8_t startY = (LCD_HEIGHT > textHeight) ? (LCD_HEIGHT - textHeight) / 2 : 0;
-    drawStringScaled(timeStr, startX, startY, scale, spacing);
-    updateDisplay();
-}
-
-void update_alarm_display(void) {
-    char alarmStr[6];
-    sprintf(alarmStr, "%02d:%02d", alarm_hours, alarm_minutes);
-    memset(displayMap, 0x00, sizeof(displayMap));
-    uint8_t scale = 2, spacing = 0;
-    uint8_t len = strlen(alarmStr);
-    uint8_t textWidth = len * (5 * scale) + (len - 1) * spacing;
-    uint8_t startX = (LCD_WIDTH > textWidth) ? (LCD_WIDTH - textWidth) / 2 : 0;
-    uint8_t textHeight = 8 * scale;
-    uint8_t startY = (LCD_HEIGHT > textHeight) ? (LCD_HEIGHT - textHeight) / 2 : 0;
-    drawStringScaled(alarmStr, startX, startY, scale, spacing);
-    updateDisplay();
-}
-
-void display_time_up_message(void) {
-    char msg[] = "WAKE!";
-    memset(displayMap, 0x00, sizeof(displayMap));
-    uint8_t scale = 2, spacing = 1;
-    uint8_t len = strlen(msg);
-    uint8_t textWidth = len * (5 * scale) + (len - 1) * spacing;
-    uint8_t startX = (LCD_WIDTH > textWidth) ? (LCD_WIDTH - textWidth) / 2 : 0;
-    uint8_t textHeight = 8 * scale;
-    uint8_t startY = (LCD_HEIGHT > textHeight) ? (LCD_HEIGHT - textHeight) / 2 : 0;
-    drawStringScaled(msg, startX, startY, scale, spacing);
-    updateDisplay();
-}
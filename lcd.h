@@ -3,22 +3,30 @@
 
 #include <stdint.h>
 
-void spim_init(void);
 void lcdBegin(void);
 
-void LCDWrite(uint8_t data_or_command, uint8_t data);
+void LCDWriteBuffer(uint8_t data_or_command, const uint8_t *buf, uint16_t len);
+void LCDWriteCommands(const uint8_t *cmds, uint8_t len);
 void gotoXY(uint8_t x, uint8_t y);
+
+// Drawing goes to the back buffer; updateDisplay() queues it and returns while
+// SPIM DMA sends the changes. Frames are paced to LCD_MIN_FRAME_MS. notify runs
+// in interrupt context whenever lcdService() has more work to do.
+typedef void (*lcd_notify_t)(void);
 void updateDisplay(void);
+void lcdService(void);
+void lcdFlush(void);
+void lcdSetFrameNotify(lcd_notify_t notify);
+void lcdFrameStats(uint32_t *sent, uint32_t *dropped);
 
 void setPixel(uint8_t x, uint8_t y, uint8_t color);
 void drawCharScaled(char c, uint8_t x, uint8_t y, uint8_t scale);
 void drawStringScaled(const char *str, uint8_t x, uint8_t y, uint8_t scale, uint8_t spacing);
 
-void clear_display(void);
-
-void update_time_display(void);
-void update_alarm_display(void);
-void display_time_up_message(void);
+void clearRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+void drawVLine(uint8_t x, uint8_t y0, uint8_t y1);
+void scrollRectLeft(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t n);
+void lcdClearBuffer(void);
 
 #define LCD_WIDTH 84
 #define LCD_HEIGHT 48
@@ -2,258 +2,289 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
-#include "nrf_delay.h"
-#include "nrfx_spim.h"
 #include "microbit_v2.h"
-#include "nrf_gpio.h"
-#include "nrf_twi_mngr.h"
-#include "nrf_drv_twi.h"
-#include "app_timer.h"
-#include "nrfx_pwm.h"
+#include "app_util_platform.h"
+#include "hal.h"
 #include "alarm.h"
 #include "sensor.h"
 #include "lcd.h"
+#include "i2c_sched.h"
+#include "timekeeping.h"
+#include "button.h"
+#include "ui.h"
+#include "history.h"
+#include "rules.h"
+#include "schedule.h"
+#include "flashlog.h"
+#include "telemetry.h"
+#include "profile.h"
+#include "bench.h"
 
-const nrf_twi_mngr_t* i2c_manager = NULL;
-NRF_TWI_MNGR_DEF(twi_mngr_instance, 1, 0);
+#define CLOCK_TICK_MS 1000
+#define UI_TICK_MS    100
+// The history tiers assume one sample per second.
+#define SENSOR_SAMPLE_PERIOD_MS 1000
+// The module counters are printed, and the flash log flushed, once per this
+// many logged minutes.
+#define HEALTH_REPORT_MINUTES 60
+// With -DPROFILE_ENABLED, -DBENCH_ITERATIONS=n runs the benchmark suite at boot.
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 0
+#endif
 
-volatile bool spi_xfer_done = false;
-bool alarm_set_flag = false; 
-static uint8_t hours = 0, minutes = 0, seconds = 0;
-static uint8_t alarm_hours = 0, alarm_minutes = 0;
+// Per-board crystal correction in parts per million; override with -DCLOCK_TRIM_PPM=...
+#ifndef CLOCK_TRIM_PPM
+#define CLOCK_TRIM_PPM 0
+#endif
 
-#define BUTTON_A_PIN 14
-#define BUTTON_B_PIN 23
+// Wake-up reasons posted from interrupt context and drained by the main loop.
+#define EVT_CLOCK  0x01
+#define EVT_UI     0x02
+#define EVT_BUTTON 0x04
+#define EVT_LCD    0x08
+#define EVT_ALARM  0x10
 
-typedef enum {
-    STATE_NORMAL,
-    STATE_ALARM_SET,
-    STATE_TIMEUP,
-    STATE_ENVIRONMENT 
-} system_state_t;
-system_state_t system_state = STATE_NORMAL;
+HAL_TIMER_DEF(clock_timer);
+HAL_TIMER_DEF(ui_timer);
+static volatile uint32_t pending_events = 0;
 
+static void post_event(uint32_t evt) {
+    CRITICAL_REGION_ENTER();
+    pending_events |= evt;
+    CRITICAL_REGION_EXIT();
+}
+
+static uint32_t take_events(void) {
+    uint32_t events;
+    CRITICAL_REGION_ENTER();
+    events = pending_events;
+    pending_events = 0;
+    CRITICAL_REGION_EXIT();
+    return events;
+}
+
+static void clock_timer_cb(void *p_context) {
+    (void)p_context;
+    post_event(EVT_CLOCK);
+}
+
+static void ui_timer_cb(void *p_context) {
+    (void)p_context;
+    post_event(EVT_UI);
+}
+
+static void button_notify(void) {
+    post_event(EVT_BUTTON);
+}
+
+static void lcd_notify(void) {
+    post_event(EVT_LCD);
+}
+
+static void schedule_notify(void) {
+    post_event(EVT_ALARM);
+}
+
+static void tick_timers_start(void) {
+    hal_err_t err_code;
 
-uint32_t current_ms = 0;
-uint32_t last_normal_update = 0;
-uint32_t last_flash_toggle = 0;
-uint32_t last_environment_update = 0; 
-uint32_t buttonA_press_start = 0;
-uint32_t buttonB_press_start = 0;
-bool buttonA_was_pressed = false;
-bool buttonB_was_pressed = false;
-uint32_t timeup_start = 0;
+    err_code = hal_timer_create(&clock_timer, true, clock_timer_cb);
+    if (err_code == HAL_SUCCESS) {
+        err_code = hal_timer_start(clock_timer, HAL_MS_TO_TICKS(CLOCK_TICK_MS), NULL);
+    }
+    if (err_code != HAL_SUCCESS) {
+        printf("clock_timer start failed: 0x%lX\n", (unsigned long)err_code);
+    }
+
+    err_code = hal_timer_create(&ui_timer, true, ui_timer_cb);
+    if (err_code == HAL_SUCCESS) {
+        err_code = hal_timer_start(ui_timer, HAL_MS_TO_TICKS(UI_TICK_MS), NULL);
+    }
+    if (err_code != HAL_SUCCESS) {
+        printf("ui_timer start failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
+
+static uint32_t history_sequence = 0;
+static uint32_t logged_minutes = 0;
+
+// Each closed minute bucket is written to flash as its per-channel average,
+// stamped with wall-clock seconds rather than uptime, which restarts at every boot.
+static void log_minute(void) {
+    history_bucket_t eco2, tvoc, temperature, humidity;
+    if (!history_get(HISTORY_ECO2, HISTORY_WINDOW_HOUR, 0, &eco2) ||
+        !history_get(HISTORY_TVOC, HISTORY_WINDOW_HOUR, 0, &tvoc) ||
+        !history_get(HISTORY_TEMPERATURE_TICKS, HISTORY_WINDOW_HOUR, 0, &temperature) ||
+        !history_get(HISTORY_HUMIDITY_TICKS, HISTORY_WINDOW_HOUR, 0, &humidity)) {
+        return;
+    }
+    flashlog_sample_t entry = {
+        .timestamp_s       = timekeeping_wall_seconds(),
+        .eco2              = eco2.avg,
+        .tvoc              = tvoc.avg,
+        .temperature_ticks = temperature.avg,
+        .humidity_ticks    = humidity.avg,
+    };
+    flashlog_append_sample(&entry);
+}
+
+// A fresh SGP30 baseline replaces the stored one; the alarm fields are kept.
+static void save_baseline(void) {
+    sgp30_data_t baseline;
+    if (!sensor_take_baseline(&baseline)) {
+        return;
+    }
+    flashlog_settings_t settings = {0};
+    flashlog_load_settings(&settings);
+    settings.baseline_valid = true;
+    settings.baseline_eco2 = baseline.eco2;
+    settings.baseline_tvoc = baseline.tvoc;
+    flashlog_save_settings(&settings);
+    printf("Saved SGP30 baseline %04X/%04X\n", baseline.eco2, baseline.tvoc);
+}
+
+static void restore_baseline(void) {
+    flashlog_settings_t settings;
+    if (flashlog_load_settings(&settings) && settings.baseline_valid) {
+        sgp30_data_t baseline = { settings.baseline_eco2, settings.baseline_tvoc };
+        sensor_set_baseline(&baseline);
+        printf("Restored SGP30 baseline %04X/%04X\n", baseline.eco2, baseline.tvoc);
+    }
+}
+
+// Every drop and error counter kept by the drivers, so a long run can be
+// checked from the console without a debugger attached.
+static void report_health(void) {
+    static const char *const names[SENSOR_DEV_COUNT] = { "SGP30", "SHT45" };
+    uint32_t frames_sent, frames_dropped;
+    lcdFrameStats(&frames_sent, &frames_dropped);
+    printf("Health: LCD %lu frames, %lu dropped; telemetry %lu dropped; buttons %lu dropped\n",
+           (unsigned long)frames_sent, (unsigned long)frames_dropped,
+           (unsigned long)telemetry_dropped_frames(), (unsigned long)button_dropped_events());
+    for (uint8_t dev = 0; dev < SENSOR_DEV_COUNT; dev++) {
+        sensor_health_t health;
+        if (!sensor_get_health((sensor_dev_t)dev, &health)) {
+            continue;
+        }
+        printf("Health: %s %lu good, %lu failed, %lu transfer, %lu CRC, %lu retries, "
+               "%lu bus clears, longest outage %u\n",
+               names[dev], (unsigned long)health.good_periods, (unsigned long)health.failed_periods,
+               (unsigned long)health.transfer_errors, (unsigned long)health.crc_errors,
+               (unsigned long)health.retries, (unsigned long)health.bus_clears,
+               health.longest_outage);
+    }
+}
+
+static void record_history(void) {
+    env_sample_t sample;
+    // Samples with an invalid half still go through; each of these looks at
+    // the status of every half itself, so one dead sensor does not stop the other.
+    sensor_get_latest(&sample);
+    if (sample.sequence != history_sequence) {
+        history_sequence = sample.sequence;
+        history_add(&sample);
+        rules_evaluate(&sample);
+        telemetry_sample(&sample);
+        if (history_minutes_total() != logged_minutes) {
+            logged_minutes = history_minutes_total();
+            log_minute();
+            if (logged_minutes % HEALTH_REPORT_MINUTES == 0) {
+                report_health();
+                // A part batch still in RAM would be lost on reset; write it out.
+                flashlog_flush();
+            }
+        }
+    }
+}
+
+// Sakamoto's method, shifted so Monday = 0 as timekeeping expects.
+static uint8_t weekday_of(int y, int m, int d) {
+    static const uint8_t t[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    if (m < 3) y--;
+    return (uint8_t)((y + y / 4 - y / 100 + y / 400 + t[m - 1] + d + 6) % 7);
+}
 
 static void init_time_from_compile(void) {
     int h, m, s;
     if (sscanf(__TIME__, "%d:%d:%d", &h, &m, &s) == 3) {
-        hours = (uint8_t)h;
-        minutes = (uint8_t)m;
-        seconds = (uint8_t)s;
+        timekeeping_set_time((uint8_t)h, (uint8_t)m, (uint8_t)s);
     } else {
-        hours = 0; minutes = 0; seconds = 0;
+        h = 0; m = 0; s = 0;
+        timekeeping_set_time(0, 0, 0);
+    }
+    printf("Initial time: %02d:%02d:%02d\n", h, m, s);
+
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char month[4];
+    int day, year;
+    if (sscanf(__DATE__, "%3s %d %d", month, &day, &year) == 3) {
+        for (int i = 0; i < 12; i++) {
+            if (strncmp(month, &months[i * 3], 3) == 0) {
+                timekeeping_set_weekday(weekday_of(year, i + 1, day));
+                break;
+            }
+        }
     }
-    printf("Initial time: %02d:%02d:%02d\n", hours, minutes, seconds);
 }
 
 
 int main(void) {
     printf("Main: Starting program...\r\n");
-    spim_init();
+    profile_init();
+    hal_spi_init();
     lcdBegin();
-    nrf_gpio_cfg_input(BUTTON_A_PIN, NRF_GPIO_PIN_PULLUP);
-    nrf_gpio_cfg_input(BUTTON_B_PIN, NRF_GPIO_PIN_PULLUP);
-    init_time_from_compile();
-    last_normal_update = 0;
-    last_flash_toggle = 0;
-    current_ms = 0;
-    nrf_drv_twi_config_t twi_config = NRF_DRV_TWI_DEFAULT_CONFIG;
-    twi_config.scl = I2C_QWIIC_SCL;
-    twi_config.sda = I2C_QWIIC_SDA;
-    twi_config.frequency = NRF_TWIM_FREQ_100K;
-    twi_config.interrupt_priority = 0;
-    nrf_twi_mngr_init(&twi_mngr_instance, &twi_config);
-    i2c_manager = &twi_mngr_instance;
-    nrf_gpio_cfg_output(EDGE_P2);
-    nrf_gpio_pin_write(EDGE_P2, 0);
-    nrfx_pwm_config_t pwm_config = {
-        .output_pins = {
-            EDGE_P3,
-            EDGE_P4,
-            NRFX_PWM_PIN_NOT_USED,
-            NRFX_PWM_PIN_NOT_USED
-        },
-        .irq_priority = APP_IRQ_PRIORITY_LOWEST,
-        .base_clock   = NRF_PWM_CLK_4MHz,
-        .count_mode   = NRF_PWM_MODE_UP,
-        .top_value    = 0,
-        .load_mode    = NRF_PWM_LOAD_COMMON,
-        .step_mode    = NRF_PWM_STEP_AUTO
-    };
-    ret_code_t err_code = nrfx_pwm_init(&m_pwm0, &pwm_config, NULL);
-    app_timer_init();
+    hal_i2c_init();
+    hal_gpio_output(EDGE_P2);
+    hal_gpio_write(EDGE_P2, false);
+    hal_pwm_init();
+    hal_timer_init();
+    lcdSetFrameNotify(lcd_notify);
+    telemetry_init();
     alarm_init();
+    i2c_sched_init();
+    sensor_acq_init();
+    history_init();
+    rules_init();
+    flashlog_init();
+    timekeeping_init();
+    timekeeping_set_trim_ppm(CLOCK_TRIM_PPM);
+    buttons_init(button_notify);
+    init_time_from_compile();
+    schedule_init(schedule_notify);
+    if (BENCH_ITERATIONS > 0) {
+        bench_run(BENCH_ITERATIONS);
+    }
+    ui_init();
+    tick_timers_start();
+    restore_baseline();
+    sensor_acq_start(SENSOR_SAMPLE_PERIOD_MS);
     while (1) {
-        nrf_delay_ms(10);
-        current_ms += 10;
-        if(current_ms - last_normal_update >= 500) {
-            last_normal_update = current_ms;
-            seconds++;
-            if(seconds >= 60) { seconds = 0; minutes++; }
-            if(minutes >= 60) { minutes = 0; hours++; }
-            if(hours >= 24)   { hours = 0; }
+        if (take_events() == 0) {
+            // Every timer and button edge is an interrupt, so WFE wakes for all of them.
+            __WFE();
+            continue;
         }
-        if(system_state == STATE_NORMAL) {
-            {
-                char timeStr[9];
-                sprintf(timeStr, "%02d:%02d:%02d", hours, minutes, seconds);
-                memset(displayMap, 0x00, sizeof(displayMap));
-                uint8_t scale = 2, spacing = 0;
-                uint8_t len = strlen(timeStr);
-                uint8_t textWidth = len * (5 * scale) + (len - 1) * spacing;
-                uint8_t startX = (84 > textWidth) ? (84 - textWidth) / 2 : 0;
-                uint8_t textHeight = 8 * scale;
-                uint8_t startY = (48 > textHeight) ? (48 - textHeight) / 2 : 0;
-                drawStringScaled(timeStr, startX, startY, scale, spacing);
-                updateDisplay();
-            }
-            if(nrf_gpio_pin_read(BUTTON_A_PIN) == 0) {
-                if(!buttonA_was_pressed) {
-                    buttonA_press_start = current_ms;
-                    buttonA_was_pressed = true;
-                }
-            } else {
-                if(buttonA_was_pressed) {
-                    uint32_t duration = current_ms - buttonA_press_start;
-                    if(duration >= 1000) {
-                        system_state = STATE_ENVIRONMENT;
-                        printf("Entering Environment Detection Mode\n");
-                        last_environment_update = current_ms;
-                    }
-                    buttonA_was_pressed = false;
-                }
-            }
-            if(nrf_gpio_pin_read(BUTTON_B_PIN) == 0) {
-                if(!buttonB_was_pressed) {
-                    buttonB_press_start = current_ms;
-                    buttonB_was_pressed = true;
-                }
-            } else {
-                if(buttonB_was_pressed) {
-                    uint32_t duration = current_ms - buttonB_press_start;
-                    if(duration >= 500) {
-                        system_state = STATE_ALARM_SET;
-                        alarm_hours   = hours;
-                        alarm_minutes = minutes;
-                        printf("Entering Alarm Set Mode\n");
-                    }
-                    buttonB_was_pressed = false;
-                }
-            }
-            if(alarm_set_flag &&
-               (hours == alarm_hours) &&
-               (minutes == alarm_minutes) &&
-               (seconds == 0))
-            {
-                system_state = STATE_TIMEUP;
-                timeup_start = current_ms;
-                display_time_up_message();
-                start_radar_alarm();
+        PROFILE_BEGIN(PROFILE_MAIN_LOOP);
+        button_event_t evt;
+        while(button_event_get(&evt)) {
+#ifdef PROFILE_ENABLED
+            // Long-pressing one button while holding the other dumps the profile.
+            button_id_t other = (evt.button == BUTTON_A) ? BUTTON_B : BUTTON_A;
+            if (evt.type == BUTTON_EVT_LONG && button_is_pressed(other)) {
+                profile_dump("live");
+                continue;
             }
+#endif
+            ui_handle_button(&evt);
         }
-        else if(system_state == STATE_ALARM_SET) {
-            if(current_ms - last_flash_toggle >= 500) {
-                last_flash_toggle = current_ms;
-                static bool flash_on = true;
-                flash_on = !flash_on;
-                if(flash_on) {
-                    char alarmStr[6];
-                    sprintf(alarmStr, "%02d:%02d", alarm_hours, alarm_minutes);
-                    memset(displayMap, 0x00, sizeof(displayMap));
-                    uint8_t scale = 2, spacing = 0;
-                    uint8_t len = strlen(alarmStr);
-                    uint8_t textWidth = len * (5 * scale) + (len - 1) * spacing;
-                    uint8_t startX = (84 > textWidth) ? (84 - textWidth) / 2 : 0;
-                    uint8_t textHeight = 8 * scale;
-                    uint8_t startY = (48 > textHeight) ? (48 - textHeight) / 2 : 0;
-                    drawStringScaled(alarmStr, startX, startY, scale, spacing);
-                    updateDisplay();
-                } else {
-                    clear_display();
-                }
-            }
-            if(nrf_gpio_pin_read(BUTTON_A_PIN) == 0) {
-                if(!buttonA_was_pressed) {
-                    buttonA_press_start = current_ms;
-                    buttonA_was_pressed = true;
-                }
-            } else {
-                if(buttonA_was_pressed) {
-                    uint32_t duration = current_ms - buttonA_press_start;
-                    if(duration < 500) {
-                        alarm_minutes++;
-                        if(alarm_minutes >= 60) {
-                            alarm_minutes = 0;
-                            alarm_hours++;
-                            if(alarm_hours >= 24) alarm_hours = 0;
-                        }
-                    }
-                    buttonA_was_pressed = false;
-                }
-            }
-            if(nrf_gpio_pin_read(BUTTON_B_PIN) == 0) {
-                if(!buttonB_was_pressed) {
-                    buttonB_press_start = current_ms;
-                    buttonB_was_pressed = true;
-                }
-            } else {
-                if(buttonB_was_pressed) {
-                    uint32_t duration = current_ms - buttonB_press_start;
-                    if(duration < 500) {
-                        if(alarm_minutes == 0) {
-                            alarm_minutes = 59;
-                            if(alarm_hours == 0) alarm_hours = 23;
-                            else alarm_hours--;
-                        } else {
-                            alarm_minutes--;
-                        }
-                    } else {
-                        system_state = STATE_NORMAL;
-                        alarm_set_flag = true;
-                        printf("Alarm set to %02d:%02d\n", alarm_hours, alarm_minutes);
-                    }
-                    buttonB_was_pressed = false;
-                }
-            }
-        }
-        else if(system_state == STATE_TIMEUP) {
-            if(current_ms - timeup_start >= 1500) {
-                if(system_state == STATE_TIMEUP) {
-                    system_state = STATE_NORMAL;
-                }
-            }
-        }
-        else if(system_state == STATE_ENVIRONMENT) {
-            if(current_ms - last_environment_update >= 500) {
-                last_environment_update = current_ms;
-                update_environment_display();
-            }
-            if(nrf_gpio_pin_read(BUTTON_A_PIN) == 0) {
-                if(!buttonA_was_pressed) {
-                    buttonA_press_start = current_ms;
-                    buttonA_was_pressed = true;
-                }
-            } else {
-                if(buttonA_was_pressed) {
-                    uint32_t duration = current_ms - buttonA_press_start;
-                    if(duration >= 500) {
-                        system_state = STATE_NORMAL;
-                        printf("Exiting Environment Detection Mode\n");
-                    }
-                    buttonA_was_pressed = false;
-                }
-            }
+        if (schedule_take_fired()) {
+            ui_alarm_due();
         }
+        record_history();
+        save_baseline();
+        ui_tick();
+        lcdService();
+        PROFILE_END(PROFILE_MAIN_LOOP);
     }
     
     return 0;
@@ -0,0 +1,142 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "app_util_platform.h"
+#include "profile.h"
+
+#ifdef HAL_HOST
+#include <time.h>
+#define PROFILE_UNITS "ns"
+#else
+#include "nrf.h"
+#define PROFILE_UNITS "cycles"
+#endif
+
+// Log-linear buckets: 0-3 are exact, then each octave [2^k, 2^(k+1)) splits
+// into PROFILE_SUB_BUCKETS equal parts. Percentiles are reported as the upper
+// edge of their bucket, clamped to the observed range, so they read at most
+// 25% high.
+#define PROFILE_SUB_BITS    2
+#define PROFILE_SUB_BUCKETS (1 << PROFILE_SUB_BITS)
+#define PROFILE_BUCKETS     (PROFILE_SUB_BUCKETS * (32 - PROFILE_SUB_BITS + 1))
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t buckets[PROFILE_BUCKETS];
+} profile_hist_t;
+
+static profile_hist_t hists[PROFILE_SITE_COUNT];
+
+static const char *const site_names[PROFILE_SITE_COUNT] = {
+    [PROFILE_UPDATE_DISPLAY] = "update_display",
+    [PROFILE_DRAW_STRING]    = "draw_string",
+    [PROFILE_SGP30_READ]     = "sgp30_read",
+    [PROFILE_SHT45_READ]     = "sht45_read",
+    [PROFILE_SENSOR_DECODE]  = "sensor_decode",
+    [PROFILE_MAIN_LOOP]      = "main_loop",
+    [PROFILE_FORMAT_FIXED]   = "format_fixed",
+    [PROFILE_FORMAT_FLOAT]   = "format_float",
+    [PROFILE_GLYPH_BLIT]     = "glyph_blit",
+    [PROFILE_GLYPH_PIXELS]   = "glyph_pixels",
+    [PROFILE_VIEW_CLOCK]     = "view_clock",
+    [PROFILE_VIEW_ENV]       = "view_environment",
+};
+
+void profile_init(void) {
+#ifndef HAL_HOST
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    profile_reset();
+}
+
+// 32-bit cycle count; wraps after about 67 s at 64 MHz, far longer than
+// any measured section.
+uint32_t profile_now(void) {
+#ifndef HAL_HOST
+    return DWT->CYCCNT;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+static uint8_t bucket_of(uint32_t elapsed) {
+    if (elapsed < PROFILE_SUB_BUCKETS) {
+        return (uint8_t)elapsed;
+    }
+    uint8_t shift = (uint8_t)(31 - __builtin_clz(elapsed) - PROFILE_SUB_BITS);
+    // elapsed >> shift is in [PROFILE_SUB_BUCKETS, 2 * PROFILE_SUB_BUCKETS).
+    return (uint8_t)(PROFILE_SUB_BUCKETS * shift + (elapsed >> shift));
+}
+
+static uint32_t bucket_upper(uint8_t b) {
+    if (b < PROFILE_SUB_BUCKETS) {
+        return b;
+    }
+    uint8_t shift = b / PROFILE_SUB_BUCKETS - 1;
+    uint64_t next = (uint64_t)(b % PROFILE_SUB_BUCKETS + PROFILE_SUB_BUCKETS + 1) << shift;
+    return (uint32_t)(next - 1);
+}
+
+void profile_record(profile_site_t site, uint32_t elapsed) {
+    profile_hist_t *h = &hists[site];
+    CRITICAL_REGION_ENTER();
+    if (h->count == 0 || elapsed < h->min) h->min = elapsed;
+    if (elapsed > h->max) h->max = elapsed;
+    h->count++;
+    h->total += elapsed;
+    h->buckets[bucket_of(elapsed)]++;
+    CRITICAL_REGION_EXIT();
+}
+
+void profile_scope_end(profile_scope_t *scope) {
+    profile_record(scope->site, profile_now() - scope->start);
+}
+
+void profile_reset(void) {
+    CRITICAL_REGION_ENTER();
+    memset(hists, 0, sizeof(hists));
+    CRITICAL_REGION_EXIT();
+}
+
+static uint32_t percentile(const profile_hist_t *h, uint8_t pct) {
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (uint16_t b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint32_t edge = bucket_upper(b);
+            if (edge < h->min) return h->min;
+            if (edge > h->max) return h->max;
+            return edge;
+        }
+    }
+    return h->max;
+}
+
+// One CSV row per site that has samples, so two builds' reports can be diffed
+// line by line.
+void profile_dump(const char *tag) {
+    static profile_hist_t snapshot;
+    printf("# profile %s units=%s\n", tag, PROFILE_UNITS);
+    printf("site,count,min,p50,p99,max,mean\n");
+    for (uint8_t site = 0; site < PROFILE_SITE_COUNT; site++) {
+        CRITICAL_REGION_ENTER();
+        snapshot = hists[site];
+        CRITICAL_REGION_EXIT();
+        if (snapshot.count == 0) {
+            continue;
+        }
+        printf("%s,%lu,%lu,%lu,%lu,%lu,%lu\n", site_names[site],
+               (unsigned long)snapshot.count, (unsigned long)snapshot.min,
+               (unsigned long)percentile(&snapshot, 50), (unsigned long)percentile(&snapshot, 99),
+               (unsigned long)snapshot.max, (unsigned long)(snapshot.total / snapshot.count));
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Build with -DPROFILE_ENABLED to collect timings; otherwise every macro
+// below compiles to nothing.
+
+typedef enum {
+    PROFILE_UPDATE_DISPLAY,
+    PROFILE_DRAW_STRING,
+    PROFILE_SGP30_READ,   // measurement job, submit to handler
+    PROFILE_SHT45_READ,
+    PROFILE_SENSOR_DECODE,
+    PROFILE_MAIN_LOOP,
+    PROFILE_FORMAT_FIXED,  // bench only: integer convert and format
+    PROFILE_FORMAT_FLOAT,  // bench only: the float formula and %.2f it replaced
+    PROFILE_GLYPH_BLIT,    // bench only: one clock digit through drawCharScaled
+    PROFILE_GLYPH_PIXELS,  // bench only: the same digit a setPixel at a time
+    PROFILE_VIEW_CLOCK,    // bench only: view_clock over a simulated hour
+    PROFILE_VIEW_ENV,      // bench only: view_environment over a simulated hour
+    PROFILE_SITE_COUNT
+} profile_site_t;
+
+typedef struct {
+    profile_site_t site;
+    uint32_t start;
+} profile_scope_t;
+
+void profile_init(void);
+uint32_t profile_now(void);
+void profile_record(profile_site_t site, uint32_t elapsed);
+void profile_scope_end(profile_scope_t *scope);
+void profile_reset(void);
+void profile_dump(const char *tag);
+
+#ifdef PROFILE_ENABLED
+// Times the rest of the enclosing block, including early returns.
+#define PROFILE_SCOPE(site) \
+    profile_scope_t profile_scope_##site __attribute__((cleanup(profile_scope_end))) = { (site), profile_now() }
+#define PROFILE_BEGIN(site) uint32_t profile_start_##site = profile_now()
+#define PROFILE_END(site)   profile_record((site), profile_now() - profile_start_##site)
+// For work that finishes in another function, such as an I2C job timed from
+// submit to its completion handler; stamp is a uint32_t that outlives both.
+#define PROFILE_STAMP(stamp)       ((stamp) = profile_now())
+#define PROFILE_SINCE(site, stamp) profile_record((site), profile_now() - (stamp))
+#else
+#define PROFILE_SCOPE(site) do {} while (0)
+#define PROFILE_BEGIN(site) do {} while (0)
+#define PROFILE_END(site)   do {} while (0)
+#define PROFILE_STAMP(stamp)       ((void)(stamp))
+#define PROFILE_SINCE(site, stamp) ((void)(stamp))
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "alarm.h"
+#include "rules.h"
+#include "telemetry.h"
+
+typedef struct {
+    uint8_t run;      // consecutive samples meeting the trip condition
+    bool active;
+} rule_state_t;
+
+static const rule_t default_rules[] = {
+    { HISTORY_TEMPERATURE_TICKS, RULE_ABOVE, 3, 0,
+      RULE_CENTI_CELSIUS_TICKS(3000), RULE_CENTI_CELSIUS_SPAN(50), ALARM_SRC_TEMPERATURE },
+    { HISTORY_HUMIDITY_TICKS, RULE_ABOVE, 3, 0,
+      RULE_CENTI_RH_TICKS(7000), RULE_CENTI_RH_SPAN(200), ALARM_SRC_HUMIDITY },
+    { HISTORY_ECO2, RULE_ABOVE, 3, 0, 800, 50, ALARM_SRC_ECO2 },
+};
+
+static rule_t rules[RULES_MAX];
+static rule_state_t states[RULES_MAX];
+static uint8_t rule_count = 0;
+
+// The last RULES_MAX_WINDOW values of every channel, for RULE_RISE.
+static uint16_t recent[HISTORY_CHANNELS][RULES_MAX_WINDOW];
+static uint8_t recent_head = 0;
+static uint8_t recent_count = 0;
+
+void rules_init(void) {
+    rules_load(default_rules, sizeof(default_rules) / sizeof(default_rules[0]));
+}
+
+// Replaces the whole table; every rule starts inactive.
+bool rules_load(const rule_t *table, uint8_t count) {
+    if (count > RULES_MAX) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (table[i].channel >= HISTORY_CHANNELS || table[i].source >= ALARM_SRC_COUNT ||
+            (table[i].kind == RULE_RISE &&
+             (table[i].window == 0 || table[i].window >= RULES_MAX_WINDOW))) {
+            return false;
+        }
+    }
+    memcpy(rules, table, count * sizeof(rule_t));
+    memset(states, 0, sizeof(states));
+    rule_count = count;
+    return true;
+}
+
+// Returns +1 when the rule trips, -1 when it is past the release point and
+// 0 inside the hysteresis band.
+static int8_t rule_test(const rule_t *rule, const uint16_t *values) {
+    int32_t v = values[rule->channel];
+    int32_t t = rule->threshold;
+    int32_t h = rule->hysteresis;
+    switch (rule->kind) {
+    case RULE_ABOVE:
+        return (v > t) ? 1 : (v <= t - h) ? -1 : 0;
+    case RULE_BELOW:
+        return (v < t) ? 1 : (v >= t + h) ? -1 : 0;
+    case RULE_RISE: {
+        if (recent_count <= rule->window) {
+            return -1;
+        }
+        uint8_t idx = (recent_head + RULES_MAX_WINDOW - 1 - rule->window) % RULES_MAX_WINDOW;
+        int32_t delta = v - recent[rule->channel][idx];
+        return (delta > t) ? 1 : (delta <= t - h) ? -1 : 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+// O(rules) per sample. An alarm source stays raised while any of its rules
+// is active; the alarm module plays it once per excursion. A rule on a
+// channel without a fresh reading is held as it is: a stale value would
+// re-trigger it on old data.
+void rules_evaluate(const env_sample_t *sample) {
+    uint16_t values[HISTORY_CHANNELS] = {
+        sample->air.eco2,
+        sample->air.tvoc,
+        sample->climate.temperature_ticks,
+        sample->climate.humidity_ticks,
+    };
+    bool fresh[HISTORY_CHANNELS] = {
+        sample->air_status == SENSOR_OK,
+        sample->air_status == SENSOR_OK,
+        sample->climate_status == SENSOR_OK,
+        sample->climate_status == SENSOR_OK,
+    };
+    for (uint8_t ch = 0; ch < HISTORY_CHANNELS; ch++) {
+        recent[ch][recent_head] = values[ch];
+    }
+    recent_head = (recent_head + 1) % RULES_MAX_WINDOW;
+    if (recent_count < RULES_MAX_WINDOW) recent_count++;
+
+    uint8_t raised = 0;
+    for (uint8_t i = 0; i < rule_count; i++) {
+        rule_state_t *st = &states[i];
+        int8_t result = fresh[rules[i].channel] ? rule_test(&rules[i], values) : 0;
+        if (result > 0) {
+            if (st->run < UINT8_MAX) st->run++;
+            if (!st->active && st->run >= rules[i].sustain) {
+                st->active = true;
+                telemetry_event(TELEMETRY_EVT_RULE_ON, i);
+            }
+        } else if (fresh[rules[i].channel]) {
+            st->run = 0;
+            if (result < 0 && st->active) {
+                st->active = false;
+                telemetry_event(TELEMETRY_EVT_RULE_OFF, i);
+            }
+        }
+        if (st->active) {
+            raised |= 1u << rules[i].source;
+        }
+    }
+
+    for (uint8_t src = 0; src < ALARM_SRC_COUNT; src++) {
+        if (src == ALARM_SRC_CLOCK) {
+            continue;
+        }
+        if (raised & (1u << src)) {
+            alarm_raise((alarm_source_t)src);
+        } else {
+            alarm_clear((alarm_source_t)src);
+        }
+    }
+}
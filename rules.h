@@ -0,0 +1,41 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "alarm.h"
+#include "history.h"
+#include "sensor.h"
+
+#define RULES_MAX        8
+#define RULES_MAX_WINDOW 16
+
+// Thresholds are in the channel's raw units: ppm/ppb for the SGP30 and
+// SHT45 ticks for temperature and humidity.
+typedef enum {
+    RULE_ABOVE,   // value > threshold, releases at <= threshold - hysteresis
+    RULE_BELOW,   // value < threshold, releases at >= threshold + hysteresis
+    RULE_RISE,    // value - value `window` samples ago > threshold
+} rule_kind_t;
+
+typedef struct {
+    uint8_t channel;      // history_channel_t
+    uint8_t kind;         // rule_kind_t
+    uint8_t sustain;      // consecutive tripping samples before the rule fires
+    uint8_t window;       // RULE_RISE only, 1..RULES_MAX_WINDOW - 1
+    uint16_t threshold;
+    uint16_t hysteresis;
+    uint8_t source;       // alarm_source_t raised while the rule is active
+} rule_t;
+
+// SHT45 tick values for thresholds given in hundredths of a unit.
+#define RULE_CENTI_CELSIUS_TICKS(c) ((uint16_t)(((int32_t)(c) + 4500) * 65535L / 17500))
+#define RULE_CENTI_RH_TICKS(rh)     ((uint16_t)(((int32_t)(rh) + 600) * 65535L / 12500))
+#define RULE_CENTI_CELSIUS_SPAN(c)  ((uint16_t)((int32_t)(c) * 65535L / 17500))
+#define RULE_CENTI_RH_SPAN(rh)      ((uint16_t)((int32_t)(rh) * 65535L / 12500))
+
+void rules_init(void);
+bool rules_load(const rule_t *rules, uint8_t count);
+void rules_evaluate(const env_sample_t *sample);
+
+#endif
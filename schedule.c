@@ -0,0 +1,159 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "app_util_platform.h"
+#include "hal.h"
+#include "schedule.h"
+#include "timekeeping.h"
+
+#define SECONDS_PER_DAY 86400UL
+
+// One slot past the user alarms holds a pending snooze.
+#define SNOOZE_SLOT  SCHEDULE_MAX
+#define SLOT_COUNT   (SCHEDULE_MAX + 1)
+
+typedef struct {
+    schedule_alarm_t alarm;
+    uint32_t due;       // wall seconds of the next firing
+} slot_t;
+
+static slot_t slots[SLOT_COUNT];
+
+// Enabled slots ordered by due time, so the next alarm is always order[0]
+// and only that one needs a timer.
+static uint8_t order[SLOT_COUNT];
+static uint8_t order_count = 0;
+
+static volatile bool fired = false;
+static schedule_notify_t fired_notify = NULL;
+
+HAL_TIMER_DEF(schedule_timer);
+
+// First time strictly after now that matches the alarm's hour, minute and days.
+static uint32_t next_due(const schedule_alarm_t *alarm, uint32_t now) {
+    uint32_t day = now / SECONDS_PER_DAY;
+    uint32_t tod = (uint32_t)alarm->hours * 3600 + (uint32_t)alarm->minutes * 60;
+    for (uint8_t i = 0; i < 8; i++, day++) {
+        uint32_t t = day * SECONDS_PER_DAY + tod;
+        if (t <= now) continue;
+        if (alarm->days == SCHEDULE_ONCE || (alarm->days & (1 << timekeeping_weekday(day)))) {
+            return t;
+        }
+    }
+    return UINT32_MAX;  // no day bits set within SCHEDULE_DAILY
+}
+
+static void order_remove(uint8_t slot) {
+    for (uint8_t i = 0; i < order_count; i++) {
+        if (order[i] == slot) {
+            order_count--;
+            for (; i < order_count; i++) {
+                order[i] = order[i + 1];
+            }
+            return;
+        }
+    }
+}
+
+static void order_insert(uint8_t slot) {
+    uint8_t i = order_count++;
+    while (i > 0 && slots[order[i - 1]].due > slots[slot].due) {
+        order[i] = order[i - 1];
+        i--;
+    }
+    order[i] = slot;
+}
+
+// Arms the timer for the head alarm. Waits longer than the timer can reach
+// are split; the callback re-checks the wall clock and re-arms, so trim
+// corrections and late interrupts can only delay an alarm, never skip it.
+static void schedule_arm(void) {
+    uint32_t wait = 0;
+    bool armed;
+    CRITICAL_REGION_ENTER();
+    armed = order_count > 0;
+    if (armed) {
+        uint64_t due = (uint64_t)slots[order[0]].due * HAL_TICKS_PER_SECOND;
+        uint64_t now = timekeeping_wall_ticks();
+        uint64_t remaining = (due > now) ? due - now : 0;
+        wait = (remaining > HAL_TIMER_MAX_TICKS) ? HAL_TIMER_MAX_TICKS : (uint32_t)remaining;
+    }
+    CRITICAL_REGION_EXIT();
+
+    hal_timer_stop(schedule_timer);
+    if (armed) {
+        hal_timer_start(schedule_timer, wait, NULL);
+    }
+}
+
+static void schedule_timer_cb(void *p_context) {
+    (void)p_context;
+    uint32_t now = timekeeping_wall_seconds();
+    bool any = false;
+    CRITICAL_REGION_ENTER();
+    // Everything due has fired once, however long the interrupt was held off.
+    while (order_count > 0 && slots[order[0]].due <= now) {
+        uint8_t slot = order[0];
+        order_remove(slot);
+        any = true;
+        if (slots[slot].alarm.days == SCHEDULE_ONCE) {
+            slots[slot].alarm.enabled = false;
+        } else {
+            slots[slot].due = next_due(&slots[slot].alarm, now);
+            order_insert(slot);
+        }
+    }
+    if (any) {
+        fired = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    schedule_arm();
+    if (any && fired_notify) {
+        fired_notify();
+    }
+}
+
+void schedule_init(schedule_notify_t notify) {
+    fired_notify = notify;
+    hal_err_t err_code = hal_timer_create(&schedule_timer, false, schedule_timer_cb);
+    if (err_code != HAL_SUCCESS) {
+        printf("schedule_timer init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
+
+static void schedule_place(uint8_t slot, const schedule_alarm_t *alarm, uint32_t due) {
+    CRITICAL_REGION_ENTER();
+    order_remove(slot);
+    slots[slot].alarm = *alarm;
+    slots[slot].due = due;
+    if (alarm->enabled && due != UINT32_MAX) {
+        order_insert(slot);
+    }
+    CRITICAL_REGION_EXIT();
+    schedule_arm();
+}
+
+bool schedule_set(uint8_t slot, const schedule_alarm_t *alarm) {
+    if (slot >= SCHEDULE_MAX || alarm->hours > 23 || alarm->minutes > 59 ||
+        alarm->days > SCHEDULE_DAILY) {
+        return false;
+    }
+    schedule_place(slot, alarm, next_due(alarm, timekeeping_wall_seconds()));
+    return true;
+}
+
+// Fires once, minutes from now, on top of whatever else is scheduled.
+void schedule_snooze(uint16_t minutes) {
+    schedule_alarm_t snooze = { 0, 0, SCHEDULE_ONCE, true };
+    schedule_place(SNOOZE_SLOT, &snooze, timekeeping_wall_seconds() + (uint32_t)minutes * 60);
+}
+
+bool schedule_take_fired(void) {
+    bool was;
+    CRITICAL_REGION_ENTER();
+    was = fired;
+    fired = false;
+    CRITICAL_REGION_EXIT();
+    return was;
+}
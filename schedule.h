@@ -0,0 +1,32 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCHEDULE_MAX 8
+
+// Day masks, bit 0 = Monday. A mask of 0 fires once at the next matching
+// time and then disables the slot.
+#define SCHEDULE_ONCE     0x00
+#define SCHEDULE_WEEKDAYS 0x1F
+#define SCHEDULE_WEEKEND  0x60
+#define SCHEDULE_DAILY    0x7F
+
+typedef struct {
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t days;
+    bool enabled;
+} schedule_alarm_t;
+
+typedef void (*schedule_notify_t)(void);
+
+// notify runs in interrupt context whenever an alarm has fired; collect it
+// with schedule_take_fired().
+void schedule_init(schedule_notify_t notify);
+bool schedule_set(uint8_t slot, const schedule_alarm_t *alarm);
+void schedule_snooze(uint16_t minutes);
+bool schedule_take_fired(void);
+
+#endif
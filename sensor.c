@@ -2,22 +2,43 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include "nrf_delay.h"
-#include "nrf_twi_mngr.h"
+#include "app_util_platform.h"
+#include "hal.h"
+#include "i2c_sched.h"
+#include "profile.h"
 #include "sensor.h"
 
-extern const nrf_twi_mngr_t* i2c_manager;
-
 #define SGP30_ADDR                   0x58
 #define INIT_AIR_QUALITY_MSB         0x20
 #define INIT_AIR_QUALITY_LSB         0x03
 #define MEASURE_AIR_QUALITY_MSB      0x20
 #define MEASURE_AIR_QUALITY_LSB      0x08
+#define GET_BASELINE_MSB             0x20
+#define GET_BASELINE_LSB             0x15
+#define SET_BASELINE_MSB             0x20
+#define SET_BASELINE_LSB             0x1E
+#define SET_HUMIDITY_MSB             0x20
+#define SET_HUMIDITY_LSB             0x61
 
 #define SHT45_ADDR   0x44
 #define MEASURE_CMD  0xFD
 
-static uint8_t sgp30_crc8(uint8_t *data, uint8_t len) {
+// Datasheet maximum conversion times: SGP30 Measure_air_quality, SHT45 high precision.
+#define SGP30_MEASURE_MS 12
+#define SHT45_MEASURE_MS 9
+// Init_air_quality, Get/Set_baseline and Set_absolute_humidity all take 10 ms.
+#define SGP30_COMMAND_MS 10
+
+// The SGP30 needs 12 h to learn a baseline from scratch; a restored one only
+// has to be re-read once it has had time to track the current air.
+#define SGP30_BASELINE_FIRST_MS    (12UL * 60 * 60 * 1000)
+#define SGP30_BASELINE_RESTORED_MS (60UL * 60 * 1000)
+#define SGP30_BASELINE_PERIOD_MS   (60UL * 60 * 1000)
+
+// Absolute humidity is only resent once it moves by 1/8 g/m^3.
+#define SGP30_HUMIDITY_STEP 32
+
+uint8_t sgp30_crc8(const uint8_t *data, uint8_t len) {
     uint8_t crc = 0xFF;
     for (uint8_t i = 0; i < len; i++) {
         crc ^= data[i];
@@ -31,117 +52,523 @@ static uint8_t sgp30_crc8(uint8_t *data, uint8_t len) {
     return crc;
 }
 
-bool sgp30_init(void) {
-    ret_code_t err_code;
-    uint8_t init_cmd[2] = { INIT_AIR_QUALITY_MSB, INIT_AIR_QUALITY_LSB };
-    nrf_twi_mngr_transfer_t init_xfer = NRF_TWI_MNGR_WRITE(SGP30_ADDR, init_cmd, 2, 0);
-    err_code = nrf_twi_mngr_perform(i2c_manager, NULL, &init_xfer, 1, NULL);
-    if (err_code != NRF_SUCCESS) {
-        printf("SGP30 initialization failed! Error: 0x%lX\n", err_code);
+static bool sgp30_decode(const uint8_t *data, sgp30_data_t *out) {
+    PROFILE_SCOPE(PROFILE_SENSOR_DECODE);
+    uint8_t crc1 = sgp30_crc8(data, 2);
+    if (crc1 != data[2]) {
+        printf("eCO2 CRC error: expected %02X, got %02X\n", crc1, data[2]);
         return false;
     }
-    nrf_delay_ms(1000);
+    uint8_t crc2 = sgp30_crc8(data + 3, 2);
+    if (crc2 != data[5]) {
+        printf("TVOC CRC error: expected %02X, got %02X\n", crc2, data[5]);
+        return false;
+    }
+
+    out->eco2 = ((uint16_t)data[0] << 8) | data[1];
+    out->tvoc = ((uint16_t)data[3] << 8) | data[4];
     return true;
 }
 
-sgp30_data_t sgp30_read_data(void) {
-    sgp30_data_t result = {0, 0};
-    ret_code_t err_code;
-    uint8_t cmd[2] = { MEASURE_AIR_QUALITY_MSB, MEASURE_AIR_QUALITY_LSB };
-    uint8_t data[6] = {0};
+// round(scale * ticks / 65535) without a divide, as floor((2 * scale * ticks + 65535) / 131070).
+// (x * M) >> 47 equals x / 65535 exactly for every x < 2^32, which covers the
+// largest numerator of either scale.
+#define DIV65535_MUL   0x80008001ULL
+#define DIV65535_SHIFT 47
 
-    nrf_twi_mngr_transfer_t write_xfer = NRF_TWI_MNGR_WRITE(SGP30_ADDR, cmd, 2, 0);
-    err_code = nrf_twi_mngr_perform(i2c_manager, NULL, &write_xfer, 1, NULL);
-    if (err_code != NRF_SUCCESS) {
-        printf("SGP30 I2C write failed! Error: 0x%lX\n", err_code);
-        return result;
-    }
+static uint32_t scale_ticks(uint16_t ticks, uint32_t scale) {
+    uint32_t x = 2 * (uint32_t)ticks * scale + 65535;
+    return (uint32_t)(((uint64_t)x * DIV65535_MUL) >> DIV65535_SHIFT) >> 1;
+}
 
-    nrf_delay_ms(15);
+// T = -45 + 175 * ticks / 65535
+int16_t sht45_ticks_to_centi_celsius(uint16_t ticks) {
+    return (int16_t)((int32_t)scale_ticks(ticks, 17500) - 4500);
+}
 
-    nrf_twi_mngr_transfer_t read_xfer = NRF_TWI_MNGR_READ(SGP30_ADDR, data, 6, 0);
-    err_code = nrf_twi_mngr_perform(i2c_manager, NULL, &read_xfer, 1, NULL);
-    if (err_code != NRF_SUCCESS) {
-        printf("SGP30 I2C read failed! Error: 0x%lX\n", err_code);
-        return result;
+// RH = -6 + 125 * ticks / 65535
+int16_t sht45_ticks_to_centi_rh(uint16_t ticks) {
+    return (int16_t)((int32_t)scale_ticks(ticks, 12500) - 600);
+}
+
+// Saturation vapour density in 8.8 fixed-point g/m^3 from -20 C to 60 C in
+// 2 C steps (Magnus formula); interpolating between entries stays within 0.4%.
+#define AH_TABLE_MIN_CENTI -2000
+#define AH_TABLE_STEP_CENTI 200
+static const uint16_t saturation_density[] = {
+      276,   325,   381,   446,   520,   605,   702,   813,   938,  1080,
+     1241,  1423,  1627,  1857,  2114,  2402,  2724,  3082,  3481,  3923,
+     4414,  4957,  5557,  6219,  6947,  7748,  8626,  9589, 10643, 11795,
+    13052, 14421, 15911, 17530, 19288, 21193, 23255, 25486, 27894, 30493,
+    33292,
+};
+#define AH_TABLE_LEN (sizeof(saturation_density) / sizeof(saturation_density[0]))
+
+// Absolute humidity in the SGP30's 8.8 g/m^3 format, clamped to the table
+// range. Never returns 0, which would switch compensation off.
+uint16_t sensor_absolute_humidity(int16_t temperature_centi, int16_t humidity_centi) {
+    int32_t t = temperature_centi - AH_TABLE_MIN_CENTI;
+    int32_t t_max = (int32_t)(AH_TABLE_LEN - 1) * AH_TABLE_STEP_CENTI;
+    if (t < 0) t = 0;
+    if (t > t_max) t = t_max;
+    int32_t rh = humidity_centi;
+    if (rh < 0) rh = 0;
+    if (rh > 10000) rh = 10000;
+
+    uint32_t i = (uint32_t)t / AH_TABLE_STEP_CENTI;
+    uint32_t frac = (uint32_t)t % AH_TABLE_STEP_CENTI;
+    uint32_t rho = saturation_density[i];
+    if (frac != 0) {
+        rho += (saturation_density[i + 1] - rho) * frac / AH_TABLE_STEP_CENTI;
     }
+    uint32_t ah = (rho * (uint32_t)rh + 5000) / 10000;
+    return ah ? (uint16_t)ah : 1;
+}
 
+static bool sht45_decode(const uint8_t *data, sht45_data_t *out) {
+    PROFILE_SCOPE(PROFILE_SENSOR_DECODE);
+    // The SHT45 protects each word with the same CRC as the SGP30.
     uint8_t crc1 = sgp30_crc8(data, 2);
     if (crc1 != data[2]) {
-        printf("eCO2 CRC error: expected %02X, got %02X\n", crc1, data[2]);
-        return result;
+        printf("Temperature CRC error: expected %02X, got %02X\n", crc1, data[2]);
+        return false;
     }
     uint8_t crc2 = sgp30_crc8(data + 3, 2);
     if (crc2 != data[5]) {
-        printf("TVOC CRC error: expected %02X, got %02X\n", crc2, data[5]);
-        return result;
+        printf("Humidity CRC error: expected %02X, got %02X\n", crc2, data[5]);
+        return false;
     }
 
-    result.eco2 = ((uint16_t)data[0] << 8) | data[1];
-    result.tvoc = ((uint16_t)data[3] << 8) | data[4];
+    out->temperature_ticks = ((uint16_t)data[0] << 8) | data[1];
+    out->temperature_centi = sht45_ticks_to_centi_celsius(out->temperature_ticks);
 
-    return result;
+    out->humidity_ticks = ((uint16_t)data[3] << 8) | data[4];
+    out->humidity_centi = sht45_ticks_to_centi_rh(out->humidity_ticks);
+    return true;
 }
 
-sht45_data_t sht45_read_data(void) {
-    sht45_data_t result = {0.0f, 0.0f};
-    ret_code_t err_code;
-    uint8_t cmd = MEASURE_CMD;
-    uint8_t data[6] = {0};
+HAL_TIMER_DEF(sensor_period_timer);
+HAL_TIMER_DEF(sgp30_retry_timer);
+HAL_TIMER_DEF(sht45_retry_timer);
 
-    nrf_twi_mngr_transfer_t write_xfer = NRF_TWI_MNGR_WRITE(SHT45_ADDR, &cmd, 1, NRF_TWI_MNGR_NO_STOP);
-    err_code = nrf_twi_mngr_perform(i2c_manager, NULL, &write_xfer, 1, NULL);
-    if (err_code != NRF_SUCCESS) {
-        printf("SHT45 I2C write failed! Error: 0x%lX\n", err_code);
-        return result;
+#define ACQ_SGP30 0x01
+#define ACQ_SHT45 0x02
+
+// A failed exchange is retried after 5, 10 and 20 ms; all of that still fits
+// well inside one sample period.
+#define SENSOR_RETRY_MAX     3
+#define SENSOR_RETRY_BASE_MS 5
+// Failed periods a half is still shown as stale before it turns invalid.
+#define SENSOR_STALE_PERIODS 10
+// Periods a device may leave its exchange unanswered before it is failed,
+// so a transfer that never completes cannot stop sampling for good.
+#define SENSOR_DEADLINE_PERIODS 2
+
+// SGP30 commands still owed to the chip, sent lowest bit first ahead of the
+// next measurement. Set_baseline must directly follow Init_air_quality.
+#define SGP30_NEED_INIT         0x01
+#define SGP30_NEED_SET_BASELINE 0x02
+#define SGP30_NEED_HUMIDITY     0x04
+#define SGP30_NEED_GET_BASELINE 0x08
+
+static i2c_job_t sgp30_job = {
+    .addr          = SGP30_ADDR,
+    .cmd           = { MEASURE_AIR_QUALITY_MSB, MEASURE_AIR_QUALITY_LSB },
+    .cmd_len       = 2,
+    .rx_len        = 6,
+    .conversion_ms = SGP30_MEASURE_MS,
+};
+static i2c_job_t sgp30_cmd_job = {
+    .addr          = SGP30_ADDR,
+    .conversion_ms = SGP30_COMMAND_MS,
+};
+static i2c_job_t sht45_job = {
+    .addr          = SHT45_ADDR,
+    .cmd           = { MEASURE_CMD },
+    .cmd_len       = 1,
+    .rx_len        = 6,
+    .conversion_ms = SHT45_MEASURE_MS,
+};
+
+// Each period starts samples[front ^ 1] as a copy of the front sample, the
+// job handlers overwrite the halves they read, and front flips once both
+// devices have finished, so readers always copy a finished sample.
+static env_sample_t samples[2];
+static volatile uint8_t front = 0;
+static volatile uint8_t acq_outstanding = 0;
+static uint8_t acq_late_periods = 0;
+static uint32_t acq_sequence = 0;
+static uint32_t acq_period_ms = 0;
+
+static sensor_health_t health[SENSOR_DEV_COUNT];
+static uint8_t acq_retries[SENSOR_DEV_COUNT];
+// When each measurement job was submitted, for PROFILE_SGP30_READ/SHT45_READ.
+static uint32_t acq_submitted[SENSOR_DEV_COUNT];
+static bool acq_have_good[SENSOR_DEV_COUNT];
+static volatile bool bus_clear_pending = false;
+static sensor_dev_t bus_clear_dev;
+
+static volatile uint8_t sgp30_needs = SGP30_NEED_INIT;
+static uint8_t sgp30_cmd_need = 0;
+static sgp30_data_t baseline_restore;
+static uint16_t humidity_pending = 0;
+static uint16_t humidity_sent = 0;
+static uint32_t baseline_due_ms = SGP30_BASELINE_FIRST_MS;
+static sgp30_data_t baseline_fetched;
+static volatile bool baseline_ready = false;
+
+static void sgp30_need(uint8_t bits) {
+    CRITICAL_REGION_ENTER();
+    sgp30_needs |= bits;
+    CRITICAL_REGION_EXIT();
+}
+
+static void sgp30_done(uint8_t bits) {
+    CRITICAL_REGION_ENTER();
+    sgp30_needs &= ~bits;
+    CRITICAL_REGION_EXIT();
+}
+
+static void put_word(uint8_t *dst, uint16_t word) {
+    dst[0] = word >> 8;
+    dst[1] = word & 0xFF;
+    dst[2] = sgp30_crc8(dst, 2);
+}
+
+static sensor_status_t acq_status(sensor_dev_t dev, bool ok) {
+    sensor_health_t *h = &health[dev];
+    if (ok) {
+        if (h->outage != 0) {
+            printf("Sensor %u recovered after %u periods\n", (unsigned)dev, h->outage);
+        }
+        h->good_periods++;
+        h->outage = 0;
+        acq_have_good[dev] = true;
+        return SENSOR_OK;
+    }
+    h->failed_periods++;
+    if (h->outage < UINT16_MAX) h->outage++;
+    if (h->outage > h->longest_outage) h->longest_outage = h->outage;
+    return (acq_have_good[dev] && h->outage <= SENSOR_STALE_PERIODS) ? SENSOR_STALE : SENSOR_INVALID;
+}
+
+static uint8_t acq_bit(sensor_dev_t dev) {
+    return (dev == SENSOR_DEV_SGP30) ? ACQ_SGP30 : ACQ_SHT45;
+}
+
+// Settles one device for this period and publishes the sample once both have.
+// A device already settled, say by the deadline, is left alone when its
+// late answer finally arrives.
+static void acq_finish(sensor_dev_t dev, bool ok) {
+    env_sample_t *back = &samples[front ^ 1];
+    uint8_t owed, outstanding;
+    CRITICAL_REGION_ENTER();
+    owed = acq_outstanding & acq_bit(dev);
+    acq_outstanding &= ~acq_bit(dev);
+    outstanding = acq_outstanding;
+    CRITICAL_REGION_EXIT();
+    if (!owed) {
+        return;
+    }
+
+    uint8_t status = acq_status(dev, ok);
+    if (dev == SENSOR_DEV_SGP30) {
+        back->air_status = status;
+    } else {
+        back->climate_status = status;
+    }
+    if (outstanding != 0) {
+        return;
     }
 
-    nrf_delay_ms(30);
+    back->sequence = ++acq_sequence;
+    back->valid = back->air_status != SENSOR_INVALID && back->climate_status != SENSOR_INVALID;
+    front ^= 1;
+}
 
-    nrf_twi_mngr_transfer_t read_xfer = NRF_TWI_MNGR_READ(SHT45_ADDR, data, 6, 0);
-    err_code = nrf_twi_mngr_perform(i2c_manager, NULL, &read_xfer, 1, NULL);
+// Counts a failed exchange, then either schedules another attempt or gives
+// up on the device until the next period.
+static void acq_fail(sensor_dev_t dev, bool crc_error) {
+    sensor_health_t *h = &health[dev];
+    if (!(acq_outstanding & acq_bit(dev))) {
+        return;
+    }
+    if (crc_error) {
+        h->crc_errors++;
+    } else {
+        h->transfer_errors++;
+    }
+    // A stuck SDA reads as ACKed zero bytes, which only show up as a CRC
+    // failure, so it is checked either way. Without a bus manager nothing
+    // gets through either. Both wait for the clear at the next period, once
+    // the scheduler has drained.
+    if (hal_i2c_sda_stuck() || !i2c_sched_ready()) {
+        if (!bus_clear_pending) bus_clear_dev = dev;
+        bus_clear_pending = true;
+        acq_finish(dev, false);
+        return;
+    }
+    if (acq_retries[dev] >= SENSOR_RETRY_MAX) {
+        acq_finish(dev, false);
+        return;
+    }
+    hal_timer_t timer = (dev == SENSOR_DEV_SGP30) ? sgp30_retry_timer : sht45_retry_timer;
+    uint32_t backoff_ms = (uint32_t)SENSOR_RETRY_BASE_MS << acq_retries[dev];
+    acq_retries[dev]++;
+    h->retries++;
+    void *context = (dev == SENSOR_DEV_SGP30) ? (void *)&sgp30_job : (void *)&sht45_job;
+    hal_err_t err_code = hal_timer_start(timer, HAL_MS_TO_TICKS(backoff_ms), context);
+    if (err_code != HAL_SUCCESS) {
+        printf("sensor retry timer start failed: 0x%lX\n", (unsigned long)err_code);
+        acq_finish(dev, false);
+    }
+}
+
+static void acq_job_done(i2c_job_t *job, ret_code_t result) {
+    env_sample_t *back = &samples[front ^ 1];
+    sensor_dev_t dev = (job == &sht45_job) ? SENSOR_DEV_SHT45 : SENSOR_DEV_SGP30;
+    PROFILE_SINCE((dev == SENSOR_DEV_SGP30) ? PROFILE_SGP30_READ : PROFILE_SHT45_READ, acq_submitted[dev]);
+
+    if (result != NRF_SUCCESS) {
+        printf("Sensor 0x%02X transfer failed! Error: 0x%lX\n", job->addr, (unsigned long)result);
+        acq_fail(dev, false);
+        return;
+    }
+    if (job == &sgp30_job) {
+        if (!sgp30_decode(job->rx, &back->air)) {
+            acq_fail(dev, true);
+            return;
+        }
+    } else {
+        sht45_data_t climate;
+        if (!sht45_decode(job->rx, &climate)) {
+            acq_fail(dev, true);
+            return;
+        }
+        back->climate = climate;
+        uint16_t ah = sensor_absolute_humidity(climate.temperature_centi, climate.humidity_centi);
+        uint16_t delta = (ah > humidity_sent) ? ah - humidity_sent : humidity_sent - ah;
+        if (delta >= SGP30_HUMIDITY_STEP) {
+            humidity_pending = ah;
+            sgp30_need(SGP30_NEED_HUMIDITY);
+        }
+    }
+    acq_finish(dev, true);
+}
+
+static void acq_submit(i2c_job_t *job) {
+    if (job == &sgp30_job) {
+        PROFILE_STAMP(acq_submitted[SENSOR_DEV_SGP30]);
+    } else if (job == &sht45_job) {
+        PROFILE_STAMP(acq_submitted[SENSOR_DEV_SHT45]);
+    }
+    ret_code_t err_code = i2c_sched_submit(job);
     if (err_code != NRF_SUCCESS) {
-        printf("SHT45 I2C read failed! Error: 0x%lX\n", err_code);
-        return result;
+        job->handler(job, err_code);
+    }
+}
+
+// Sends the lowest outstanding SGP30 command, or the measurement once none
+// are left. Runs from the period timer and again from each command's handler.
+static void sgp30_step(void) {
+    uint8_t needs = sgp30_needs;
+    if (needs == 0) {
+        acq_submit(&sgp30_job);
+        return;
+    }
+
+    i2c_job_t *job = &sgp30_cmd_job;
+    sgp30_cmd_need = needs & -needs;
+    job->rx_len = 0;
+    switch (sgp30_cmd_need) {
+    case SGP30_NEED_INIT:
+        job->cmd[0] = INIT_AIR_QUALITY_MSB;
+        job->cmd[1] = INIT_AIR_QUALITY_LSB;
+        job->cmd_len = 2;
+        break;
+    case SGP30_NEED_SET_BASELINE:
+        // Parameters go in the reverse of Get_baseline's order: TVOC first.
+        job->cmd[0] = SET_BASELINE_MSB;
+        job->cmd[1] = SET_BASELINE_LSB;
+        put_word(&job->cmd[2], baseline_restore.tvoc);
+        put_word(&job->cmd[5], baseline_restore.eco2);
+        job->cmd_len = 8;
+        break;
+    case SGP30_NEED_HUMIDITY:
+        job->cmd[0] = SET_HUMIDITY_MSB;
+        job->cmd[1] = SET_HUMIDITY_LSB;
+        put_word(&job->cmd[2], humidity_pending);
+        job->cmd_len = 5;
+        break;
+    default:
+        job->cmd[0] = GET_BASELINE_MSB;
+        job->cmd[1] = GET_BASELINE_LSB;
+        job->cmd_len = 2;
+        job->rx_len = 6;
+        break;
+    }
+    acq_submit(job);
+}
+
+static void sgp30_cmd_done(i2c_job_t *job, ret_code_t result) {
+    if (result != NRF_SUCCESS) {
+        // The command stays owed, so a retry starts over with it.
+        printf("SGP30 command failed! Error: 0x%lX\n", (unsigned long)result);
+        acq_fail(SENSOR_DEV_SGP30, false);
+        return;
+    }
+    switch (sgp30_cmd_need) {
+    case SGP30_NEED_HUMIDITY:
+        humidity_sent = ((uint16_t)job->cmd[2] << 8) | job->cmd[3];
+        break;
+    case SGP30_NEED_GET_BASELINE:
+        // Same word layout as a measurement: eCO2 then TVOC.
+        if (!sgp30_decode(job->rx, &baseline_fetched)) {
+            acq_fail(SENSOR_DEV_SGP30, true);
+            return;
+        }
+        baseline_ready = true;
+        break;
+    }
+    sgp30_done(sgp30_cmd_need);
+    sgp30_step();
+}
+
+static void sensor_retry_timer_cb(void *p_context) {
+    if (p_context == &sht45_job) {
+        acq_submit(&sht45_job);
+    } else {
+        sgp30_step();
+    }
+}
+
+static void sensor_bus_clear(void) {
+    health[bus_clear_dev].bus_clears++;
+    bus_clear_pending = false;
+    hal_err_t err_code = hal_i2c_bus_clear();
+    if (err_code != HAL_SUCCESS) {
+        printf("I2C bus clear failed: 0x%lX\n", (unsigned long)err_code);
     }
+}
+
+// Fails whatever the bus has left unanswered past the deadline, without
+// retries, so the period can close.
+static void acq_expire(void) {
+    hal_timer_stop(sgp30_retry_timer);
+    hal_timer_stop(sht45_retry_timer);
+    for (uint8_t dev = 0; dev < SENSOR_DEV_COUNT; dev++) {
+        if (acq_outstanding & acq_bit((sensor_dev_t)dev)) {
+            printf("Sensor %u missed its deadline\n", (unsigned)dev);
+            acq_retries[dev] = SENSOR_RETRY_MAX;
+            acq_fail((sensor_dev_t)dev, false);
+        }
+    }
+}
+
+static void sensor_period_timer_cb(void *p_context) {
+    (void)p_context;
+    if (acq_outstanding != 0) {
+        if (++acq_late_periods < SENSOR_DEADLINE_PERIODS) {
+            return;
+        }
+        acq_expire();
+    }
+    acq_late_periods = 0;
+    if (bus_clear_pending && i2c_sched_idle()) {
+        sensor_bus_clear();
+    }
+    if (baseline_due_ms <= acq_period_ms) {
+        baseline_due_ms = SGP30_BASELINE_PERIOD_MS;
+        sgp30_need(SGP30_NEED_GET_BASELINE);
+    } else {
+        baseline_due_ms -= acq_period_ms;
+    }
+
+    samples[front ^ 1] = samples[front];
+    acq_retries[SENSOR_DEV_SGP30] = 0;
+    acq_retries[SENSOR_DEV_SHT45] = 0;
+    acq_outstanding = ACQ_SGP30 | ACQ_SHT45;
+    // Both commands go out back to back so the conversions overlap; the
+    // scheduler reads whichever finishes first.
+    sgp30_step();
+    acq_submit(&sht45_job);
+}
+
+void sensor_acq_init(void) {
+    sgp30_job.handler = acq_job_done;
+    sgp30_cmd_job.handler = sgp30_cmd_done;
+    sht45_job.handler = acq_job_done;
+
+    hal_err_t err_code = hal_timer_create(&sensor_period_timer, true, sensor_period_timer_cb);
+    if (err_code != HAL_SUCCESS) {
+        printf("sensor_period_timer init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+    err_code = hal_timer_create(&sgp30_retry_timer, false, sensor_retry_timer_cb);
+    if (err_code != HAL_SUCCESS) {
+        printf("sgp30_retry_timer init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+    err_code = hal_timer_create(&sht45_retry_timer, false, sensor_retry_timer_cb);
+    if (err_code != HAL_SUCCESS) {
+        printf("sht45_retry_timer init failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
+
+// Must be called before sensor_acq_start so it follows Init_air_quality.
+void sensor_set_baseline(const sgp30_data_t *baseline) {
+    baseline_restore = *baseline;
+    baseline_due_ms = SGP30_BASELINE_RESTORED_MS;
+    sgp30_need(SGP30_NEED_SET_BASELINE);
+}
+
+bool sensor_take_baseline(sgp30_data_t *out) {
+    bool ready;
+    CRITICAL_REGION_ENTER();
+    ready = baseline_ready;
+    baseline_ready = false;
+    *out = baseline_fetched;
+    CRITICAL_REGION_EXIT();
+    return ready;
+}
 
-    uint16_t temp_ticks = ((uint16_t)data[0] << 8) | data[1];
-    result.temperature = -45.0f + (175.0f * (float)temp_ticks / 65535.0f);
+void sensor_acq_start(uint32_t period_ms) {
+    acq_period_ms = period_ms;
+    // Kick off the first sample right away instead of waiting a full period.
+    sensor_period_timer_cb(NULL);
+    hal_err_t err_code = hal_timer_start(sensor_period_timer,
+                                         HAL_MS_TO_TICKS(period_ms),
+                                         NULL);
+    if (err_code != HAL_SUCCESS) {
+        printf("sensor_period_timer start failed: 0x%lX\n", (unsigned long)err_code);
+    }
+}
 
-    uint16_t hum_ticks = ((uint16_t)data[3] << 8) | data[4];
-    result.humidity = -6.0f + (125.0f * (float)hum_ticks / 65535.0f);
+bool sensor_get_latest(env_sample_t *out) {
+    uint8_t idx;
+    do {
+        idx = front;
+        *out = samples[idx];
+    } while (idx != front);
+    return out->valid;
+}
 
-    return result;
+bool sensor_get_health(sensor_dev_t dev, sensor_health_t *out) {
+    if (dev >= SENSOR_DEV_COUNT) {
+        return false;
+    }
+    CRITICAL_REGION_ENTER();
+    *out = health[dev];
+    CRITICAL_REGION_EXIT();
+    return true;
 }
 
-#include "lcd.h"
-#include "alarm.h"
+#include "view.h"
 
 void update_environment_display(void) {
-    sgp30_data_t air = sgp30_read_data();
-    sht45_data_t tempData = sht45_read_data();
-    printf("Temp=%.2fC, Humid=%.2f%%, eCO2=%u, TVOC=%u\n",
-           tempData.temperature, tempData.humidity, air.eco2, air.tvoc);
-    char line1[64], line2[64], line3[64], line4[64];
-    sprintf(line1, "Temp: %.2f C", tempData.temperature);
-    sprintf(line2, "Humid: %.2f %%RH", tempData.humidity);
-    sprintf(line3, "eCO2: %u ppm", air.eco2);
-    sprintf(line4, "TVOC: %u ppb", air.tvoc);
-
-    memset(displayMap, 0x00, sizeof(displayMap));
-    drawStringScaled(line1, 0, 0, 1, 1);
-    drawStringScaled(line2, 0, 8, 1, 1);
-    drawStringScaled(line3, 0, 16, 1, 1);
-    drawStringScaled(line4, 0, 24, 1, 1);
-    updateDisplay();
-
-    if (tempData.temperature > 30.0f) {
-        start_temp_alarm();
-    }
-    if (tempData.humidity > 70.0f) {
-        start_humid_alarm();
-    }
-    if (air.eco2 > 800) {
-        start_eco2_alarm();
+    env_sample_t sample;
+    sensor_get_latest(&sample);
+    if (sample.sequence == 0) {
+        view_environment(NULL);
+        return;
     }
+    view_environment(&sample);
 }
@@ -9,15 +9,61 @@ typedef struct {
     uint16_t tvoc;
 } sgp30_data_t;
 
+// Raw ticks plus hundredths of a degree Celsius / of a percent RH.
 typedef struct {
-    float temperature;
-    float humidity;
+    uint16_t temperature_ticks;
+    uint16_t humidity_ticks;
+    int16_t temperature_centi;
+    int16_t humidity_centi;
 } sht45_data_t;
 
-bool sgp30_init(void);
-sgp30_data_t sgp30_read_data(void);
+// A sample is published every period; each half says how current it is.
+typedef enum {
+    SENSOR_OK,       // measured this period
+    SENSOR_STALE,    // this period failed, the last good reading is carried over
+    SENSOR_INVALID,  // no good reading yet, or the outage has gone on too long
+} sensor_status_t;
 
-sht45_data_t sht45_read_data(void);
+typedef struct {
+    sgp30_data_t air;
+    sht45_data_t climate;
+    uint32_t sequence;
+    uint8_t air_status;      // sensor_status_t
+    uint8_t climate_status;  // sensor_status_t
+    bool valid;              // neither half is SENSOR_INVALID
+} env_sample_t;
+
+typedef enum {
+    SENSOR_DEV_SGP30,
+    SENSOR_DEV_SHT45,
+    SENSOR_DEV_COUNT
+} sensor_dev_t;
+
+// Counters since boot. Outages are counted in sample periods.
+typedef struct {
+    uint32_t good_periods;
+    uint32_t failed_periods;
+    uint32_t transfer_errors;  // NACKs, timeouts and submit failures
+    uint32_t crc_errors;
+    uint32_t retries;
+    uint32_t bus_clears;       // clears started because this device found SDA stuck
+    uint16_t outage;           // failed periods in a row, up to now
+    uint16_t longest_outage;
+} sensor_health_t;
+
+uint8_t sgp30_crc8(const uint8_t *data, uint8_t len);
+
+int16_t sht45_ticks_to_centi_celsius(uint16_t ticks);
+int16_t sht45_ticks_to_centi_rh(uint16_t ticks);
+uint16_t sensor_absolute_humidity(int16_t temperature_centi, int16_t humidity_centi);
+
+void sensor_acq_init(void);
+// The SGP30 baseline is passed in and out in the sgp30_data_t word order.
+void sensor_set_baseline(const sgp30_data_t *baseline);
+bool sensor_take_baseline(sgp30_data_t *out);
+void sensor_acq_start(uint32_t period_ms);
+bool sensor_get_latest(env_sample_t *out);
+bool sensor_get_health(sensor_dev_t dev, sensor_health_t *out);
 
 void update_environment_display(void);
 
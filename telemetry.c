@@ -0,0 +1,159 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "app_util_platform.h"
+#include "microbit_v2.h"
+#include "nrfx_uarte.h"
+#include "sensor.h"
+#include "telemetry.h"
+#include "timekeeping.h"
+
+// The stream goes out on the USB serial bridge, so printf must stay on RTT
+// whenever telemetry is enabled.
+#ifndef TELEMETRY_TX_PIN
+#define TELEMETRY_TX_PIN UART_TX
+#endif
+
+#define TELEMETRY_RING_SIZE   512
+#define TELEMETRY_MAX_PAYLOAD 13
+#define TELEMETRY_MAX_RAW     (2 + TELEMETRY_MAX_PAYLOAD + 1)
+// COBS adds one code byte per 254 data bytes, plus the 0x00 delimiter.
+#define TELEMETRY_MAX_FRAME   (TELEMETRY_MAX_RAW + 2)
+
+static const nrfx_uarte_t UARTE_INST = NRFX_UARTE_INSTANCE(1);
+
+// head is advanced by the producer (main loop), tail by the TX_DONE
+// interrupt; the bytes in [tail, tail + tx_len) are owned by EasyDMA.
+static uint8_t ring[TELEMETRY_RING_SIZE];
+static volatile uint16_t head = 0;
+static volatile uint16_t tail = 0;
+static volatile uint16_t tx_len = 0;
+
+static bool ready = false;
+static uint8_t frame_seq = 0;
+static uint32_t dropped = 0;
+
+static void kick_tx(void);
+
+static void uarte_event_handler(nrfx_uarte_event_t const *p_event, void *p_context) {
+    (void)p_context;
+    if (p_event->type == NRFX_UARTE_EVT_TX_DONE || p_event->type == NRFX_UARTE_EVT_ERROR) {
+        tail = (tail + tx_len) % TELEMETRY_RING_SIZE;
+        tx_len = 0;
+        kick_tx();
+    }
+}
+
+// Starts a DMA transfer of the longest contiguous run of queued bytes.
+static void kick_tx(void) {
+    CRITICAL_REGION_ENTER();
+    if (tx_len == 0 && head != tail) {
+        uint16_t end = (head > tail) ? head : TELEMETRY_RING_SIZE;
+        uint16_t len = end - tail;
+        if (nrfx_uarte_tx(&UARTE_INST, &ring[tail], len) == NRFX_SUCCESS) {
+            tx_len = len;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+static uint16_t ring_free(void) {
+    return (tail + TELEMETRY_RING_SIZE - head - 1) % TELEMETRY_RING_SIZE;
+}
+
+static uint8_t cobs_encode(const uint8_t *src, uint8_t len, uint8_t *dst) {
+    uint8_t code_pos = 0, out = 1, code = 1;
+    for (uint8_t i = 0; i < len; i++) {
+        if (src[i] == 0) {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            dst[out++] = src[i];
+            code++;
+        }
+    }
+    dst[code_pos] = code;
+    dst[out++] = 0x00;
+    return out;
+}
+
+// Frames are dropped whole when the ring is full so the receiver never sees
+// a partial one; the main loop never waits on the UART.
+static bool send_frame(uint8_t type, const uint8_t *payload, uint8_t len) {
+    if (!ready) {
+        return false;
+    }
+    uint8_t raw[TELEMETRY_MAX_RAW];
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    raw[0] = type;
+    raw[1] = frame_seq++;
+    memcpy(&raw[2], payload, len);
+    raw[2 + len] = sgp30_crc8(raw, 2 + len);
+    uint8_t frame_len = cobs_encode(raw, 3 + len, frame);
+
+    if (ring_free() < frame_len) {
+        dropped++;
+        return false;
+    }
+    uint16_t h = head;
+    uint16_t first = TELEMETRY_RING_SIZE - h;
+    if (first > frame_len) {
+        first = frame_len;
+    }
+    memcpy(&ring[h], frame, first);
+    memcpy(&ring[0], frame + first, frame_len - first);
+    head = (h + frame_len) % TELEMETRY_RING_SIZE;
+    kick_tx();
+    return true;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    p = put_u16(p, v & 0xFFFF);
+    return put_u16(p, v >> 16);
+}
+
+void telemetry_init(void) {
+    nrfx_uarte_config_t config = NRFX_UARTE_DEFAULT_CONFIG;
+    config.pseltxd = TELEMETRY_TX_PIN;
+    config.pselrxd = NRF_UARTE_PSEL_DISCONNECTED;
+    config.baudrate = NRF_UARTE_BAUDRATE_115200;
+    config.interrupt_priority = APP_IRQ_PRIORITY_LOW;
+    nrfx_err_t err_code = nrfx_uarte_init(&UARTE_INST, &config, uarte_event_handler);
+    if (err_code != NRFX_SUCCESS) {
+        printf("telemetry: uarte init failed: 0x%lX\n", (unsigned long)err_code);
+        return;
+    }
+    ready = true;
+    telemetry_event(TELEMETRY_EVT_BOOT, 0);
+}
+
+bool telemetry_sample(const env_sample_t *sample) {
+    uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+    uint8_t *p = put_u32(payload, timekeeping_uptime_ms());
+    p = put_u16(p, sample->air.eco2);
+    p = put_u16(p, sample->air.tvoc);
+    p = put_u16(p, sample->climate.temperature_ticks);
+    p = put_u16(p, sample->climate.humidity_ticks);
+    *p++ = TELEMETRY_STATUS(sample->air_status, sample->climate_status);
+    return send_frame(TELEMETRY_REC_SAMPLE, payload, p - payload);
+}
+
+bool telemetry_event(telemetry_event_t code, uint16_t arg) {
+    uint8_t payload[7];
+    uint8_t *p = put_u32(payload, timekeeping_uptime_ms());
+    *p++ = (uint8_t)code;
+    p = put_u16(p, arg);
+    return send_frame(TELEMETRY_REC_EVENT, payload, p - payload);
+}
+
+uint32_t telemetry_dropped_frames(void) {
+    return dropped;
+}
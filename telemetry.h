@@ -0,0 +1,33 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensor.h"
+
+// Every frame is COBS encoded and terminated by a 0x00 byte:
+//   type(1) seq(1) payload(n) crc8(1)
+// with multi-byte payload fields little endian and the CRC-8 taken over
+// type, seq and payload.
+#define TELEMETRY_REC_SAMPLE 0x01  // timestamp_ms(4) eco2(2) tvoc(2) temp_ticks(2) humid_ticks(2) status(1)
+#define TELEMETRY_REC_EVENT  0x02  // timestamp_ms(4) code(1) arg(2)
+
+// The sample status byte carries each half's sensor_status_t, so a reader can
+// tell a carried-over reading from a fresh one.
+#define TELEMETRY_STATUS(air, climate)   ((uint8_t)((air) | ((climate) << 4)))
+#define TELEMETRY_STATUS_AIR(status)     ((status) & 0x0F)
+#define TELEMETRY_STATUS_CLIMATE(status) ((status) >> 4)
+
+typedef enum {
+    TELEMETRY_EVT_BOOT = 1,
+    TELEMETRY_EVT_STATE,          // arg: new system_state_t
+    TELEMETRY_EVT_RULE_ON,        // arg: index of the rule that became active
+    TELEMETRY_EVT_RULE_OFF,       // arg: index of the rule that released
+} telemetry_event_t;
+
+void telemetry_init(void);
+bool telemetry_sample(const env_sample_t *sample);
+bool telemetry_event(telemetry_event_t code, uint16_t arg);
+uint32_t telemetry_dropped_frames(void);
+
+#endif
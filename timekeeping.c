@@ -0,0 +1,106 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "app_util_platform.h"
+#include "hal.h"
+#include "timekeeping.h"
+
+// The RTC tick counter is only 24 bits wide and wraps every 512 s at
+// 32768 Hz. Any caller sampling it at least that often keeps the 64-bit
+// extension exact; main's 1 s clock timer guarantees that.
+#define TICKS_PER_SECOND   ((uint64_t)HAL_TICKS_PER_SECOND)
+#define TICKS_PER_DAY      (TICKS_PER_SECOND * 86400ULL)
+
+static uint32_t last_counter = 0;
+static uint64_t extended_ticks = 0;
+
+// Wall clock: corrected ticks since midnight of day 0 at raw tick base_raw.
+static uint64_t base_raw = 0;
+static uint64_t base_wall = 0;
+static int32_t trim_ppm = 0;
+// Weekday of day 0, Monday = 0.
+static uint8_t weekday_base = 0;
+
+void timekeeping_init(void) {
+    CRITICAL_REGION_ENTER();
+    last_counter = hal_ticks();
+    extended_ticks = 0;
+    base_raw = 0;
+    base_wall = 0;
+    CRITICAL_REGION_EXIT();
+}
+
+uint64_t timekeeping_ticks(void) {
+    uint64_t ticks;
+    CRITICAL_REGION_ENTER();
+    uint32_t now = hal_ticks();
+    extended_ticks += hal_ticks_elapsed(now, last_counter);
+    last_counter = now;
+    ticks = extended_ticks;
+    CRITICAL_REGION_EXIT();
+    return ticks;
+}
+
+uint32_t timekeeping_uptime_ms(void) {
+    return (uint32_t)((timekeeping_ticks() * 1000) / TICKS_PER_SECOND);
+}
+
+static uint64_t wall_ticks_at(uint64_t raw) {
+    int64_t delta = (int64_t)(raw - base_raw);
+    delta += (delta * trim_ppm) / 1000000;
+    return base_wall + (uint64_t)delta;
+}
+
+uint64_t timekeeping_wall_ticks(void) {
+    uint64_t raw = timekeeping_ticks();
+    uint64_t wall;
+    CRITICAL_REGION_ENTER();
+    wall = wall_ticks_at(raw);
+    CRITICAL_REGION_EXIT();
+    return wall;
+}
+
+uint32_t timekeeping_wall_seconds(void) {
+    return (uint32_t)(timekeeping_wall_ticks() / TICKS_PER_SECOND);
+}
+
+// Moves the clock within the current day; the day count is kept.
+void timekeeping_set_time(uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    uint64_t raw = timekeeping_ticks();
+    uint32_t tod_seconds = (uint32_t)hours * 3600 + (uint32_t)minutes * 60 + seconds;
+    CRITICAL_REGION_ENTER();
+    uint64_t day = wall_ticks_at(raw) / TICKS_PER_DAY;
+    base_raw = raw;
+    base_wall = day * TICKS_PER_DAY + ((uint64_t)tod_seconds * TICKS_PER_SECOND) % TICKS_PER_DAY;
+    CRITICAL_REGION_EXIT();
+}
+
+uint32_t timekeeping_seconds_of_day(void) {
+    return (uint32_t)((timekeeping_wall_ticks() % TICKS_PER_DAY) / TICKS_PER_SECOND);
+}
+
+void timekeeping_set_weekday(uint8_t weekday) {
+    uint32_t day = timekeeping_wall_seconds() / 86400;
+    weekday_base = (uint8_t)((weekday % 7 + 7 - day % 7) % 7);
+}
+
+uint8_t timekeeping_weekday(uint32_t day) {
+    return (uint8_t)((weekday_base + day) % 7);
+}
+
+void timekeeping_get_time(uint8_t *hours, uint8_t *minutes, uint8_t *seconds) {
+    uint32_t tod = timekeeping_seconds_of_day();
+    *hours = tod / 3600;
+    *minutes = (tod / 60) % 60;
+    *seconds = tod % 60;
+}
+
+// Positive ppm speeds the clock up for a slow crystal. Time already elapsed
+// keeps the old trim; the new one applies from now on.
+void timekeeping_set_trim_ppm(int32_t ppm) {
+    uint64_t raw = timekeeping_ticks();
+    CRITICAL_REGION_ENTER();
+    base_wall = wall_ticks_at(raw);
+    base_raw = raw;
+    trim_ppm = ppm;
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,25 @@
+#ifndef TIMEKEEPING_H
+#define TIMEKEEPING_H
+
+#include <stdint.h>
+
+void timekeeping_init(void);
+
+uint64_t timekeeping_ticks(void);
+uint32_t timekeeping_uptime_ms(void);
+
+// Wall time counts from midnight of day 0, the day the clock was started.
+uint64_t timekeeping_wall_ticks(void);
+uint32_t timekeeping_wall_seconds(void);
+
+void timekeeping_set_time(uint8_t hours, uint8_t minutes, uint8_t seconds);
+void timekeeping_get_time(uint8_t *hours, uint8_t *minutes, uint8_t *seconds);
+uint32_t timekeeping_seconds_of_day(void);
+
+// Weekdays run Monday = 0 to Sunday = 6; day is a wall-time day number.
+void timekeeping_set_weekday(uint8_t weekday);
+uint8_t timekeeping_weekday(uint32_t day);
+
+void timekeeping_set_trim_ppm(int32_t ppm);
+
+#endif
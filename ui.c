@@ -0,0 +1,302 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "alarm.h"
+#include "flashlog.h"
+#include "history.h"
+#include "schedule.h"
+#include "sensor.h"
+#include "telemetry.h"
+#include "timekeeping.h"
+#include "ui.h"
+#include "view.h"
+
+#define ENV_ENTER_HOLD_MS      1000
+#define ALARM_FLASH_PERIOD_MS  500
+#define TIMEUP_DURATION_MS     1500
+#define SNOOZE_MINUTES         5
+// The alarm edited from the UI; other schedule slots are left alone.
+#define UI_ALARM_SLOT          0
+
+// Each screen declares its hooks here; any of them may be NULL. render only
+// runs after a hook has called ui_invalidate() because its model changed.
+typedef struct {
+    void (*enter)(void);
+    void (*exit)(void);
+    void (*on_button)(const button_event_t *evt);
+    void (*on_tick)(void);
+    void (*render)(void);
+} ui_state_desc_t;
+
+static system_state_t state = STATE_NORMAL;
+static bool needs_render = true;
+static uint32_t now_ms = 0;
+static uint32_t state_entered_ms = 0;
+
+static uint8_t hours = 0, minutes = 0, seconds = 0;
+static uint8_t alarm_hours = 0, alarm_minutes = 0;
+static bool alarm_set_flag = false;
+// An alarm that came due mid-edit, shown once the edit is left.
+static bool alarm_deferred = false;
+static bool flash_on = true;
+static uint32_t last_flash_toggle = 0;
+static uint32_t shown_sample_sequence = 0;
+// Page 0 is the text summary, pages 1.. chart each history channel.
+static uint8_t env_page = 0;
+static history_window_t env_window = HISTORY_WINDOW_MINUTE;
+
+static void ui_set_state(system_state_t next);
+
+static void ui_invalidate(void) {
+    needs_render = true;
+}
+
+static void alarm_minute_step(int8_t delta) {
+    int16_t total = (int16_t)alarm_hours * 60 + alarm_minutes + delta;
+    if(total < 0) total += 24 * 60;
+    if(total >= 24 * 60) total -= 24 * 60;
+    alarm_hours = total / 60;
+    alarm_minutes = total % 60;
+    ui_invalidate();
+}
+
+static void schedule_ui_alarm(void) {
+    schedule_alarm_t alarm = { alarm_hours, alarm_minutes, SCHEDULE_DAILY, alarm_set_flag };
+    schedule_set(UI_ALARM_SLOT, &alarm);
+}
+
+static void save_alarm_settings(void) {
+    // Keep whatever else the record carries, such as the SGP30 baseline.
+    flashlog_settings_t settings = {0};
+    flashlog_load_settings(&settings);
+    settings.alarm_hours = alarm_hours;
+    settings.alarm_minutes = alarm_minutes;
+    settings.alarm_enabled = alarm_set_flag;
+    flashlog_save_settings(&settings);
+}
+
+/* STATE_NORMAL */
+
+static void normal_on_button(const button_event_t *evt) {
+    if(evt->button == BUTTON_A && evt->type == BUTTON_EVT_LONG && evt->duration_ms >= ENV_ENTER_HOLD_MS) {
+        ui_set_state(STATE_ENVIRONMENT);
+    } else if(evt->button == BUTTON_B && evt->type == BUTTON_EVT_LONG) {
+        ui_set_state(STATE_ALARM_SET);
+    } else if(evt->button == BUTTON_B && evt->type == BUTTON_EVT_SHORT) {
+        // Turns the stored alarm off and back on without losing its time.
+        alarm_set_flag = !alarm_set_flag;
+        printf("Alarm %02d:%02d %s\n", alarm_hours, alarm_minutes, alarm_set_flag ? "on" : "off");
+        schedule_ui_alarm();
+        save_alarm_settings();
+    }
+}
+
+static void normal_render(void) {
+    view_clock(hours, minutes, seconds);
+}
+
+/* STATE_ALARM_SET */
+
+static void alarm_set_enter(void) {
+    alarm_hours = hours;
+    alarm_minutes = minutes;
+    flash_on = true;
+    last_flash_toggle = now_ms;
+    printf("Entering Alarm Set Mode\n");
+}
+
+static void alarm_set_on_button(const button_event_t *evt) {
+    if(evt->button == BUTTON_A &&
+       (evt->type == BUTTON_EVT_SHORT || evt->type == BUTTON_EVT_REPEAT)) {
+        alarm_minute_step(1);
+    } else if(evt->button == BUTTON_B && evt->type == BUTTON_EVT_SHORT) {
+        alarm_minute_step(-1);
+    } else if(evt->button == BUTTON_B && evt->type == BUTTON_EVT_LONG) {
+        alarm_set_flag = true;
+        printf("Alarm set to %02d:%02d\n", alarm_hours, alarm_minutes);
+        schedule_ui_alarm();
+        save_alarm_settings();
+        ui_set_state(STATE_NORMAL);
+    }
+}
+
+static void alarm_set_on_tick(void) {
+    if(now_ms - last_flash_toggle >= ALARM_FLASH_PERIOD_MS) {
+        last_flash_toggle = now_ms;
+        flash_on = !flash_on;
+        ui_invalidate();
+    }
+}
+
+static void alarm_set_render(void) {
+    if(flash_on) {
+        view_alarm(alarm_hours, alarm_minutes);
+    } else {
+        view_blank();
+    }
+}
+
+/* STATE_TIMEUP */
+
+static void timeup_enter(void) {
+    alarm_raise(ALARM_SRC_CLOCK);
+}
+
+// B snoozes, A dismisses; either one stops the sweep at once.
+static void timeup_on_button(const button_event_t *evt) {
+    if(evt->type != BUTTON_EVT_SHORT) return;
+    if(evt->button == BUTTON_B) {
+        alarm_silence();
+        schedule_snooze(SNOOZE_MINUTES);
+        printf("Snoozed for %d minutes\n", SNOOZE_MINUTES);
+        ui_set_state(STATE_NORMAL);
+    } else if(evt->button == BUTTON_A) {
+        alarm_silence();
+        printf("Alarm dismissed\n");
+        ui_set_state(STATE_NORMAL);
+    }
+}
+
+// Left alone, the screen stays up for as long as the alarm sounds.
+static void timeup_on_tick(void) {
+    if(now_ms - state_entered_ms >= TIMEUP_DURATION_MS && !alarm_playing()) {
+        ui_set_state(STATE_NORMAL);
+    }
+}
+
+static void timeup_render(void) {
+    view_time_up();
+}
+
+/* STATE_ENVIRONMENT */
+
+static void environment_enter(void) {
+    printf("Entering Environment Detection Mode\n");
+    shown_sample_sequence = 0;
+}
+
+static void environment_exit(void) {
+    printf("Exiting Environment Detection Mode\n");
+}
+
+static void environment_on_button(const button_event_t *evt) {
+    if(evt->button == BUTTON_A && evt->type == BUTTON_EVT_LONG) {
+        ui_set_state(STATE_NORMAL);
+    } else if(evt->button == BUTTON_B && evt->type == BUTTON_EVT_SHORT) {
+        env_page = (env_page + 1) % (HISTORY_CHANNELS + 1);
+        ui_invalidate();
+    } else if(evt->button == BUTTON_A && evt->type == BUTTON_EVT_SHORT && env_page != 0) {
+        env_window = (env_window + 1) % HISTORY_WINDOWS;
+        ui_invalidate();
+    }
+}
+
+static void environment_on_tick(void) {
+    env_sample_t sample;
+    // Samples with an invalid half are still shown, so a dead sensor does not hide the other.
+    sensor_get_latest(&sample);
+    if(sample.sequence != shown_sample_sequence) {
+        shown_sample_sequence = sample.sequence;
+        ui_invalidate();
+    }
+}
+
+static void environment_render(void) {
+    if(env_page == 0) {
+        update_environment_display();
+    } else {
+        view_chart((history_channel_t)(env_page - 1), env_window);
+    }
+}
+
+static const ui_state_desc_t states[STATE_COUNT] = {
+    [STATE_NORMAL] = {
+        .on_button = normal_on_button,
+        .render    = normal_render,
+    },
+    [STATE_ALARM_SET] = {
+        .enter     = alarm_set_enter,
+        .on_button = alarm_set_on_button,
+        .on_tick   = alarm_set_on_tick,
+        .render    = alarm_set_render,
+    },
+    [STATE_TIMEUP] = {
+        .enter     = timeup_enter,
+        .on_button = timeup_on_button,
+        .on_tick   = timeup_on_tick,
+        .render    = timeup_render,
+    },
+    [STATE_ENVIRONMENT] = {
+        .enter     = environment_enter,
+        .exit      = environment_exit,
+        .on_button = environment_on_button,
+        .on_tick   = environment_on_tick,
+        .render    = environment_render,
+    },
+};
+
+static void ui_set_state(system_state_t next) {
+    if(states[state].exit) states[state].exit();
+    state = next;
+    state_entered_ms = now_ms;
+    telemetry_event(TELEMETRY_EVT_STATE, next);
+    if(states[state].enter) states[state].enter();
+    ui_invalidate();
+}
+
+static void ui_render(void) {
+    if(!needs_render) return;
+    needs_render = false;
+    if(states[state].render) states[state].render();
+}
+
+void ui_init(void) {
+    flashlog_settings_t settings;
+    if(flashlog_load_settings(&settings)) {
+        alarm_hours = settings.alarm_hours;
+        alarm_minutes = settings.alarm_minutes;
+        alarm_set_flag = settings.alarm_enabled;
+        printf("Restored alarm %02d:%02d (%s)\n", alarm_hours, alarm_minutes,
+               alarm_set_flag ? "on" : "off");
+        schedule_ui_alarm();
+    }
+    now_ms = timekeeping_uptime_ms();
+    timekeeping_get_time(&hours, &minutes, &seconds);
+    state = STATE_NORMAL;
+    state_entered_ms = now_ms;
+    ui_invalidate();
+    ui_render();
+}
+
+// Editing the alarm is not interrupted; the alarm waits for the edit to end.
+void ui_alarm_due(void) {
+    if(state == STATE_ALARM_SET) {
+        alarm_deferred = true;
+        return;
+    }
+    ui_set_state(STATE_TIMEUP);
+    ui_render();
+}
+
+void ui_handle_button(const button_event_t *evt) {
+    if(states[state].on_button) states[state].on_button(evt);
+    ui_render();
+}
+
+void ui_tick(void) {
+    uint8_t h, m, s;
+    now_ms = timekeeping_uptime_ms();
+    timekeeping_get_time(&h, &m, &s);
+    if(h != hours || m != minutes || s != seconds) {
+        hours = h;
+        minutes = m;
+        seconds = s;
+        if(state == STATE_NORMAL) ui_invalidate();
+    }
+    if(alarm_deferred && state != STATE_ALARM_SET) {
+        alarm_deferred = false;
+        ui_set_state(STATE_TIMEUP);
+    }
+    if(states[state].on_tick) states[state].on_tick();
+    ui_render();
+}
@@ -0,0 +1,21 @@
+#ifndef UI_H
+#define UI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "button.h"
+
+typedef enum {
+    STATE_NORMAL,
+    STATE_ALARM_SET,
+    STATE_TIMEUP,
+    STATE_ENVIRONMENT,
+    STATE_COUNT
+} system_state_t;
+
+void ui_init(void);
+void ui_handle_button(const button_event_t *evt);
+void ui_alarm_due(void);
+void ui_tick(void);
+
+#endif
@@ -0,0 +1,301 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "fmt.h"
+#include "history.h"
+#include "lcd.h"
+#include "view.h"
+
+// Layouts are fixed, so the centring math is done once here instead of per frame.
+#define GLYPH_W           5
+#define GLYPH_H           8
+
+#define CLOCK_SCALE       2
+#define CLOCK_CELL_W      (GLYPH_W * CLOCK_SCALE)
+#define CLOCK_X           ((LCD_WIDTH - 8 * CLOCK_CELL_W) / 2)
+#define CLOCK_Y           ((LCD_HEIGHT - GLYPH_H * CLOCK_SCALE) / 2)
+
+#define ALARM_X           ((LCD_WIDTH - 5 * CLOCK_CELL_W) / 2)
+
+#define TIMEUP_SPACING    1
+#define TIMEUP_X          ((LCD_WIDTH - (5 * CLOCK_CELL_W + 4 * TIMEUP_SPACING)) / 2)
+
+#define ENV_LINES         4
+#define ENV_CELL_W        (GLYPH_W + 1)
+#define ENV_LINE_CHARS    (LCD_WIDTH / ENV_CELL_W)
+
+// Chart: title in bank 0, 4-character scale labels on the left and one
+// column per history entry, newest on the right.
+#define CHART_LABEL_CHARS 4
+#define CHART_X           (CHART_LABEL_CHARS * ENV_CELL_W)
+#define CHART_Y           GLYPH_H
+#define CHART_W           (LCD_WIDTH - CHART_X)
+#define CHART_H           (LCD_HEIGHT - CHART_Y)
+#define CHART_TITLE_CHARS (LCD_WIDTH / ENV_CELL_W)
+#define CHART_TAG_CHARS   3
+
+typedef enum {
+    VIEW_NONE,
+    VIEW_CLOCK,
+    VIEW_ALARM,
+    VIEW_BLANK,
+    VIEW_TIME_UP,
+    VIEW_ENVIRONMENT,
+    VIEW_CHART
+} view_id_t;
+
+typedef struct {
+    const char *title;
+    uint8_t divisor;  // display units per label unit
+    uint8_t step;     // axis limits are rounded out to multiples of this
+} chart_channel_t;
+
+static const chart_channel_t chart_channels[HISTORY_CHANNELS] = {
+    [HISTORY_ECO2]              = { "eCO2 ppm",  1,   50 },
+    [HISTORY_TVOC]              = { "TVOC ppb",  1,   10 },
+    [HISTORY_TEMPERATURE_TICKS] = { "Temp C",    100, 100 },
+    [HISTORY_HUMIDITY_TICKS]    = { "Humid %RH", 100, 100 },
+};
+
+static const char *const chart_tags[HISTORY_WINDOWS] = {
+    [HISTORY_WINDOW_MINUTE] = " 1m",
+    [HISTORY_WINDOW_HOUR]   = " 1h",
+    [HISTORY_WINDOW_DAY]    = "15h",
+};
+
+// What the chart area currently shows, so a new entry can scroll it in place.
+static struct {
+    history_channel_t channel;
+    history_window_t window;
+    uint32_t total;
+    int32_t lo;
+    int32_t hi;
+} chart;
+
+// Characters currently drawn in each text cell; '\0' means the cell is empty.
+static view_id_t current_view = VIEW_NONE;
+static char cells[ENV_LINES][ENV_LINE_CHARS + 1];
+static uint32_t render_calls = 0;
+static uint32_t cells_drawn = 0;
+
+static bool view_begin(view_id_t id) {
+    render_calls++;
+    if(current_view == id) return false;
+    current_view = id;
+    memset(cells, 0, sizeof(cells));
+    lcdClearBuffer();
+    return true;
+}
+
+// Redraws only the cells of text whose character differs from the cache.
+static void draw_cells(char *cache, const char *text, uint8_t max_cells,
+                       uint8_t x, uint8_t y, uint8_t scale, uint8_t spacing) {
+    uint8_t cell_w = GLYPH_W * scale + spacing;
+    for(uint8_t i = 0; i < max_cells; i++) {
+        char c = *text ? *text++ : '\0';
+        if(cache[i] == c) continue;
+        if(cache[i] != '\0') {
+            clearRect(x + i * cell_w, y, GLYPH_W * scale, GLYPH_H * scale);
+        }
+        if(c != '\0') {
+            drawCharScaled(c, x + i * cell_w, y, scale);
+        }
+        cache[i] = c;
+        cells_drawn++;
+    }
+}
+
+void view_invalidate(void) {
+    current_view = VIEW_NONE;
+}
+
+void view_stats(uint32_t *renders, uint32_t *cells_changed) {
+    *renders = render_calls;
+    *cells_changed = cells_drawn;
+}
+
+void view_clock(uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    char text[9] = "00:00:00";
+    fmt_2digits(&text[0], hours);
+    fmt_2digits(&text[3], minutes);
+    fmt_2digits(&text[6], seconds);
+    view_begin(VIEW_CLOCK);
+    draw_cells(cells[0], text, 8, CLOCK_X, CLOCK_Y, CLOCK_SCALE, 0);
+    updateDisplay();
+}
+
+void view_alarm(uint8_t hours, uint8_t minutes) {
+    char text[6] = "00:00";
+    fmt_2digits(&text[0], hours);
+    fmt_2digits(&text[3], minutes);
+    view_begin(VIEW_ALARM);
+    draw_cells(cells[0], text, 5, ALARM_X, CLOCK_Y, CLOCK_SCALE, 0);
+    updateDisplay();
+}
+
+void view_blank(void) {
+    view_begin(VIEW_BLANK);
+    updateDisplay();
+}
+
+void view_time_up(void) {
+    if(view_begin(VIEW_TIME_UP)) {
+        drawStringScaled("WAKE!", TIMEUP_X, CLOCK_Y, CLOCK_SCALE, TIMEUP_SPACING);
+    }
+    updateDisplay();
+}
+
+// A stale reading is the last good one, flagged by a '?' in place of the
+// space before its unit; an invalid one is replaced by "--". Labels are kept
+// short so the widest value still ends inside ENV_LINE_CHARS.
+static char *env_unit(char *p, uint8_t status, const char *unit) {
+    *p++ = (status == SENSOR_STALE) ? '?' : ' ';
+    return fmt_str(p, unit);
+}
+
+void view_environment(const env_sample_t *sample) {
+    char lines[ENV_LINES][ENV_LINE_CHARS + 1];
+    if(sample == NULL) {
+        *fmt_str(lines[0], "Reading") = '\0';
+        lines[1][0] = lines[2][0] = lines[3][0] = '\0';
+    } else {
+        bool climate = sample->climate_status != SENSOR_INVALID;
+        bool air = sample->air_status != SENSOR_INVALID;
+        char *p;
+        p = fmt_str(lines[0], "Temp ");
+        p = climate ? fmt_centi(p, sample->climate.temperature_centi) : fmt_str(p, "--");
+        *env_unit(p, sample->climate_status, "C") = '\0';
+        p = fmt_str(lines[1], "Hum ");
+        p = climate ? fmt_centi(p, sample->climate.humidity_centi) : fmt_str(p, "--");
+        *env_unit(p, sample->climate_status, "%RH") = '\0';
+        p = fmt_str(lines[2], "eCO2 ");
+        p = air ? fmt_u16(p, sample->air.eco2) : fmt_str(p, "--");
+        *env_unit(p, sample->air_status, "ppm") = '\0';
+        p = fmt_str(lines[3], "TVOC ");
+        p = air ? fmt_u16(p, sample->air.tvoc) : fmt_str(p, "--");
+        *env_unit(p, sample->air_status, "ppb") = '\0';
+    }
+
+    view_begin(VIEW_ENVIRONMENT);
+    for(uint8_t i = 0; i < ENV_LINES; i++) {
+        draw_cells(cells[i], lines[i], ENV_LINE_CHARS, 0, i * GLYPH_H, 1, ENV_CELL_W - GLYPH_W);
+    }
+    updateDisplay();
+}
+
+// Temperature and humidity are charted in hundredths so the axis can be
+// rounded to whole degrees and percent.
+static int32_t chart_value(history_channel_t channel, uint16_t value) {
+    switch(channel) {
+    case HISTORY_TEMPERATURE_TICKS: return sht45_ticks_to_centi_celsius(value);
+    case HISTORY_HUMIDITY_TICKS:    return sht45_ticks_to_centi_rh(value);
+    default:                        return value;
+    }
+}
+
+static int32_t round_down(int32_t v, int32_t step) {
+    int32_t r = v % step;
+    return (r < 0) ? v - r - step : v - r;
+}
+
+static uint8_t chart_y(int32_t v) {
+    return CHART_Y + CHART_H - 1 - (uint8_t)((v - chart.lo) * (CHART_H - 1) / (chart.hi - chart.lo));
+}
+
+// Labels fit CHART_LABEL_CHARS, switching to thousands above 9999.
+static void chart_label(char *dst, int32_t v) {
+    v /= chart_channels[chart.channel].divisor;
+    if(v < 0) {
+        *dst++ = '-';
+        v = -v;
+    }
+    if(v > 9999) {
+        dst = fmt_u16(dst, (uint16_t)(v / 1000));
+        *dst++ = 'k';
+    } else {
+        dst = fmt_u16(dst, (uint16_t)v);
+    }
+    *dst = '\0';
+}
+
+// Entry at age goes in the column age places left of the right edge. The
+// minute window is a sparkline joining each sample to the one before it;
+// the bucketed windows draw a min..max bar.
+static void chart_column(uint16_t age, const history_bucket_t *b, const history_bucket_t *prev) {
+    uint8_t x = CHART_X + CHART_W - 1 - age;
+    uint8_t y0, y1;
+    if(chart.window == HISTORY_WINDOW_MINUTE) {
+        y0 = chart_y(chart_value(chart.channel, prev->avg));
+        y1 = chart_y(chart_value(chart.channel, b->avg));
+    } else {
+        y0 = chart_y(chart_value(chart.channel, b->min));
+        y1 = chart_y(chart_value(chart.channel, b->max));
+    }
+    clearRect(x, CHART_Y, 1, CHART_H);
+    drawVLine(x, y0, y1);
+}
+
+// Draws the newest count columns, and the oldest one as well if asked, in a
+// single walk of the window; each column needs the entry before it.
+static void chart_columns(uint16_t count, uint16_t len, bool oldest) {
+    history_iter_t it;
+    history_bucket_t b, prev;
+    uint16_t last = oldest ? len : count;
+    if(last > len) last = len;
+    history_iter_begin(&it, chart.channel, chart.window);
+    if(last == 0 || !history_iter_next(&it, &b)) return;
+    for(uint16_t age = 0; age < last; age++) {
+        if(age + 1 >= len || !history_iter_next(&it, &prev)) prev = b;
+        if(age < count || age == len - 1) chart_column(age, &b, &prev);
+        b = prev;
+    }
+}
+
+void view_chart(history_channel_t channel, history_window_t window) {
+    const chart_channel_t *ch = &chart_channels[channel];
+    history_stats_t stats;
+    bool have_data = history_query(channel, window, &stats);
+    int32_t lo = 0, hi = ch->step;
+    if(have_data) {
+        // Rounding out to whole steps keeps the axis still while values wander inside it.
+        lo = round_down(chart_value(channel, stats.min), ch->step);
+        hi = round_down(chart_value(channel, stats.max), ch->step) + ch->step;
+    }
+    uint32_t total = history_total(window);
+    uint16_t len = history_length(window);
+    if(len > CHART_W) len = CHART_W;
+
+    bool redraw = view_begin(VIEW_CHART) || channel != chart.channel || window != chart.window ||
+                  lo != chart.lo || hi != chart.hi || total - chart.total >= CHART_W;
+    uint32_t added = total - chart.total;
+    chart.channel = channel;
+    chart.window = window;
+    chart.total = total;
+    chart.lo = lo;
+    chart.hi = hi;
+
+    char title[CHART_TITLE_CHARS + 1];
+    char *p = fmt_str(title, ch->title);
+    while(p < &title[CHART_TITLE_CHARS - CHART_TAG_CHARS]) *p++ = ' ';
+    *fmt_str(p, chart_tags[window]) = '\0';
+    draw_cells(cells[0], title, CHART_TITLE_CHARS, 0, 0, 1, ENV_CELL_W - GLYPH_W);
+
+    char label[CHART_LABEL_CHARS + 2];
+    chart_label(label, have_data ? hi : 0);
+    draw_cells(cells[1], have_data ? label : "", CHART_LABEL_CHARS, 0, CHART_Y, 1, ENV_CELL_W - GLYPH_W);
+    chart_label(label, lo);
+    draw_cells(cells[2], have_data ? label : "", CHART_LABEL_CHARS, 0, LCD_HEIGHT - GLYPH_H, 1,
+               ENV_CELL_W - GLYPH_W);
+
+    if(redraw) {
+        clearRect(CHART_X - 1, CHART_Y, CHART_W + 1, CHART_H);
+        drawVLine(CHART_X - 1, CHART_Y, LCD_HEIGHT - 1);
+        chart_columns(len, len, false);
+    } else if(added > 0) {
+        // Older columns keep their pixels; only the new entries are drawn. The
+        // oldest sparkline column may still join to a sample that has aged out.
+        scrollRectLeft(CHART_X, CHART_Y, CHART_W, CHART_H, (uint8_t)added);
+        chart_columns((uint16_t)added, len, window == HISTORY_WINDOW_MINUTE && len == CHART_W);
+    }
+    updateDisplay();
+}
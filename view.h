@@ -0,0 +1,19 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <stdint.h>
+#include "history.h"
+#include "sensor.h"
+
+void view_invalidate(void);
+// Render calls and text cells redrawn since boot.
+void view_stats(uint32_t *renders, uint32_t *cells_changed);
+
+void view_clock(uint8_t hours, uint8_t minutes, uint8_t seconds);
+void view_alarm(uint8_t hours, uint8_t minutes);
+void view_blank(void);
+void view_time_up(void);
+void view_environment(const env_sample_t *sample);
+void view_chart(history_channel_t channel, history_window_t window);
+
+#endif
@@ -0,0 +1,50 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal.h"
+#include "wave.h"
+
+// Top value used for silent segments; its frequency never reaches the speaker.
+#define WAVE_SILENT_HZ 1000
+
+static uint16_t top_for(uint32_t hz) {
+    uint32_t top = HAL_PWM_CLOCK_HZ / hz - 1;
+    return (top > 0x7FFF) ? 0x7FFF : (uint16_t)top;
+}
+
+// Emits entries until each segment's time is used up. Time is tracked in PWM
+// clock ticks across the whole wave, so the overshoot of one segment's last
+// entry is taken out of the next instead of accumulating.
+uint16_t wave_build(const wave_segment_t *segments, uint8_t count,
+                    hal_pwm_entry_t *out, uint16_t capacity) {
+    uint16_t n = 0;
+    uint64_t t = 0, seg_start = 0;
+    for (uint8_t s = 0; s < count; s++) {
+        const wave_segment_t *seg = &segments[s];
+        uint64_t length = (uint64_t)seg->duration_ms * (HAL_PWM_CLOCK_HZ / 1000);
+        int32_t span = (int32_t)seg->end_hz - seg->start_hz;
+        while (t < seg_start + length) {
+            if (n == capacity) {
+                return n;
+            }
+            int64_t into = (int64_t)(t - seg_start);
+            uint32_t hz = seg->start_hz + (int32_t)((span * into) / (int64_t)length);
+            if (hz == 0 || seg->duty_permille == 0) {
+                hz = WAVE_SILENT_HZ;
+            }
+            uint16_t top = top_for(hz);
+            uint16_t compare = (uint16_t)(((uint32_t)top + 1) * seg->duty_permille / 1000);
+            hal_pwm_entry_set(&out[n++], top, compare);
+            t += (uint64_t)HAL_PWM_PERIODS_PER_ENTRY * (top + 1);
+        }
+        seg_start += length;
+    }
+    return n;
+}
+
+uint32_t wave_duration_ms(const hal_pwm_entry_t *entries, uint16_t count) {
+    uint64_t ticks = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        ticks += (uint64_t)HAL_PWM_PERIODS_PER_ENTRY * (entries[i].counter_top + 1);
+    }
+    return (uint32_t)(ticks / (HAL_PWM_CLOCK_HZ / 1000));
+}
@@ -0,0 +1,20 @@
+#ifndef WAVE_H
+#define WAVE_H
+
+#include <stdint.h>
+#include "hal.h"
+
+// One linear frequency ramp; start_hz == end_hz gives a steady tone and
+// duty_permille 0 gives silence for the segment's duration.
+typedef struct {
+    uint16_t start_hz;
+    uint16_t end_hz;
+    uint16_t duration_ms;
+    uint16_t duty_permille;
+} wave_segment_t;
+
+uint16_t wave_build(const wave_segment_t *segments, uint8_t count,
+                    hal_pwm_entry_t *out, uint16_t capacity);
+uint32_t wave_duration_ms(const hal_pwm_entry_t *entries, uint16_t count);
+
+#endif